@@ -133,11 +133,11 @@ DI_FetchConfig_LoadFromJSON(DI_FetchConfig* me,
     const json_value* json, bool desire, vector propertyItem, const char* version)
 {
     DI_FetchItem config[NUM_DI] = {
-        // telemetryName, intervalSec, pinID, isPulseCounter, isCountClear, isPulseHigh, isPollingActiveHigh, minPulseWidth, maxPulseCount
-        {"", 1, 0, false, false, false, false, 200, 0x7FFFFFFF},
-        {"", 1, 1, false, false, false, false, 200, 0x7FFFFFFF},
-        {"", 1, 2, false, false, false, false, 200, 0x7FFFFFFF},
-        {"", 1, 3, false, false, false, false, 200, 0x7FFFFFFF}
+        // telemetryName, intervalMs, alignToClock, overrunPolicy, pinID, isPulseCounter, isCountClear, isPulseHigh, isPollingActiveHigh, minPulseWidth, maxPulseCount
+        {"", 1000, false, FETCH_OVERRUN_SKIP, 0, false, false, false, false, 200, 0x7FFFFFFF},
+        {"", 1000, false, FETCH_OVERRUN_SKIP, 1, false, false, false, false, 200, 0x7FFFFFFF},
+        {"", 1000, false, FETCH_OVERRUN_SKIP, 2, false, false, false, false, 200, 0x7FFFFFFF},
+        {"", 1000, false, FETCH_OVERRUN_SKIP, 3, false, false, false, false, 200, 0x7FFFFFFF}
     };
     bool overWrite[NUM_DI] = {false};
     bool ret = true;
@@ -210,7 +210,7 @@ DI_FetchConfig_LoadFromJSON(DI_FetchConfig* me,
             if (!config[i].isPulseCounter || desire) {
                 // feature has changed
                 config[i].isCountClear  = true;
-                config[i].intervalSec   = DI_INTERVAL_DEFAULT_VALUE;
+                config[i].intervalMs   = DI_INTERVAL_DEFAULT_VALUE * 1000;
                 config[i].minPulseWidth = DI_MINPULSE_DEFAULT_VALUE;
                 config[i].maxPulseCount = DI_MAXCOUNT_DEFAULT_VALUE;
             }
@@ -222,7 +222,7 @@ DI_FetchConfig_LoadFromJSON(DI_FetchConfig* me,
             if (config[i].isPulseCounter || desire) {
                 // feacture has changed
                 config[i].isCountClear  = true;
-                config[i].intervalSec   = DI_INTERVAL_DEFAULT_VALUE;
+                config[i].intervalMs   = DI_INTERVAL_DEFAULT_VALUE * 1000;
                 config[i].minPulseWidth = DI_MINPULSE_DEFAULT_VALUE;
                 config[i].maxPulseCount = DI_MAXCOUNT_DEFAULT_VALUE;
             }
@@ -270,8 +270,8 @@ DI_FetchConfig_LoadFromJSON(DI_FetchConfig* me,
                                                 propertyItem, propertyName);
             if (config[pinid].isPulseCounter) {
                 if (result) {
-                    if (config[pinid].intervalSec != value) config[pinid].isCountClear = true;
-                    config[pinid].intervalSec = value;
+                    if (config[pinid].intervalMs != value * 1000) config[pinid].isCountClear = true;
+                    config[pinid].intervalMs = value * 1000;
                 } else {
                     ret = overWrite[pinid] = false;
                 }
@@ -327,8 +327,8 @@ DI_FetchConfig_LoadFromJSON(DI_FetchConfig* me,
                                                 propertyItem, propertyName);
             if (!config[pinid].isPulseCounter) {
                 if (result) {
-                    if (config[pinid].intervalSec != value) config[pinid].isCountClear = true;
-                    config[pinid].intervalSec = value;
+                    if (config[pinid].intervalMs != value * 1000) config[pinid].isCountClear = true;
+                    config[pinid].intervalMs = value * 1000;
                 } else {
                     ret = overWrite[pinid] = false;
                 }
@@ -35,7 +35,9 @@
 
 typedef struct DI_FetchItem {
     char        telemetryName[TELEMETRY_NAME_MAX_LEN + 1];  // telemetry name
-    uint32_t    intervalSec;            // periodic acquisition interval (in seconds)
+    uint32_t    intervalMs;            // periodic acquisition interval (in milliseconds)
+    bool        alignToClock;           // expire at the multiples of interval in wall-clock time
+    uint8_t     overrunPolicy;          // FetchOverrunPolicy
     uint32_t    pinID;                  // pin ID
     bool        isPulseCounter;         // pulse counter(true) / polling(false)
     bool        isCountClear;           // whether to clear the counter
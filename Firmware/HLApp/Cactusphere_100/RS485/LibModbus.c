@@ -42,9 +42,16 @@ const char ModbusDevConfigKey[] = "ModbusDevConfig";
 const char BaudrateKey[] = "baudrate";
 const char ParityBitKey[] = "parity";
 const char StopBitKey[] = "stop";
+const char ReadGapKey[] = "readGap";
+const char AutoPollKey[] = "autoPoll";
+const char MinTimeoutKey[] = "minTimeout";
+const char MaxTimeoutKey[] = "maxTimeout";
 
 #define MIN_BAUDRATE 1200
-#define MAX_BAUDRATE 125200
+#define MAX_BAUDRATE 921600
+#define MAX_READ_GAP 32
+#define MIN_RESPONSE_TIMEOUT 1     // [ms]
+#define MAX_RESPONSE_TIMEOUT 1000  // [ms]
 
 static const char ModbusParityKey[PARITY_NUM][5] = {
     "None", "Odd", "Even"
@@ -53,9 +60,13 @@ static const char ModbusParityKey[PARITY_NUM][5] = {
 static vector sModbusVec = NULL;
 
 // Add ModbusDev 
-static void Libmodbus_AddModbusDev(int devID, int boud, uint8_t parity, uint8_t stop) {
+static void Libmodbus_AddModbusDev(int devID, int boud, uint8_t parity, uint8_t stop, uint32_t readGap, bool autoPoll,
+    uint32_t minTimeout, uint32_t maxTimeout) {
     ModbusDev* modbusDev;
     modbusDev = ModbusDev_NewModbusRTU(devID, boud, parity, stop);
+    ModbusDev_SetReadGap(modbusDev, readGap);
+    ModbusDev_SetAutoPoll(modbusDev, autoPoll);
+    ModbusDev_SetTimeoutRange(modbusDev, minTimeout, maxTimeout);
     vector_add_last(sModbusVec, modbusDev);
 }
 
@@ -102,6 +113,10 @@ bool Libmodbus_LoadFromJSON(const json_value* json) {
         int baudrate = 0;
         uint8_t parity = 0;
         uint8_t stop = 1;
+        uint32_t readGap = 0;
+        bool autoPoll = false;
+        uint32_t minTimeout = MODBUS_DEFAULT_MIN_TIMEOUT_MS;
+        uint32_t maxTimeout = MODBUS_DEFAULT_MAX_TIMEOUT_MS;
         char *e;
         json_value* configItem = configJson->u.object.values[i].value;
 
@@ -138,13 +153,51 @@ bool Libmodbus_LoadFromJSON(const json_value* json) {
                         stop = (uint8_t)value;
                     }
                 }
+            } else if (0 == strcmp(configItem->u.object.values[p].name, ReadGapKey)) {
+                json_value* item = configItem->u.object.values[p].value;
+                uint32_t value;
+
+                if (json_GetNumericValue(item, &value, 10)) {
+                    if (value <= MAX_READ_GAP) {
+                        readGap = value;
+                    } else {
+                        ret = false;
+                    }
+                }
+            } else if (0 == strcmp(configItem->u.object.values[p].name, AutoPollKey)) {
+                json_value* item = configItem->u.object.values[p].value;
+
+                if (item->type == json_boolean) {
+                    autoPoll = item->u.boolean;
+                } else {
+                    ret = false;
+                }
+            } else if (0 == strcmp(configItem->u.object.values[p].name, MinTimeoutKey)) {
+                json_value* item = configItem->u.object.values[p].value;
+
+                if (! json_GetNumericValue(item, &minTimeout, 10)) {
+                    ret = false;
+                }
+            } else if (0 == strcmp(configItem->u.object.values[p].name, MaxTimeoutKey)) {
+                json_value* item = configItem->u.object.values[p].value;
+
+                if (! json_GetNumericValue(item, &maxTimeout, 10)) {
+                    ret = false;
+                }
             }
         }
 
+        if (minTimeout < MIN_RESPONSE_TIMEOUT || maxTimeout > MAX_RESPONSE_TIMEOUT
+            || minTimeout > maxTimeout) {
+            ret = false;
+            minTimeout = MODBUS_DEFAULT_MIN_TIMEOUT_MS;
+            maxTimeout = MODBUS_DEFAULT_MAX_TIMEOUT_MS;
+        }
         if (baudrate < MIN_BAUDRATE || baudrate > MAX_BAUDRATE) {
             ret = false;
         } else {
-            Libmodbus_AddModbusDev(devId, baudrate, parity, stop);
+            Libmodbus_AddModbusDev(devId, baudrate, parity, stop, readGap, autoPoll,
+                minTimeout, maxTimeout);
         }
     }
 
@@ -166,12 +219,58 @@ ModbusDev* Libmodbus_GetAndConnectLib(int devID) {
     return modbusDevP;
 }
 
+ModbusDev* Libmodbus_GetModbusDev(int devID) {
+    return ModbusDev_GetModbusDev(devID, sModbusVec);
+}
+
+void Libmodbus_ConnectAsync(ModbusDev* me, ModbusDevRTU_Callback callback, void* arg) {
+    ModbusDev_ConnectAsync(me, callback, arg);
+}
+
+int Libmodbus_CompareLineParams(int devID1, int devID2) {
+    ModbusDev* dev1 = ModbusDev_GetModbusDev(devID1, sModbusVec);
+    ModbusDev* dev2 = ModbusDev_GetModbusDev(devID2, sModbusVec);
+
+    if (dev1 == NULL || dev2 == NULL) {
+        return (dev1 == NULL) - (dev2 == NULL);  // unknown device last
+    }
+    return ModbusDev_CompareLineParams(dev1, dev2);
+}
+
 bool Libmodbus_ReadRegister(ModbusDev* me, int regAddr, int funcCode, unsigned short* dst, int regCount) {
     return ModbusDev_ReadRegister(me, regAddr, funcCode, dst, regCount);
 }
+bool Libmodbus_ReadRegisterBatch(ModbusDev* me, ModbusReadRequest* reqs, int count) {
+    return ModbusDev_ReadRegisterBatch(me, reqs, count);
+}
+void Libmodbus_ReadRegisterBatchAsync(ModbusDev* me, ModbusReadRequest* reqs, int count,
+    ModbusDevRTU_Callback callback, void* arg) {
+    ModbusDev_ReadRegisterBatchAsync(me, reqs, count, callback, arg);
+}
+// Poll table executed by RTApp
+void Libmodbus_ClearPollTable(void) {
+    ModbusDev_ClearPollTable();
+}
+int Libmodbus_AddPollEntry(ModbusDev* me, int funcCode, int regAddr, int regCount, uint32_t intervalMs) {
+    return ModbusDev_AddPollEntry(me, funcCode, regAddr, regCount, intervalMs);
+}
+bool Libmodbus_LoadPollTable(ModbusDevRTU_PollHandler handler, void* arg) {
+    return ModbusDev_LoadPollTable(handler, arg);
+}
+
 bool Libmodbus_WriteRegister(ModbusDev* me, int regAddr, int funcCode, unsigned short* data) {
     return ModbusDev_WriteRegister(me, regAddr, funcCode, *data);
 }
+bool Libmodbus_WriteMultiple(ModbusDev* me, int regAddr, int funcCode,
+    const unsigned short* values, int count) {
+    return ModbusDev_WriteMultiple(me, regAddr, funcCode, values, count);
+}
+bool Libmodbus_WriteAndReadRegisters(ModbusDev* me, int writeAddr,
+    const unsigned short* values, int writeCount,
+    int readAddr, unsigned short* dst, int readCount) {
+    return ModbusDev_WriteAndReadRegisters(me, writeAddr, values, writeCount,
+        readAddr, dst, readCount);
+}
 
 // Get RTApp Version
 bool Libmodbus_GetRTAppVersion(char* rtAppVersion) {
@@ -42,10 +42,28 @@ extern bool Libmodbus_LoadFromJSON(const json_value* json);
 
 // Connect
 extern ModbusDev* Libmodbus_GetAndConnectLib(int devID);
+extern ModbusDev* Libmodbus_GetModbusDev(int devID);
+extern void Libmodbus_ConnectAsync(ModbusDev* me, ModbusDevRTU_Callback callback, void* arg);
+
+// Compare line parameters of devices (for grouping devices of same settings)
+extern int Libmodbus_CompareLineParams(int devID1, int devID2);
 
 // Read/Write register
 extern bool Libmodbus_ReadRegister(ModbusDev* me, int regAddr, int funcCode, unsigned short* dst, int regCount);
+extern bool Libmodbus_ReadRegisterBatch(ModbusDev* me, ModbusReadRequest* reqs, int count);
+extern void Libmodbus_ReadRegisterBatchAsync(ModbusDev* me, ModbusReadRequest* reqs, int count,
+    ModbusDevRTU_Callback callback, void* arg);
 extern bool Libmodbus_WriteRegister(ModbusDev* me, int regAddr, int funcCode, unsigned short* data);
+extern bool Libmodbus_WriteMultiple(ModbusDev* me, int regAddr, int funcCode,
+    const unsigned short* values, int count);
+extern bool Libmodbus_WriteAndReadRegisters(ModbusDev* me, int writeAddr,
+    const unsigned short* values, int writeCount,
+    int readAddr, unsigned short* dst, int readCount);
+
+// Poll table executed by RTApp (for the devices of autoPoll)
+extern void Libmodbus_ClearPollTable(void);
+extern int Libmodbus_AddPollEntry(ModbusDev* me, int funcCode, int regAddr, int regCount, uint32_t intervalMs);
+extern bool Libmodbus_LoadPollTable(ModbusDevRTU_PollHandler handler, void* arg);
 
 // Get RTApp Version
 extern bool Libmodbus_GetRTAppVersion(char* rtAppVersion);
@@ -38,15 +38,21 @@
 #include "vector.h"
 
 const char ModbusTcpConfigKey[] = "ModbusTcpConfig";
+const char MaxInFlightKey[] = "maxInFlight";
+const char ConnectTimeoutKey[] = "connectTimeout";
 extern const char PortKey[];
 
 static vector sModbusTcpVec = NULL;
 
 // Add ModbusTcpDev
-static void LibmodbusTcp_AddModbusDev(char* ip, int port) {
+static void LibmodbusTcp_AddModbusDev(char* ip, int port, int maxInFlight,
+    int connectTimeout) {
     ModbusTcpDev* modbusDev;
     modbusDev = ModbusTcpDev_NewModbusTCP(ip, port);
+    ModbusTcpDev_SetMaxInFlight(modbusDev, maxInFlight);
+    ModbusTcpDev_SetConnectTimeout(modbusDev, connectTimeout);
     vector_add_last(sModbusTcpVec, modbusDev);
+    free(modbusDev);  // copied into the vector
 }
 
 // Initialization
@@ -66,10 +72,25 @@ void LibmodbusTcp_ModbusDevDestroy(void) {
 // Clear
 void LibmodbusTcp_ModbusDevClear(void) {
     if (sModbusTcpVec != NULL) {
+        ModbusTcpDev_Destroy(sModbusTcpVec);  // close the connections
         vector_clear(sModbusTcpVec);
     }
 }
 
+// Process the connections on the event loop
+bool LibmodbusTcp_RegisterEventLoop(EventLoop* eventLoop) {
+    return ModbusTCP_RegisterEventLoop(eventLoop);
+}
+
+void LibmodbusTcp_UnregisterEventLoop(void) {
+    ModbusTCP_UnregisterEventLoop();
+}
+
+// Process the requests until all of them complete
+void LibmodbusTcp_WaitIdle(void) {
+    ModbusTCP_WaitIdle();
+}
+
 // Regist
 bool LibmodbusTcp_LoadFromJSON(const json_value* json) {
     json_value* configJson = NULL;
@@ -82,7 +103,9 @@ bool LibmodbusTcp_LoadFromJSON(const json_value* json) {
 
     for (unsigned int i = 0, n = configJson->u.object.length; i < n; ++i) {
         char ip[16];
-        int port;
+        int port = 0;
+        int maxInFlight = 1;
+        int connectTimeout = MODBUS_TCP_DEFAULT_CONNECT_TIMEOUT_MS;
         char* e;
         json_value* configItem = configJson->u.object.values[i].value;
 
@@ -102,18 +125,42 @@ bool LibmodbusTcp_LoadFromJSON(const json_value* json) {
                 else if (item->type == json_string) {
                     port = strtol(item->u.string.ptr, &e, 16);
                 }
-                break;
+            } else if (0 == strcmp(configItem->u.object.values[p].name, MaxInFlightKey)) {
+                json_value* item = configItem->u.object.values[p].value;
+
+                if (item->type == json_integer) {
+                    maxInFlight = (int)item->u.integer;
+                } else if (item->type == json_string) {
+                    maxInFlight = strtol(item->u.string.ptr, &e, 10);
+                }
+                if (maxInFlight < 1 || maxInFlight > MODBUS_TCP_MAX_IN_FLIGHT) {
+                    return false;
+                }
+            } else if (0 == strcmp(configItem->u.object.values[p].name, ConnectTimeoutKey)) {
+                json_value* item = configItem->u.object.values[p].value;
+
+                // [msec]
+                if (item->type == json_integer) {
+                    connectTimeout = (int)item->u.integer;
+                } else if (item->type == json_string) {
+                    connectTimeout = strtol(item->u.string.ptr, &e, 10);
+                }
+                if (connectTimeout < MODBUS_TCP_MIN_CONNECT_TIMEOUT_MS
+                    || connectTimeout > MODBUS_TCP_MAX_CONNECT_TIMEOUT_MS) {
+                    return false;
+                }
             }
         }
         if (port == 0) {
             return false;
         }
-        LibmodbusTcp_AddModbusDev(ip, port);
+        LibmodbusTcp_AddModbusDev(ip, port, maxInFlight, connectTimeout);
     }
 
     return true;
 }
 
+// Get the device and its connection kept open (connected on demand)
 ModbusTcpDev* LibmodbusTcp_GetAndConnectLib(char* id) {
     ModbusTcpDev* modbusDevP = ModbusTcpDev_GetModbusDev(id, sModbusTcpVec);
 
@@ -128,6 +175,20 @@ ModbusTcpDev* LibmodbusTcp_GetAndConnectLib(char* id) {
     return modbusDevP;
 }
 
+ModbusTcpDev* LibmodbusTcp_GetAndConnectLibAsync(char* id) {
+    ModbusTcpDev* modbusDevP = ModbusTcpDev_GetModbusDev(id, sModbusTcpVec);
+
+    if (modbusDevP == NULL) {
+        return NULL;
+    }
+
+    if (!ModbusTcpDev_ConnectAsync(modbusDevP)) {
+        return NULL;
+    }
+
+    return modbusDevP;
+}
+
 void 
 LibmodbusTcp_Disconnect(ModbusTcpDev* me)
 {
@@ -140,3 +201,22 @@ bool LibmodbusTcp_ReadRegister(ModbusTcpDev* me, int unitId, int regAddr, unsign
 bool LibmodbusTcp_WriteRegister(ModbusTcpDev* me, int unitId, int regAddr, unsigned short* data) {
     return ModbusTcpDev_WriteSingleRegister(me, unitId, regAddr, *data);
 }
+bool LibmodbusTcp_ReadRegisters(ModbusTcpDev* me, int unitId, int regAddr, int funcCode,
+    unsigned short* dst, int count) {
+    return ModbusTcpDev_ReadRegisters(me, unitId, regAddr, funcCode, dst, count);
+}
+bool LibmodbusTcp_ReadRegistersAsync(ModbusTcpDev* me, int unitId, int regAddr, int funcCode,
+    unsigned short* dst, int count, ModbusTCP_Callback callback, void* arg) {
+    return ModbusTcpDev_ReadRegistersAsync(me, unitId, regAddr, funcCode, dst, count,
+        callback, arg);
+}
+bool LibmodbusTcp_WriteMultiple(ModbusTcpDev* me, int unitId, int regAddr, int funcCode,
+    const unsigned short* values, int count) {
+    return ModbusTcpDev_WriteMultiple(me, unitId, regAddr, funcCode, values, count);
+}
+bool LibmodbusTcp_WriteAndReadRegisters(ModbusTcpDev* me, int unitId, int writeAddr,
+    const unsigned short* values, int writeCount,
+    int readAddr, unsigned short* dst, int readCount) {
+    return ModbusTcpDev_WriteAndReadRegisters(me, unitId, writeAddr, values, writeCount,
+        readAddr, dst, readCount);
+}
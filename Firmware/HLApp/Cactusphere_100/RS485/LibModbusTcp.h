@@ -37,15 +37,33 @@ extern void LibmodbusTcp_ModbusDevDestroy(void);
 // Clear
 extern void LibmodbusTcp_ModbusDevClear(void);
 
+// Process the connections on the event loop
+extern bool LibmodbusTcp_RegisterEventLoop(EventLoop* eventLoop);
+extern void LibmodbusTcp_UnregisterEventLoop(void);
+
+// Process the requests until all of them complete
+extern void LibmodbusTcp_WaitIdle(void);
+
 // Regist
 extern bool LibmodbusTcp_LoadFromJSON(const json_value* json);
 
 // Connect/Disconnect
 extern ModbusTcpDev* LibmodbusTcp_GetAndConnectLib(char* id);
+// without blocking, the requests are sent after connected
+extern ModbusTcpDev* LibmodbusTcp_GetAndConnectLibAsync(char* id);
 extern void LibmodbusTcp_Disconnect(ModbusTcpDev* me);
 
 // Read/Write register
 extern bool LibmodbusTcp_ReadRegister(ModbusTcpDev* me, int unitId, int regAddr, unsigned short* dst);
 extern bool LibmodbusTcp_WriteRegister(ModbusTcpDev* me, int unitId, int regAddr, unsigned short* data);
+extern bool LibmodbusTcp_ReadRegisters(ModbusTcpDev* me, int unitId, int regAddr, int funcCode,
+    unsigned short* dst, int count);
+extern bool LibmodbusTcp_ReadRegistersAsync(ModbusTcpDev* me, int unitId, int regAddr, int funcCode,
+    unsigned short* dst, int count, ModbusTCP_Callback callback, void* arg);
+extern bool LibmodbusTcp_WriteMultiple(ModbusTcpDev* me, int unitId, int regAddr, int funcCode,
+    const unsigned short* values, int count);
+extern bool LibmodbusTcp_WriteAndReadRegisters(ModbusTcpDev* me, int unitId, int writeAddr,
+    const unsigned short* values, int writeCount,
+    int readAddr, unsigned short* dst, int readCount);
 
 #endif  // _LIBMODBUS_H_
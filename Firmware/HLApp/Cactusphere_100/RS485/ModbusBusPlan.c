@@ -0,0 +1,91 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Atmark Techno, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "ModbusBusPlan.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "LibModbus.h"
+#include "ModbusFetchItem.h"
+#include "ModbusReadBlock.h"
+
+// Bus utilization of the acquisition plan
+uint32_t
+ModbusBusPlan_GetUtilization(vector fetchItemPtrs)
+{
+    ModbusFetchItem**	items = (ModbusFetchItem**)vector_get_data(fetchItemPtrs);
+    int	n = vector_size(fetchItemPtrs);
+    vector	group = vector_init(sizeof(ModbusFetchItem*));
+    vector	blocks = vector_init(sizeof(ModbusReadBlock));
+    bool*	done = (bool*)calloc((size_t)(n > 0 ? n : 1), sizeof(bool));
+    uint64_t	busNsPerSec = 0;  // bus time per second (in nanoseconds)
+
+    if (NULL == group || NULL == blocks || NULL == done) {
+        goto end;
+    }
+
+    // items of a device with same interval are read together (see FetchTimers)
+    for (int i = 0; i < n; ++i) {
+        ModbusDev*	dev;
+        const ModbusReadBlock*	blockCurs;
+
+        if (done[i]) {
+            continue;
+        }
+        vector_clear(group);
+        for (int j = i; j < n; ++j) {
+            if (! done[j] && items[j]->devID == items[i]->devID
+                && items[j]->intervalMs == items[i]->intervalMs) {
+                vector_add_last(group, &items[j]);
+                done[j] = true;
+            }
+        }
+        dev = Libmodbus_GetModbusDev((int)items[i]->devID);
+        if (NULL == dev) {
+            continue;  // never acquired
+        }
+
+        vector_clear(blocks);
+        ModbusReadBlock_Build(group, ModbusDev_GetReadGap(dev), blocks);
+        blockCurs = (const ModbusReadBlock*)vector_get_data(blocks);
+        for (int b = 0, m = vector_size(blocks); b < m; ++b, ++blockCurs) {
+            busNsPerSec += (uint64_t)ModbusDev_EstimateReadUs(dev,
+                (int)blockCurs->funcCode, (int)blockCurs->regCount) * 1000 * 1000
+                / items[i]->intervalMs;
+        }
+    }
+
+end:
+    free(done);
+    if (NULL != blocks) {
+        vector_destroy(blocks);
+    }
+    if (NULL != group) {
+        vector_destroy(group);
+    }
+
+    // permille of 1 second, rounded up
+    return (uint32_t)((busNsPerSec + 999999) / 1000000);
+}
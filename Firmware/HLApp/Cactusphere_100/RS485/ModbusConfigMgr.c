@@ -33,8 +33,12 @@
 
 #include "json.h"
 #include "LibModbus.h"
+#include "ModbusBusPlan.h"
 #include "ModbusFetchConfig.h"
+#include "ModbusRegImage.h"
+#include "ModbusTcpServer.h"
 #include "PropertyItems.h"
+#include "SendRTApp.h"
 
 typedef struct ModbusConfigMgr {
     ModbusFetchConfig* fetchConfig;
@@ -42,6 +46,110 @@ typedef struct ModbusConfigMgr {
 
 static ModbusConfigMgr sModbusConfigMgr;
 
+// Load a unit exposed by the local Modbus TCP server
+//   {"unit": 1, "devId": 1} for the RTU device, or
+//   {"unit": 11, "ipAddr": "192.168.0.10", "port": 502, "unitId": 1}
+//   for the unit of the Modbus TCP server (port is optional)
+static bool
+ModbusConfigMgr_LoadServerUnit(const json_value* json, ModbusTcpServerUnit* unit)
+{
+    const char* ipAddr = NULL;
+    uint32_t port = MODBUS_TCP_SERVER_DEFAULT_PORT;
+    bool hasUnit = false;
+    bool hasSourceUnit = false;
+    bool isRTU = false;
+
+    if (json->type != json_object) {
+        return false;
+    }
+    for (unsigned int i = 0, n = json->u.object.length; i < n; ++i) {
+        const char* name = json->u.object.values[i].name;
+        const json_value* item = json->u.object.values[i].value;
+
+        if (0 == strcmp(name, "unit")) {
+            hasUnit = json_GetNumericValue(item, &unit->unitId, 10);
+        } else if (0 == strcmp(name, "devId")) {
+            hasSourceUnit = json_GetNumericValue(item, &unit->sourceUnitId, 10);
+            isRTU = true;
+        } else if (0 == strcmp(name, "unitId")) {
+            hasSourceUnit = json_GetNumericValue(item, &unit->sourceUnitId, 10);
+        } else if (0 == strcmp(name, "ipAddr")) {
+            if (item->type != json_string || item->u.string.length > 15) {
+                return false;
+            }
+            ipAddr = item->u.string.ptr;
+        } else if (0 == strcmp(name, "port")) {
+            if (!json_GetNumericValue(item, &port, 10) || port < 1 || port > 65535) {
+                return false;
+            }
+        }
+    }
+    if (!hasUnit || unit->unitId > 255 || !hasSourceUnit || isRTU == (ipAddr != NULL)) {
+        return false;
+    }
+    if (isRTU) {
+        strcpy(unit->source, MODBUS_REG_IMAGE_SOURCE_RTU);
+    } else {
+        // same as the ID of the server in ModbusTcpDataFetchScheduler
+        snprintf(unit->source, sizeof(unit->source), "%s:%u", ipAddr, port);
+    }
+
+    return true;
+}
+
+// Start the local Modbus TCP server by the configuration
+//   {"port": 502, "maxAge": 60, "units": [...]}, all are optional
+//   (maxAge 0: not limited, without units: the RTU devices by devID)
+static bool
+ModbusConfigMgr_StartServer(const json_value* json)
+{
+    uint32_t port = MODBUS_TCP_SERVER_DEFAULT_PORT;
+    uint32_t maxAge = 0;
+    vector units = NULL;
+    bool isOK = false;
+
+    if (json->type != json_object) {
+        return false;
+    }
+    for (unsigned int i = 0, n = json->u.object.length; i < n; ++i) {
+        const json_value* item = json->u.object.values[i].value;
+
+        if (0 == strcmp(json->u.object.values[i].name, "port")) {
+            if (!json_GetNumericValue(item, &port, 10) || port < 1 || port > 65535) {
+                goto end;
+            }
+        } else if (0 == strcmp(json->u.object.values[i].name, "maxAge")) {
+            if (!json_GetNumericValue(item, &maxAge, 10)) {
+                goto end;
+            }
+        } else if (0 == strcmp(json->u.object.values[i].name, "units")) {
+            if (item->type != json_array || units != NULL) {
+                goto end;
+            }
+            units = vector_init(sizeof(ModbusTcpServerUnit));
+            if (units == NULL) {
+                goto end;
+            }
+            for (unsigned int j = 0; j < item->u.array.length; ++j) {
+                ModbusTcpServerUnit unit;
+
+                memset(&unit, 0, sizeof(unit));
+                if (!ModbusConfigMgr_LoadServerUnit(item->u.array.values[j], &unit)) {
+                    goto end;
+                }
+                vector_add_last(units, &unit);
+            }
+        }
+    }
+    isOK = ModbusTcpServer_Start((int)port, maxAge, units);
+
+end:
+    if (units != NULL) {
+        vector_destroy(units);
+    }
+    return isOK;
+}
+
 // Initialization and cleanup
 void
 ModbusConfigMgr_Initialize(void)
@@ -53,8 +161,10 @@ ModbusConfigMgr_Initialize(void)
 void
 ModbusConfigMgr_Cleanup(void)
 {
+    ModbusTcpServer_Stop();
     ModbusFetchConfig_Destroy(sModbusConfigMgr.fetchConfig);
     Libmodbus_ModbusDevDestroy();
+    ModbusRegImage_Cleanup();
 }
 
 // Apply new configuration
@@ -67,21 +177,30 @@ ModbusConfigMgr_LoadAndApplyIfChanged(const unsigned char* payload,
     json_value* desiredObj = NULL;
     json_value* modbusConfObj = NULL;
     json_value* telemetryConfObj = NULL;
+    json_value* serverConfObj = NULL;
 
     desiredObj = json_GetKeyJson("desired", jsonObj);
     if (desiredObj == NULL) {
         modbusConfObj = json_GetKeyJson("ModbusDevConfig", jsonObj);
         telemetryConfObj = json_GetKeyJson("ModbusTelemetryConfig", jsonObj);
+        serverConfObj = json_GetKeyJson("ModbusServerConfig", jsonObj);
     } else {
         modbusConfObj = json_GetKeyJson("ModbusDevConfig", desiredObj);
         telemetryConfObj = json_GetKeyJson("ModbusTelemetryConfig", desiredObj);
+        serverConfObj = json_GetKeyJson("ModbusServerConfig", desiredObj);
     }
 
-    if (modbusConfObj == NULL && telemetryConfObj == NULL && desiredObj && desiredObj->u.object.length > 1) {
+    if (modbusConfObj == NULL && telemetryConfObj == NULL && serverConfObj == NULL
+        && desiredObj && desiredObj->u.object.length > 1) {
         ret = UNSUPPORTED_PROPERTY;
         goto end;
     }
 
+    // the data acquisition in progress refers the devices and fetch items
+    if (modbusConfObj != NULL || telemetryConfObj != NULL) {
+        SendRTApp_WaitIdle();
+    }
+
     if (modbusConfObj != NULL) {
         if (modbusConfObj->type == json_null) {
             PropertyItems_AddItem(item, "ModbusDevConfig", TYPE_NULL);
@@ -127,6 +246,41 @@ ModbusConfigMgr_LoadAndApplyIfChanged(const unsigned char* payload,
         }
     }
 
+    if (serverConfObj != NULL) {
+        if (serverConfObj->type == json_null) {
+            PropertyItems_AddItem(item, "ModbusServerConfig", TYPE_NULL);
+            ModbusTcpServer_Stop();
+        } else {
+            if (serverConfObj->type != json_string) {
+                serverConfObj = json_GetKeyJson("value", serverConfObj);
+            }
+            PropertyItems_AddItem(item, "ModbusServerConfig", TYPE_STR, serverConfObj->u.string.ptr);
+            serverConfObj = json_parse(serverConfObj->u.string.ptr, serverConfObj->u.string.length);
+            if (serverConfObj == NULL || !ModbusConfigMgr_StartServer(serverConfObj)) {
+                Log_Debug("ModbusServerConfig error!\n");
+                ret = ILLEGAL_PROPERTY;
+            }
+        }
+    }
+
+    // estimate the bus time of the applied configuration (the devices or
+    // the items are changed), warn only: an over-subscribed configuration
+    // is applied and reported by ModbusBusUtilization and the log
+    if (modbusConfObj != NULL || telemetryConfObj != NULL) {
+        uint32_t utilization = ModbusBusPlan_GetUtilization(
+            ModbusFetchConfig_GetFetchItemPtrs(sModbusConfigMgr.fetchConfig));
+
+        // the registers of the old configuration are no longer acquired
+        ModbusRegImage_Clear();
+
+        PropertyItems_AddItem(item, "ModbusBusUtilization", TYPE_NUM,
+            (utilization + 9) / 10);  // in percent
+        if (utilization > MODBUS_BUS_FULL_UTILIZATION) {
+            Log_Debug("ModbusTelemetryConfig over-subscribes the bus (%u.%u%%), applied anyway!\n",
+                utilization / 10, utilization % 10);
+        }
+    }
+
 end:
     return ret;
 }
@@ -22,6 +22,8 @@
  * THE SOFTWARE.
  */
 
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "ModbusDataFetchScheduler.h"
@@ -30,31 +32,80 @@
 #include "ModbusFetchItem.h"
 #include "ModbusFetchTargets.h"
 #include "ModbusDevConfig.h"
+#include "ModbusReadBlock.h"
+#include "ModbusRegImage.h"
 #include "StringBuf.h"
 #include "TelemetryItems.h"
+#include "UartDriveMsg.h"
 
 #define  MODBUS_ONESHOT_COMMAND_PARAM_NUM 4
+#define  MODBUS_ONESHOT_COMMAND_RW_PARAM_NUM 6  // FC23 (with readAddr and readCount)
 
 typedef struct ModbusDataFetchScheduler {
     DataFetchSchedulerBase	Super;
 
     // data member
     ModbusFetchTargets*	mFetchTargets;  // acquisition targets of Modbus RTU
+    vector	mReadBlocks;                // vector of ModbusReadBlock (work area)
+    vector	mReadRequests;              // vector of ModbusReadRequest (work area)
+    vector	mDevIDs;                    // vector of devID in polling order (work area)
+    int	mDevIndex;                      // index of mDevIDs in acquisition
+    ModbusDev*	mCurDev;                // device in acquisition
+    bool	mBusy;                      // acquisition in progress
+    bool	mInDoSchedule;              // in DoSchedule (telemetry is sent by caller)
+    vector	mPollItems;                 // vector of ModbusFetchItem* polled by RTApp
+    vector	mPollBlocks;                // vector of ModbusReadBlock (index of poll table entry)
+    vector	mPollGroup;                 // vector of ModbusFetchItem* (work area)
+    TelemetryItems*	mPolledItems;       // latest results pushed by RTApp
 } ModbusDataFetchScheduler;
 
+static void ModbusDataFetchScheduler_StartNextDev(ModbusDataFetchScheduler* self);
+
 //
 // DataFetchScheduler's private procedure/method
 //
 // Callback procedure of FetchTimers
+static bool
+ModbusDataFetchScheduler_IsPolledByRTApp(ModbusDataFetchScheduler* self,
+    const ModbusFetchItem* item)
+{
+    const ModbusFetchItem** curs = (const ModbusFetchItem**)vector_get_data(self->mPollItems);
+
+    for (int i = 0, n = vector_size(self->mPollItems); i < n; i++) {
+        if (curs[i] == item) {
+            return true;
+        }
+    }
+    return false;
+}
+
 static void
 ModbusFetchTimerCallback(void* arg, const FetchItemBase* fetchTarget)
 {
     ModbusDataFetchScheduler* scheduler = (ModbusDataFetchScheduler*)arg;
 
+    if (ModbusDataFetchScheduler_IsPolledByRTApp(
+            scheduler, (const ModbusFetchItem*)fetchTarget)) {
+        return;  // acquired by RTApp autonomously
+    }
     ModbusFetchTargets_Add(
         scheduler->mFetchTargets, (const ModbusFetchItem*)fetchTarget);
 }
 
+// Comparator to poll devices of same line parameters consecutively
+static int
+ModbusDataFetchScheduler_CompareDevID(const void* lhs, const void* rhs)
+{
+    unsigned long	devID1 = *(const unsigned long*)lhs;
+    unsigned long	devID2 = *(const unsigned long*)rhs;
+    int	ret = Libmodbus_CompareLineParams((int)devID1, (int)devID2);
+
+    if (ret == 0 && devID1 != devID2) {
+        ret = (devID1 < devID2) ? -1 : 1;
+    }
+    return ret;
+}
+
 // Virtual method
 static void
 ModbusDataFetchScheduler_DoDestroy(DataFetchSchedulerBase* me)
@@ -62,6 +113,17 @@ ModbusDataFetchScheduler_DoDestroy(DataFetchSchedulerBase* me)
     ModbusDataFetchScheduler*	self = (ModbusDataFetchScheduler*)me;
 
     ModbusFetchTargets_Destroy(self->mFetchTargets);
+    vector_destroy(self->mReadBlocks);
+    vector_destroy(self->mReadRequests);
+    vector_destroy(self->mDevIDs);
+
+    // stop polling by RTApp
+    Libmodbus_ClearPollTable();
+    (void)Libmodbus_LoadPollTable(NULL, NULL);
+    vector_destroy(self->mPollItems);
+    vector_destroy(self->mPollBlocks);
+    vector_destroy(self->mPollGroup);
+    TelemetryItems_Destroy(self->mPolledItems);
 }
 
 static void
@@ -72,76 +134,365 @@ ModbusDataFetchScheduler_ClearFetchTargets(DataFetchSchedulerBase* me)
     ModbusFetchTargets_Clear(self->mFetchTargets);
 }
 
+static void
+ModbusDataFetchScheduler_AddTelemetry(DataFetchSchedulerBase* me,
+    TelemetryItems* dst, const ModbusFetchItem* item, const unsigned short* readVal)
+{
+    unsigned long tmpVal  = 0;
+
+    if (item->regCount == 2) {
+        tmpVal = (unsigned long)((readVal[0] << 16) + readVal[1]);
+    } else {
+        tmpVal = readVal[0];
+    }
+
+    if (item->asFloat) {
+        double fVal = tmpVal;
+
+        fVal += item->offset;
+        if (item->multiplier != 0) {
+            fVal *= item->multiplier;
+        }
+        if (item->devider != 0) {
+            fVal /= item->devider;
+        }
+        StringBuf_AppendByPrintf(me->mStringBuf, "%f", fVal);
+    } else {
+        unsigned long ulVal = tmpVal;
+
+        ulVal += item->offset;
+        if (item->multiplier != 0) {
+            ulVal *= item->multiplier;
+        }
+        if (item->devider != 0) {
+            ulVal /= item->devider;
+        }
+
+        StringBuf_AppendByPrintf(me->mStringBuf, "%ld", ulVal);
+    }
+
+    TelemetryItems_Set(dst,
+        item->telemetryName, StringBuf_GetStr(me->mStringBuf));
+    StringBuf_Clear(me->mStringBuf);
+}
+
+// Slice the value of the item from the read values of the block
+static void
+ModbusDataFetchScheduler_AddBlockItem(DataFetchSchedulerBase* me,
+    TelemetryItems* dst, const ModbusFetchItem* item,
+    const ModbusReadBlock* block, const unsigned short* values)
+{
+    uint32_t	offset = item->regAddr - block->regAddr;
+
+    if (MODBUS_IS_BIT_READ(item->funcCode)) {
+        // bits are packed LSB first
+        unsigned short	bit = (unsigned short)((values[offset >> 4] >> (offset & 15)) & 1);
+
+        ModbusDataFetchScheduler_AddTelemetry(me, dst, item, &bit);
+    } else {
+        ModbusDataFetchScheduler_AddTelemetry(me, dst, item, &values[offset]);
+    }
+}
+
+// Result of the poll table entry pushed by RTApp
+static void
+ModbusDataFetchScheduler_OnPolled(void* arg, int entryIndex, const unsigned short* values)
+{
+    ModbusDataFetchScheduler* self = (ModbusDataFetchScheduler*)arg;
+    const ModbusFetchItem** fiTop = (const ModbusFetchItem**)vector_get_data(self->mPollItems);
+    const ModbusReadBlock*	block;
+
+    if (values == NULL || entryIndex >= vector_size(self->mPollBlocks)) {
+        // error!
+        return;
+    }
+    block = (const ModbusReadBlock*)vector_get_data(self->mPollBlocks) + entryIndex;
+    ModbusRegImage_Update(MODBUS_REG_IMAGE_SOURCE_RTU, fiTop[block->firstItem]->devID,
+        block->funcCode, block->regAddr, block->regCount, values);
+
+    // keep the latest values until next period
+    for (int k = 0; k < block->itemCount; ++k) {
+        const ModbusFetchItem* item = fiTop[block->firstItem + k];
+
+        ModbusDataFetchScheduler_AddBlockItem(&self->Super, self->mPolledItems,
+            item, block, values);
+    }
+}
+
+static void
+ModbusDataFetchScheduler_DoInit(DataFetchSchedulerBase* me, vector fetchItemPtrs)
+{
+    // build poll table of the devices of autoPoll and load it to RTApp,
+    // the items are grouped by device and interval, then merged into blocks
+    ModbusDataFetchScheduler* self = (ModbusDataFetchScheduler*)me;
+    const ModbusFetchItem** fiTop = (const ModbusFetchItem**)vector_get_data(fetchItemPtrs);
+    int	itemNum = vector_size(fetchItemPtrs);
+
+    vector_clear(self->mPollItems);
+    vector_clear(self->mPollBlocks);
+    TelemetryItems_Clear(self->mPolledItems);
+    Libmodbus_ClearPollTable();
+
+    for (int i = 0; i < itemNum; ++i) {
+        const ModbusFetchItem*	first = fiTop[i];
+        ModbusDev*	modbusdev = Libmodbus_GetModbusDev((int)first->devID);
+        const ModbusReadBlock*	blockCurs;
+        bool	isGrouped = false;
+
+        if (modbusdev == NULL || ! ModbusDev_GetAutoPoll(modbusdev)) {
+            continue;
+        }
+        if (first->intervalMs % UART_TICK_MS != 0) {
+            continue;  // finer than the tick of RTApp, acquired by HLApp
+        }
+        for (int j = 0; j < i && ! isGrouped; ++j) {
+            isGrouped = (fiTop[j]->devID == first->devID
+                && fiTop[j]->intervalMs == first->intervalMs);
+        }
+        if (isGrouped) {
+            continue;  // already in the poll table
+        }
+
+        vector_clear(self->mPollGroup);
+        for (int j = i; j < itemNum; ++j) {
+            if (fiTop[j]->devID == first->devID
+                && fiTop[j]->intervalMs == first->intervalMs) {
+                vector_add_last(self->mPollGroup, &fiTop[j]);
+            }
+        }
+        vector_clear(self->mReadBlocks);
+        ModbusReadBlock_Build(self->mPollGroup,
+            ModbusDev_GetReadGap(modbusdev), self->mReadBlocks);
+        blockCurs = (const ModbusReadBlock*)vector_get_data(self->mReadBlocks);
+
+        for (int j = 0, n = vector_size(self->mReadBlocks); j < n; ++j, ++blockCurs) {
+            ModbusReadBlock	block = *blockCurs;
+
+            if (0 > Libmodbus_AddPollEntry(modbusdev, (int)block.funcCode,
+                    (int)block.regAddr, (int)block.regCount, first->intervalMs)) {
+                break;  // poll table is full, the rest is acquired by HLApp
+            }
+            vector_add_last_multi(self->mPollItems,
+                (const ModbusFetchItem**)vector_get_data(self->mPollGroup) + block.firstItem,
+                block.itemCount);
+            block.firstItem = vector_size(self->mPollItems) - block.itemCount;
+            vector_add_last(self->mPollBlocks, &block);
+        }
+    }
+
+    if (! Libmodbus_LoadPollTable(ModbusDataFetchScheduler_OnPolled, self)) {
+        // RTApp doesn't support poll table, acquire all the items by HLApp
+        vector_clear(self->mPollItems);
+        vector_clear(self->mPollBlocks);
+    }
+}
+
+// Completion of register reading of the device in acquisition
+static void
+ModbusDataFetchScheduler_OnRead(void* arg, bool result)
+{
+    ModbusDataFetchScheduler* self = (ModbusDataFetchScheduler*)arg;
+    unsigned long	devID = ((unsigned long*)vector_get_data(self->mDevIDs))[self->mDevIndex];
+    vector	fetchItems = ModbusFetchTargets_GetFetchItems(self->mFetchTargets, devID);
+    const ModbusFetchItem** fiTop = (const ModbusFetchItem**)vector_get_data(fetchItems);
+    const ModbusReadBlock*	blockCurs = (const ModbusReadBlock*)vector_get_data(self->mReadBlocks);
+    const ModbusReadRequest*	reqCurs = (const ModbusReadRequest*)vector_get_data(self->mReadRequests);
+    bool	isProbe = ModbusDev_IsDown(self->mCurDev);
+
+    if (result) {
+        // update health of the device by the transactions
+        bool	responded = false;
+
+        for (int j = 0, n = vector_size(self->mReadRequests); j < n; ++j) {
+            responded |= reqCurs[j].responded;
+        }
+        ModbusDev_ReportResponse(self->mCurDev, responded);
+    }
+    if (isProbe) {
+        // the probe has no telemetry, acquired from the next period if recovered
+        self->mDevIndex++;
+        ModbusDataFetchScheduler_StartNextDev(self);
+        return;
+    }
+
+    for (int j = 0, blockNum = vector_size(self->mReadBlocks); j < blockNum;
+            ++j, ++blockCurs, ++reqCurs) {
+        if (! reqCurs->result) {
+            // error!
+            continue;
+        }
+        ModbusRegImage_Update(MODBUS_REG_IMAGE_SOURCE_RTU, fiTop[blockCurs->firstItem]->devID,
+            blockCurs->funcCode, blockCurs->regAddr, blockCurs->regCount, reqCurs->values);
+
+        // slice the block into telemetry items
+        for (int k = 0; k < blockCurs->itemCount; ++k) {
+            const ModbusFetchItem* item = fiTop[blockCurs->firstItem + k];
+
+            ModbusDataFetchScheduler_AddBlockItem(&self->Super,
+                self->Super.mTelemetryItems, item, blockCurs, reqCurs->values);
+        }
+    }
+
+    self->mDevIndex++;
+    ModbusDataFetchScheduler_StartNextDev(self);
+}
+
+// Completion of connecting to the device in acquisition
+static void
+ModbusDataFetchScheduler_OnConnected(void* arg, bool result)
+{
+    ModbusDataFetchScheduler* self = (ModbusDataFetchScheduler*)arg;
+
+    if (! result) {
+        self->mDevIndex++;
+        ModbusDataFetchScheduler_StartNextDev(self);
+        return;
+    }
+
+    // requests of the device are sent to RTApp at once
+    Libmodbus_ReadRegisterBatchAsync(self->mCurDev,
+        (ModbusReadRequest*)vector_get_data(self->mReadRequests),
+        vector_size(self->mReadRequests),
+        ModbusDataFetchScheduler_OnRead, self);
+}
+
+// Start acquisition of the next device, or finish the period
+static void
+ModbusDataFetchScheduler_StartNextDev(ModbusDataFetchScheduler* self)
+{
+    for (int n = vector_size(self->mDevIDs); self->mDevIndex < n; self->mDevIndex++) {
+        unsigned long	devID = ((unsigned long*)vector_get_data(self->mDevIDs))[self->mDevIndex];
+        vector	fetchItems = ModbusFetchTargets_GetFetchItems(
+            self->mFetchTargets, devID);
+        const ModbusReadBlock*	blockCurs;
+        int	blockNum;
+
+        self->mCurDev = Libmodbus_GetModbusDev((int)devID);
+        if (self->mCurDev == NULL) {
+            continue;
+        }
+        if (ModbusDev_IsDown(self->mCurDev) && ! ModbusDev_IsProbeDue(self->mCurDev)) {
+            continue;  // not responding, skipped until the next probe
+        }
+
+        // merge the items into contiguous register ranges
+        // and acquire each range by one request
+        vector_clear(self->mReadBlocks);
+        ModbusReadBlock_Build(fetchItems,
+            ModbusDev_GetReadGap(self->mCurDev), self->mReadBlocks);
+        blockCurs = (const ModbusReadBlock*)vector_get_data(self->mReadBlocks);
+        blockNum = vector_size(self->mReadBlocks);
+        if (blockNum == 0) {
+            continue;
+        }
+
+        vector_clear(self->mReadRequests);
+        for (int j = 0; j < blockNum; ++j) {
+            ModbusReadRequest	req = {
+                .regAddr  = (int)blockCurs[j].regAddr,
+                .funcCode = (int)blockCurs[j].funcCode,
+                .regCount = (int)blockCurs[j].regCount,
+                .result   = false,
+            };
+
+            if (ModbusDev_IsDown(self->mCurDev)) {
+                // probe the down device by one register (or bit)
+                req.regCount = 1;
+                vector_add_last(self->mReadRequests, &req);
+                break;
+            }
+            vector_add_last(self->mReadRequests, &req);
+        }
+
+        // continued by ModbusDataFetchScheduler_OnConnected()
+        Libmodbus_ConnectAsync(self->mCurDev,
+            ModbusDataFetchScheduler_OnConnected, self);
+        return;
+    }
+
+    // all the devices are done
+    self->mCurDev = NULL;
+    self->mBusy = false;
+    if (! self->mInDoSchedule) {
+        DataFetchScheduler_SendTelemetry(&self->Super);
+    }
+}
+
 static void
 ModbusDataFetchScheduler_DoSchedule(DataFetchSchedulerBase* me)
 {
     ModbusDataFetchScheduler* self = (ModbusDataFetchScheduler*)me;
     vector	devIDs;
 
+    // results pushed by RTApp since the last period
+    TelemetryItems_Append(me->mTelemetryItems, self->mPolledItems);
+    TelemetryItems_Clear(self->mPolledItems);
+
     devIDs = ModbusFetchTargets_GetDevIDs(self->mFetchTargets);
     if (!vector_is_empty(devIDs)) {
-        unsigned long* devIDCurs = (unsigned long*)vector_get_data(devIDs);
+        // group the devices by line parameters to avoid reconfiguring UART
+        vector_clear(self->mDevIDs);
+        vector_add_last_multi(self->mDevIDs,
+            vector_get_data(devIDs), vector_size(devIDs));
+        qsort(vector_get_data(self->mDevIDs), (size_t)vector_size(self->mDevIDs),
+            sizeof(unsigned long), ModbusDataFetchScheduler_CompareDevID);
+
+        // acquire the devices one by one without blocking the event loop,
+        // telemetry is sent on completion
+        self->mDevIndex = 0;
+        self->mBusy = true;
+        self->mInDoSchedule = true;
+        ModbusDataFetchScheduler_StartNextDev(self);
+        self->mInDoSchedule = false;
+    }
+}
+
+static bool
+ModbusDataFetchScheduler_IsBusy(DataFetchSchedulerBase* me)
+{
+    ModbusDataFetchScheduler* self = (ModbusDataFetchScheduler*)me;
 
-        for (int i = 0, n = vector_size(devIDs); i < n; i++) {
-            unsigned long	devID = *devIDCurs++;
-            vector	fetchItems = ModbusFetchTargets_GetFetchItems(
-                self->mFetchTargets, devID);
-            const ModbusFetchItem** fiCurs =
-                (const ModbusFetchItem**)vector_get_data(fetchItems);
+    return self->mBusy;
+}
 
-            ModbusDev* modbusdev = Libmodbus_GetAndConnectLib((int)devID);
+// Parse "data" of the oneshot command, a value or an array of values
+//   values of FC15 are packed into bits LSB first
+static bool
+ModbusOneshotcommand_ParseData(const json_value* item, uint32_t funcCode,
+    unsigned short* values, int* count)
+{
+    int maxCount = MODBUS_MAX_WRITE_REGISTERS;
+    int n = 1;
 
-            if (modbusdev == NULL) {
-                continue;
-            }
+    if (funcCode == FC_WRITE_MULTIPLE_COILS) {
+        maxCount = MODBUS_MAX_WRITE_BITS;
+        memset(values, 0, sizeof(unsigned short) * MODBUS_MAX_WRITE_REGISTERS);
+    }
+    if (item->type == json_array) {
+        n = (int)item->u.array.length;
+    }
+    if (n < 1 || n > maxCount) {
+        return false;
+    }
+
+    for (int i = 0; i < n; ++i) {
+        const json_value* elem = (item->type == json_array) ? item->u.array.values[i] : item;
+        uint32_t value;
 
-            for (int j = 0, m = vector_size(fetchItems); j < m; ++j) {
-                const ModbusFetchItem* item = *fiCurs++;
-                unsigned short readVal[2] = { 0 };
-
-                if (!Libmodbus_ReadRegister(modbusdev, (int)item->regAddr, (int)item->funcCode, readVal, (int)item->regCount)) {
-                    // error!
-                    continue;
-                }
-
-                unsigned long tmpVal  = 0;
-                if (item->regCount == 2) {
-                    tmpVal = (unsigned long)((readVal[0] << 16) + readVal[1]);
-                } else {
-                    tmpVal = readVal[0];
-                }
-
-                if (item->asFloat) {
-                    double fVal = tmpVal;
-
-                    fVal += item->offset;
-                    if (item->multiplier != 0) {
-                        fVal *= item->multiplier;
-                    }
-                    if (item->devider != 0) {
-                        fVal /= item->devider;
-                    }
-                    StringBuf_AppendByPrintf(me->mStringBuf, "%f", fVal);
-                } else {
-                    unsigned long ulVal = tmpVal;
-
-                    ulVal += item->offset;
-                    if (item->multiplier != 0) {
-                        ulVal *= item->multiplier;
-                    }
-                    if (item->devider != 0) {
-                        ulVal /= item->devider;
-                    }
-
-                    StringBuf_AppendByPrintf(me->mStringBuf, "%ld", ulVal);
-                }
-
-                TelemetryItems_Add(me->mTelemetryItems,
-                    item->telemetryName, StringBuf_GetStr(me->mStringBuf));
-                StringBuf_Clear(me->mStringBuf);
+        if (!json_GetNumericValue(elem, &value, 16)) {
+            return false;
+        }
+        if (funcCode == FC_WRITE_MULTIPLE_COILS) {
+            if (value != 0) {
+                values[i >> 4] |= (unsigned short)(1 << (i & 15));
             }
+        } else {
+            values[i] = (unsigned short)value;
         }
     }
+    *count = n;
+
+    return true;
 }
 
 void ModbusOneshotcommand(const unsigned char* payload, size_t size, char* response) {
@@ -149,15 +500,24 @@ void ModbusOneshotcommand(const unsigned char* payload, size_t size, char* respo
     const char RegisterAddrKey[]    = "registerAddr";
     const char FuncCodeKey[]        = "funcCode";
     const char DataKey[]            = "data";
+    const char ReadAddrKey[]        = "readAddr";
+    const char ReadCountKey[]       = "readCount";
 
     uint32_t devID = 0;
     uint32_t regAddr = 0;
     uint32_t funcCode = 0;
-    uint16_t data = 0;
+    uint32_t readAddr = 0;
+    uint32_t readCount = 0;
+    const json_value* dataItem = NULL;
+    unsigned short data[MODBUS_MAX_WRITE_REGISTERS];
+    unsigned short readData[MODBUS_MAX_READ_REGISTERS];
+    int dataCount = 0;
+    unsigned int paramNum = MODBUS_ONESHOT_COMMAND_PARAM_NUM;
+    bool result;
 
     json_value* jsonObj = json_parse(payload, size);
     json_value* configItem = json_parse(jsonObj->u.string.ptr, jsonObj->u.string.length);
-    if (!configItem || configItem->u.object.length != MODBUS_ONESHOT_COMMAND_PARAM_NUM) {
+    if (!configItem) {
         strcpy(response, "\"Illegal config\"");
         return;
     }
@@ -185,24 +545,61 @@ void ModbusOneshotcommand(const unsigned char* payload, size_t size, char* respo
                 return;
             }
         } else if (0 == strcmp(configItem->u.object.values[i].name, DataKey)) {
+            dataItem = configItem->u.object.values[i].value;
+        } else if (0 == strcmp(configItem->u.object.values[i].name, ReadAddrKey)) {
             json_value* item = configItem->u.object.values[i].value;
-            uint32_t value;
-            bool ret = json_GetNumericValue(item, &value, 16);
+            bool ret = json_GetNumericValue(item, &readAddr, 16);
             if (!ret) {
-                strcpy(response, "\"Illegal data\"");
+                strcpy(response, "\"Illegal readAddr\"");
+                return;
+            }
+        } else if (0 == strcmp(configItem->u.object.values[i].name, ReadCountKey)) {
+            json_value* item = configItem->u.object.values[i].value;
+            bool ret = json_GetNumericValue(item, &readCount, 16);
+            if (!ret || readCount < 1 || readCount > MODBUS_MAX_READ_REGISTERS) {
+                strcpy(response, "\"Illegal readCount\"");
                 return;
-            } else {
-                data = (uint16_t)value;
             }
         }
     }
 
     // funcCode check
-    if ((funcCode != FC_WRITE_FORCE_SINGLE_COIL) &&
-        (funcCode != FC_WRITE_SINGLE_REGISTER)) {
+    switch (funcCode) {
+    case FC_WRITE_FORCE_SINGLE_COIL:
+    case FC_WRITE_SINGLE_REGISTER:
+    case FC_WRITE_MULTIPLE_COILS:
+    case FC_WRITE_MULTIPLE_REGISTERS:
+        break;
+    case FC_READ_WRITE_MULTIPLE_REGISTERS:
+        paramNum = MODBUS_ONESHOT_COMMAND_RW_PARAM_NUM;
+        break;
+    default:
         strcpy(response, "\"Illegal funcCode\"");
         return;
     }
+    if (configItem->u.object.length != paramNum) {
+        strcpy(response, "\"Illegal config\"");
+        return;
+    }
+
+    // data check
+    if (dataItem == NULL) {
+        strcpy(response, "\"Illegal data\"");
+        return;
+    }
+    if (funcCode == FC_WRITE_FORCE_SINGLE_COIL || funcCode == FC_WRITE_SINGLE_REGISTER) {
+        uint32_t value;
+        if (!json_GetNumericValue(dataItem, &value, 16)) {
+            strcpy(response, "\"Illegal data\"");
+            return;
+        }
+        data[0] = (uint16_t)value;
+    } else if (!ModbusOneshotcommand_ParseData(dataItem, funcCode, data, &dataCount)
+        || (funcCode == FC_READ_WRITE_MULTIPLE_REGISTERS
+            && dataCount > MODBUS_MAX_RW_WRITE_REGISTERS)) {
+        strcpy(response, "\"Illegal data\"");
+        return;
+    }
 
     ModbusDev* modbusdev = Libmodbus_GetAndConnectLib((int)devID);
     if (modbusdev == NULL) {
@@ -210,7 +607,33 @@ void ModbusOneshotcommand(const unsigned char* payload, size_t size, char* respo
         return;
     }
 
-    if (Libmodbus_WriteRegister(modbusdev, (int)regAddr, (int)funcCode, &data)) {
+    switch (funcCode) {
+    case FC_WRITE_MULTIPLE_COILS:
+    case FC_WRITE_MULTIPLE_REGISTERS:
+        result = Libmodbus_WriteMultiple(modbusdev, (int)regAddr, (int)funcCode,
+            data, dataCount);
+        break;
+    case FC_READ_WRITE_MULTIPLE_REGISTERS:
+        result = Libmodbus_WriteAndReadRegisters(modbusdev, (int)regAddr, data, dataCount,
+            (int)readAddr, readData, (int)readCount);
+        if (result) {
+            // return the read values as JSON array
+            char* curs = response;
+
+            *curs++ = '[';
+            for (uint32_t i = 0; i < readCount; ++i) {
+                curs += sprintf(curs, (i == 0) ? "%u" : ",%u", readData[i]);
+            }
+            strcpy(curs, "]");
+            return;
+        }
+        break;
+    default:
+        result = Libmodbus_WriteRegister(modbusdev, (int)regAddr, (int)funcCode, &data[0]);
+        break;
+    }
+
+    if (result) {
         strcpy(response, "\"Success\"");
     } else {
         strcpy(response, "\"Error\"");
@@ -236,12 +659,57 @@ ModbusDataFetchScheduler_New(void)
         if (NULL == newObj->mFetchTargets) {
             goto err_delete_super;
         }
+        newObj->mReadBlocks = vector_init(sizeof(ModbusReadBlock));
+        if (NULL == newObj->mReadBlocks) {
+            ModbusFetchTargets_Destroy(newObj->mFetchTargets);
+            goto err_delete_super;
+        }
+        newObj->mReadRequests = vector_init(sizeof(ModbusReadRequest));
+        if (NULL == newObj->mReadRequests) {
+            vector_destroy(newObj->mReadBlocks);
+            ModbusFetchTargets_Destroy(newObj->mFetchTargets);
+            goto err_delete_super;
+        }
+        newObj->mDevIDs = vector_init(sizeof(unsigned long));
+        if (NULL == newObj->mDevIDs) {
+            vector_destroy(newObj->mReadRequests);
+            vector_destroy(newObj->mReadBlocks);
+            ModbusFetchTargets_Destroy(newObj->mFetchTargets);
+            goto err_delete_super;
+        }
+        newObj->mPollItems = vector_init(sizeof(const ModbusFetchItem*));
+        newObj->mPollBlocks = vector_init(sizeof(ModbusReadBlock));
+        newObj->mPollGroup = vector_init(sizeof(const ModbusFetchItem*));
+        newObj->mPolledItems = TelemetryItems_New();
+        if (NULL == newObj->mPollItems || NULL == newObj->mPollBlocks
+            || NULL == newObj->mPollGroup || NULL == newObj->mPolledItems) {
+            if (NULL != newObj->mPollItems) {
+                vector_destroy(newObj->mPollItems);
+            }
+            if (NULL != newObj->mPollBlocks) {
+                vector_destroy(newObj->mPollBlocks);
+            }
+            if (NULL != newObj->mPollGroup) {
+                vector_destroy(newObj->mPollGroup);
+            }
+            TelemetryItems_Destroy(newObj->mPolledItems);
+            vector_destroy(newObj->mDevIDs);
+            vector_destroy(newObj->mReadRequests);
+            vector_destroy(newObj->mReadBlocks);
+            ModbusFetchTargets_Destroy(newObj->mFetchTargets);
+            goto err_delete_super;
+        }
+        newObj->mDevIndex = 0;
+        newObj->mCurDev = NULL;
+        newObj->mBusy = false;
+        newObj->mInDoSchedule = false;
     }
 
     super->DoDestroy = ModbusDataFetchScheduler_DoDestroy;
-//	super->DoInit    = ModbusDataFetchScheduler_DoInit;  // don't override
+    super->DoInit    = ModbusDataFetchScheduler_DoInit;
     super->ClearFetchTargets = ModbusDataFetchScheduler_ClearFetchTargets;
     super->DoSchedule        = ModbusDataFetchScheduler_DoSchedule;
+    super->IsBusy            = ModbusDataFetchScheduler_IsBusy;
 
     return super;
 err_delete_super:
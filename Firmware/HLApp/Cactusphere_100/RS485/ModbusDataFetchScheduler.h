@@ -29,6 +29,10 @@
 #include <DataFetchScheduler.h>
 #endif
 
+// size of the response buffer of ModbusOneshotcommand
+// (read values of FC23 are returned as JSON array)
+#define MODBUS_ONESHOT_RESPONSE_SIZE    1024
+
 extern DataFetchScheduler* ModbusDataFetchScheduler_New(void);
 extern void ModbusOneshotcommand(const unsigned char* payload, size_t size, char* response);
 
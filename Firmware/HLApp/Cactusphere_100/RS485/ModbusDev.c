@@ -30,6 +30,9 @@
 #include <errno.h>
 #include <unistd.h>
 #include <stdlib.h>
+#include <time.h>
+
+#include <applibs/log.h>
 
 #include "ModbusDev.h"
 #include "ModbusDevRTU.h"
@@ -37,12 +40,31 @@
 #include "SendRTApp.h"
 #include "vector.h"
 
+// health of the device
+#define MODBUS_DEV_DOWN_THRESHOLD   3    // consecutive timeouts to mark the device down
+#define MODBUS_DEV_MIN_BACKOFF_SEC  2    // first probing interval of the down device
+#define MODBUS_DEV_MAX_BACKOFF_SEC  300
+
 // ModbusDev structure
 typedef struct ModbusDev {
     ModbusCtx* ctx;
     int devId;
+    uint32_t readGap;   // max unused registers merged into a block read
+    bool autoPoll;      // polled by RTApp autonomously
+    uint32_t timeoutCount;  // consecutive timeouts
+    bool isDown;        // not responding, only probed
+    uint32_t backoffSec;    // current probing interval
+    time_t nextProbe;   // time of the next probe (monotonic, in seconds)
 }ModbusDev;
 
+static time_t
+ModbusDev_GetMonotonicSec(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec;
+}
+
 // Initialization and cleanup
 vector 
 ModbusDev_Initialize() {
@@ -68,6 +90,12 @@ ModbusDev_NewModbusRTU(int devId, int baud, uint8_t parity, uint8_t stop) {
     newObj->ctx = ModbusDevRTU_Initialize(devId, baud, parity, stop);
 
     newObj->devId = devId;
+    newObj->readGap = 0;
+    newObj->autoPoll = false;
+    newObj->timeoutCount = 0;
+    newObj->isDown = false;
+    newObj->backoffSec = MODBUS_DEV_MIN_BACKOFF_SEC;
+    newObj->nextProbe = 0;
 
     return newObj;
 }
@@ -85,24 +113,151 @@ ModbusDev_GetModbusDev(int devID, vector modbusDevVec) {
     return NULL;
 }
 
+// Block read gap tolerance
+void
+ModbusDev_SetReadGap(ModbusDev* me, uint32_t readGap) {
+    me->readGap = readGap;
+}
+
+uint32_t
+ModbusDev_GetReadGap(ModbusDev* me) {
+    return me->readGap;
+}
+
+// Autonomous polling by RTApp
+void
+ModbusDev_SetAutoPoll(ModbusDev* me, bool autoPoll) {
+    me->autoPoll = autoPoll;
+}
+
+bool
+ModbusDev_GetAutoPoll(ModbusDev* me) {
+    return me->autoPoll;
+}
+
+// Range of the response timeout
+void
+ModbusDev_SetTimeoutRange(ModbusDev* me, uint32_t minTimeoutMs, uint32_t maxTimeoutMs) {
+    ModbusDevRTU_SetTimeoutRange(me->ctx, minTimeoutMs, maxTimeoutMs);
+}
+
+// Bus occupancy of a read request (in microseconds)
+uint32_t
+ModbusDev_EstimateReadUs(ModbusDev* me, int funcCode, int regCount) {
+    return ModbusDevRTU_EstimateReadUs(me->ctx, funcCode, regCount);
+}
+
+// Health of the device
+bool
+ModbusDev_IsDown(ModbusDev* me) {
+    return me->isDown;
+}
+
+bool
+ModbusDev_IsProbeDue(ModbusDev* me) {
+    return me->isDown && ModbusDev_GetMonotonicSec() >= me->nextProbe;
+}
+
+void
+ModbusDev_ReportResponse(ModbusDev* me, bool responded) {
+    if (responded) {
+        if (me->isDown) {
+            Log_Debug("INFO: Modbus device %d is back\n", me->devId);
+        }
+        me->timeoutCount = 0;
+        me->isDown = false;
+        me->backoffSec = MODBUS_DEV_MIN_BACKOFF_SEC;
+        return;
+    }
+
+    if (me->isDown) {
+        // probe failed, back off exponentially
+        me->backoffSec <<= 1;
+        if (me->backoffSec > MODBUS_DEV_MAX_BACKOFF_SEC) {
+            me->backoffSec = MODBUS_DEV_MAX_BACKOFF_SEC;
+        }
+    } else if (++me->timeoutCount >= MODBUS_DEV_DOWN_THRESHOLD) {
+        Log_Debug("ERROR: Modbus device %d is down\n", me->devId);
+        me->isDown = true;
+        me->backoffSec = MODBUS_DEV_MIN_BACKOFF_SEC;
+    } else {
+        return;
+    }
+    me->nextProbe = ModbusDev_GetMonotonicSec() + (time_t)me->backoffSec;
+}
+
 // Connect
 bool 
 ModbusDev_Connect(ModbusDev* me) {
     return ModbusDevRTU_Connect(me->ctx);
 }
 
+void
+ModbusDev_ConnectAsync(ModbusDev* me, ModbusDevRTU_Callback callback, void* arg) {
+    ModbusDevRTU_ConnectAsync(me->ctx, callback, arg);
+}
+
+// Compare line parameters (baud rate, parity, stop bits)
+int
+ModbusDev_CompareLineParams(const ModbusDev* me, const ModbusDev* other) {
+    return ModbusDevRTU_CompareLineParams(me->ctx, other->ctx);
+}
+
 // Read status/register
 bool 
 ModbusDev_ReadRegister(ModbusDev* me, int regAddr, int funcCode, unsigned short* dst, int regCount) {
     return ModbusDevRTU_ReadRegister(me->ctx, regAddr, funcCode, dst, regCount);
 }
 
+bool
+ModbusDev_ReadRegisterBatch(ModbusDev* me, ModbusReadRequest* reqs, int count) {
+    return ModbusDevRTU_ReadRegisterBatch(me->ctx, reqs, count);
+}
+
+void
+ModbusDev_ReadRegisterBatchAsync(ModbusDev* me, ModbusReadRequest* reqs, int count,
+    ModbusDevRTU_Callback callback, void* arg) {
+    ModbusDevRTU_ReadRegisterBatchAsync(me->ctx, reqs, count, callback, arg);
+}
+
+// Poll table executed by RTApp
+void
+ModbusDev_ClearPollTable(void) {
+    ModbusDevRTU_ClearPollTable();
+}
+
+int
+ModbusDev_AddPollEntry(ModbusDev* me, int funcCode, int regAddr, int regCount, uint32_t intervalMs) {
+    return ModbusDevRTU_AddPollEntry(me->ctx, funcCode, regAddr, regCount, intervalMs);
+}
+
+bool
+ModbusDev_LoadPollTable(ModbusDevRTU_PollHandler handler, void* arg) {
+    return ModbusDevRTU_LoadPollTable(handler, arg);
+}
+
 // Write 2byte
 bool
 ModbusDev_WriteRegister(ModbusDev* me, int regAddr, int funcCode, uint16_t value) {
     return ModbusDevRTU_WriteRegister(me->ctx, regAddr, funcCode, value);
 }
 
+// Write multiple coils (FC15) or registers (FC16)
+bool
+ModbusDev_WriteMultiple(ModbusDev* me, int regAddr, int funcCode,
+    const unsigned short* values, int count) {
+    return ModbusDevRTU_WriteMultiple(me->ctx, regAddr, funcCode, values, count);
+}
+
+// Write registers then read registers in one transaction (FC23)
+bool
+ModbusDev_WriteAndReadRegisters(ModbusDev* me, int writeAddr,
+    const unsigned short* values, int writeCount,
+    int readAddr, unsigned short* dst, int readCount) {
+    return ModbusDevRTU_WriteAndReadRegisters(me->ctx, writeAddr, values, writeCount,
+        readAddr, dst, readCount);
+}
+
 // Get RTApp Version
 bool
 ModbusDev_GetRTAppVersion(char* rtAppVersion) {
@@ -26,9 +26,11 @@
 #define _MODBUS_DEV_H_
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "json.h"
 #include "vector.h"
+#include "ModbusDevRTU.h"
 
 typedef struct ModbusDev ModbusDev;
 
@@ -42,15 +44,57 @@ extern ModbusDev* ModbusDev_NewModbusRTU(int devId, int baud, uint8_t parity, ui
 // Get ModbusDev*
 extern ModbusDev* ModbusDev_GetModbusDev(int devID, vector modbusDevVec);
 
+// Block read gap tolerance
+extern void ModbusDev_SetReadGap(ModbusDev* me, uint32_t readGap);
+extern uint32_t ModbusDev_GetReadGap(ModbusDev* me);
+
+// Autonomous polling by RTApp
+extern void ModbusDev_SetAutoPoll(ModbusDev* me, bool autoPoll);
+extern bool ModbusDev_GetAutoPoll(ModbusDev* me);
+
+// Range of the response timeout (in milliseconds)
+extern void ModbusDev_SetTimeoutRange(ModbusDev* me, uint32_t minTimeoutMs, uint32_t maxTimeoutMs);
+
+// Bus occupancy of a read request (in microseconds)
+extern uint32_t ModbusDev_EstimateReadUs(ModbusDev* me, int funcCode, int regCount);
+
+// Health of the device
+//   the device is marked down after consecutive timeouts, then it is only
+//   probed by one request at exponentially growing intervals until it responds
+extern bool ModbusDev_IsDown(ModbusDev* me);
+extern bool ModbusDev_IsProbeDue(ModbusDev* me);
+extern void ModbusDev_ReportResponse(ModbusDev* me, bool responded);
+
 // Connect
 extern bool ModbusDev_Connect(ModbusDev* me);
+extern void ModbusDev_ConnectAsync(ModbusDev* me, ModbusDevRTU_Callback callback, void* arg);
+
+// Compare line parameters (baud rate, parity, stop bits)
+extern int ModbusDev_CompareLineParams(const ModbusDev* me, const ModbusDev* other);
 
 // Read status/register
 extern bool ModbusDev_ReadRegister(ModbusDev* me, int regAddr, int funcCode, unsigned short* dst, int regCount);
+extern bool ModbusDev_ReadRegisterBatch(ModbusDev* me, ModbusReadRequest* reqs, int count);
+extern void ModbusDev_ReadRegisterBatchAsync(ModbusDev* me, ModbusReadRequest* reqs, int count,
+    ModbusDevRTU_Callback callback, void* arg);
+
+// Poll table executed by RTApp
+extern void ModbusDev_ClearPollTable(void);
+extern int ModbusDev_AddPollEntry(ModbusDev* me, int funcCode, int regAddr, int regCount, uint32_t intervalMs);
+extern bool ModbusDev_LoadPollTable(ModbusDevRTU_PollHandler handler, void* arg);
 
 // Write 2byte
 extern bool ModbusDev_WriteRegister(ModbusDev* me, int regAddr, int funcCode, uint16_t value);
 
+// Write multiple coils (FC15) or registers (FC16)
+extern bool ModbusDev_WriteMultiple(ModbusDev* me, int regAddr, int funcCode,
+    const unsigned short* values, int count);
+
+// Write registers then read registers in one transaction (FC23)
+extern bool ModbusDev_WriteAndReadRegisters(ModbusDev* me, int writeAddr,
+    const unsigned short* values, int writeCount,
+    int readAddr, unsigned short* dst, int readCount);
+
 // Get RTApp Version
 extern bool ModbusDev_GetRTAppVersion(char* rtAppVersion);
 #endif  // _MODBUS_DEV_H_
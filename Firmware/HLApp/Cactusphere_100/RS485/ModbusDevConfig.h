@@ -26,10 +26,34 @@
 #define _MODBUS_DEV_CONFIG_H_
 
 // Allowed function code
+#define FC_READ_COILS               0x01
+#define FC_READ_DISCRETE_INPUTS     0x02
 #define FC_READ_HOLDING_REGISTER    0x03
 #define FC_READ_INPUT_REGISTERS     0x04
 #define FC_WRITE_FORCE_SINGLE_COIL  0x05
 #define FC_WRITE_SINGLE_REGISTER    0x06
+#define FC_WRITE_MULTIPLE_COILS     0x0F
+#define FC_WRITE_MULTIPLE_REGISTERS 0x10
+#define FC_READ_WRITE_MULTIPLE_REGISTERS 0x17
+
+// maximum register count of a read request (FC03/FC04/FC23)
+#define MODBUS_MAX_READ_REGISTERS   125
+// maximum bit count of a read request (FC01/FC02),
+// the bits are packed into MODBUS_MAX_READ_REGISTERS words (LSB first)
+#define MODBUS_MAX_READ_BITS        2000
+// maximum count of a write request
+#define MODBUS_MAX_WRITE_BITS       1968  // FC15
+#define MODBUS_MAX_WRITE_REGISTERS  123   // FC16
+#define MODBUS_MAX_RW_WRITE_REGISTERS 121 // FC23
+
+// default range of the response timeout (in milliseconds),
+// adapted to the latency of each device within the range
+#define MODBUS_DEFAULT_MIN_TIMEOUT_MS   20
+#define MODBUS_DEFAULT_MAX_TIMEOUT_MS   400  // same as the fixed timeout of RTApp
+
+// function code reads bits (coils or discrete inputs)
+#define MODBUS_IS_BIT_READ(funcCode) \
+    ((funcCode) == FC_READ_COILS || (funcCode) == FC_READ_DISCRETE_INPUTS)
 
 // parity bit
 typedef enum {
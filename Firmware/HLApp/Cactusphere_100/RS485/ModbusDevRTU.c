@@ -32,8 +32,12 @@
 #include <stdlib.h>
 #include <time.h>
 
+#include <applibs/log.h>
+
 #include "ModbusDevRTU.h"
 #include "ModbusDevConfig.h"
+#include "ModbusCRC.h"
+#include "ModbusLatencyHist.h"
 #include "UartDriveMsg.h"
 #include "SendRTApp.h"
 #include "vector.h"
@@ -42,9 +46,20 @@
 #define MODBUS_RTU_CHECKSUM_LENGTH 2
 
 #define MIN_REQ_LENGTH 12
-#define MAX_MESSAGE_LENGTH 256
 
 #define MODBUS_RTU_PRESET_REQ_LENGTH 6
+#define MODBUS_RTU_READ_REQ_LENGTH (MODBUS_RTU_PRESET_REQ_LENGTH + MODBUS_RTU_CHECKSUM_LENGTH)
+// response of FC05/06/15/16 (slave ID + function code + address + value or quantity + CRC)
+#define MODBUS_RTU_WRITE_RSP_LENGTH 8
+
+// maximum number of requests in one UART_REQ_BATCH message
+#define MAX_BATCH_REQUESTS \
+    (MAX_UART_BATCH_LEN / UART_MsgWriteAndRead_Size(MODBUS_RTU_READ_REQ_LENGTH))
+
+// response timeout adapted to the latency of the device
+#define MODBUS_RTU_TIMEOUT_PERMILLE         990  // percentile of the latency
+#define MODBUS_RTU_MIN_LATENCY_SAMPLES      16   // until then, maximum timeout is used
+#define MODBUS_RTU_EXPECTED_LATENCY_US      5000 // latency of the device until it is learned
 
 // ModbusCtx structure
 typedef struct ModbusCtx {
@@ -54,29 +69,33 @@ typedef struct ModbusCtx {
     uint8_t stop;
     int     header_length;
     int     checksum_length;
+    uint32_t    minTimeoutMs;
+    uint32_t    maxTimeoutMs;
+    ModbusLatencyHist   latency;    // response latency of the device
 }ModbusCtx;
 
-static uint16_t 
-ModbusRTU_CalcCRC(uint8_t* req, int req_length) {
-    uint16_t crc = 0xFFFF;
-    for (int i = 0; i < req_length; i++) {
-        crc = (uint16_t)(crc ^ req[i]);
-        for (int j = 0; j < 8; j++) {
-            if ((crc & 1) == 1) {
-                crc = crc >> 1;
-                crc ^= 0xA001;
-            }
-            else {
-                crc = crc >> 1;
-            }
-        }
-    }
-    return crc;
-}
+// line parameters currently applied to the UART of RTApp
+static struct {
+    bool    valid;
+    int     baud;
+    uint8_t parity;
+    uint8_t stop;
+} sAppliedParams = { .valid = false };
+
+// poll table executed by RTApp
+static struct {
+    ModbusCtx*  ctx[MAX_UART_POLL_ENTRIES];    // device of each entry
+    uint32_t    message[(sizeof(UART_DriverMsgHdr) + sizeof(uint16_t) * 2
+        + sizeof(UART_PollEntry) * MAX_UART_POLL_ENTRIES) / sizeof(uint32_t)];
+    bool        isLoaded;   // RTApp has non-empty poll table
+    bool        isActive;   // RTApp has the same poll table as message
+    ModbusDevRTU_PollHandler    handler;
+    void*       arg;
+} sPollTable = { .isLoaded = false, .isActive = false };
 
 static int 
 ModbusRTU_AddCRCRequestMsg(uint8_t* req, int req_length) {
-    uint16_t crc = ModbusRTU_CalcCRC(req, req_length);
+    uint16_t crc = ModbusCRC_Calc(req, req_length);
 
     req[req_length++] = (uint8_t)crc;
     req[req_length++] = (uint8_t)(crc >> 8);
@@ -96,8 +115,73 @@ ModbusRTU_CreateRequestMsg(ModbusCtx* me, int function, int addr, int length, ui
     return ModbusRTU_AddCRCRequestMsg(req, MODBUS_RTU_PRESET_REQ_LENGTH);
 }
 
+// Create request of FC15/FC16/FC23
+//   FC15: values are bits packed LSB first (bit i is (values[i >> 4] >> (i & 15)) & 1)
+//   FC23: writes values to wAddr, and reads the registers of addr/length
+static int
+ModbusRTU_CreateWriteMultipleMsg(ModbusCtx* me, int function, int addr, int length,
+    int wAddr, const unsigned short* values, int count, uint8_t* req) {
+    int req_length = 0;
+    int byteCount;
+
+    req[req_length++] = (uint8_t)me->devId;
+    req[req_length++] = (uint8_t)function;
+    req[req_length++] = (uint8_t)(addr >> 8);
+    req[req_length++] = (uint8_t)(addr & 0x00ff);
+    req[req_length++] = (uint8_t)(length >> 8);
+    req[req_length++] = (uint8_t)(length & 0x00ff);
+    if (function == FC_READ_WRITE_MULTIPLE_REGISTERS) {
+        req[req_length++] = (uint8_t)(wAddr >> 8);
+        req[req_length++] = (uint8_t)(wAddr & 0x00ff);
+        req[req_length++] = (uint8_t)(count >> 8);
+        req[req_length++] = (uint8_t)(count & 0x00ff);
+    }
+
+    if (function == FC_WRITE_MULTIPLE_COILS) {
+        byteCount = (count + 7) >> 3;
+        req[req_length++] = (uint8_t)byteCount;
+        for (int i = 0; i < byteCount; i++) {
+            req[req_length++] = (uint8_t)(values[i >> 1] >> ((i & 1) << 3));
+        }
+    } else {
+        req[req_length++] = (uint8_t)(count << 1);
+        for (int i = 0; i < count; i++) {
+            req[req_length++] = (uint8_t)(values[i] >> 8);
+            req[req_length++] = (uint8_t)(values[i] & 0x00ff);
+        }
+    }
+
+    return ModbusRTU_AddCRCRequestMsg(req, req_length);
+}
+
+// Maximum count of a read request (0 if the function doesn't read)
+static int
+ModbusRTU_GetMaxReadCount(int function) {
+    switch (function) {
+    case FC_READ_COILS:
+    case FC_READ_DISCRETE_INPUTS:
+        return MODBUS_MAX_READ_BITS;
+    case FC_READ_HOLDING_REGISTER:
+    case FC_READ_INPUT_REGISTERS:
+    case FC_READ_WRITE_MULTIPLE_REGISTERS:
+        return MODBUS_MAX_READ_REGISTERS;
+    default:
+        return 0;
+    }
+}
+
+// Length of the normal response to the read request
+static int
+ModbusRTU_GetReadResponseLength(ModbusCtx* me, int function, int length) {
+    // slave ID + function code + byte count + bits or register values + CRC
+    if (MODBUS_IS_BIT_READ(function)) {
+        return me->header_length + 2 + ((length + 7) >> 3) + me->checksum_length;
+    }
+    return me->header_length + 2 + (length << 1) + me->checksum_length;
+}
+
 static int 
-ModbusRTU_CheckResponseMsg(ModbusCtx* me, uint8_t* req, uint8_t* rsp){
+ModbusRTU_CheckResponseMsg(ModbusCtx* me, const uint8_t* req, const uint8_t* rsp, int rsp_length){
     int rc = 0;
     const int offset = me->header_length;
     const int function = rsp[offset];
@@ -112,12 +196,47 @@ ModbusRTU_CheckResponseMsg(ModbusCtx* me, uint8_t* req, uint8_t* rsp){
         return -1;
     }
 
+    if (! ModbusCRC_Check(rsp, rsp_length)) {
+        return -1;  // corrupted response
+    }
+
+    if (req[offset] != function) {
+        return -1;
+    }
+
     switch (function) {
+    case FC_READ_COILS:
+    case FC_READ_DISCRETE_INPUTS:
+        if (rsp_length != offset + 2 + rsp[offset + 1] + me->checksum_length) {
+            return -1;  // inconsistent byte count
+        }
+        // number of bits
+        req_calc_length = (req[offset + 3] << 8) + req[offset + 4];
+        rsp_calc_length = req_calc_length;
+        if (rsp[offset + 1] != ((req_calc_length + 7) >> 3)) {
+            return -1;
+        }
+        break;
     case FC_READ_HOLDING_REGISTER:
     case FC_READ_INPUT_REGISTERS:
+    case FC_READ_WRITE_MULTIPLE_REGISTERS:
+        if (rsp_length != offset + 2 + rsp[offset + 1] + me->checksum_length) {
+            return -1;  // inconsistent byte count
+        }
         req_calc_length = (req[offset + 3] << 8) + req[offset + 4];
         rsp_calc_length = (rsp[offset + 1] / 2);
         break;
+    case FC_WRITE_FORCE_SINGLE_COIL:
+    case FC_WRITE_SINGLE_REGISTER:
+    case FC_WRITE_MULTIPLE_COILS:
+    case FC_WRITE_MULTIPLE_REGISTERS:
+        // echo of address and value (FC05/06), or address and quantity (FC15/16)
+        if (rsp_length != MODBUS_RTU_WRITE_RSP_LENGTH
+            || memcmp(&req[offset + 1], &rsp[offset + 1], 4) != 0) {
+            return -1;
+        }
+        req_calc_length = rsp_calc_length = 1;
+        break;
     default:
         req_calc_length = rsp_calc_length = 1;
         break;
@@ -130,62 +249,464 @@ ModbusRTU_CheckResponseMsg(ModbusCtx* me, uint8_t* req, uint8_t* rsp){
     return rc;
 }
 
-long ModbusDevRTU_CreateInterval(ModbusCtx* me) {
-    int data = 8;
-    long interval_ns = 1000000000LL * (1 + data
-                  + (me->parity == PARITY_NONE ? 0 : 1)
-                  + me->stop) * 3.5 / me->baud;
+// Response timeout of the request (until the first character of the response)
+static uint16_t
+ModbusRTU_GetTimeoutMs(ModbusCtx* me, int readLen) {
+    uint32_t timeoutUs;
+    uint32_t timeoutMs;
+
+    if (ModbusLatencyHist_GetCount(&me->latency) < MODBUS_RTU_MIN_LATENCY_SAMPLES) {
+        return (uint16_t)me->maxTimeoutMs;
+    }
 
-    return interval_ns;
+    // high percentile of the latency with margin, plus frame time of the response
+    // (11 bits per character at most)
+    timeoutUs = ModbusLatencyHist_GetPercentileUs(&me->latency, MODBUS_RTU_TIMEOUT_PERMILLE);
+    timeoutUs += timeoutUs / 2;
+    timeoutUs += (uint32_t)((uint64_t)readLen * 11 * 1000000 / (uint32_t)me->baud);
+    // RTApp measures the timeout on its tick, and waits for the timeout
+    // rounded down to UART_TICK_MS at least, so round it up to the tick
+    timeoutMs = (timeoutUs + 999) / 1000;
+    timeoutMs = (timeoutMs + UART_TICK_MS - 1) / UART_TICK_MS * UART_TICK_MS;
+
+    if (timeoutMs < me->minTimeoutMs) {
+        timeoutMs = me->minTimeoutMs;
+    } else if (timeoutMs > me->maxTimeoutMs) {
+        timeoutMs = me->maxTimeoutMs;
+    }
+    return (uint16_t)timeoutMs;
+}
+
+// Learn the response latency from the result returned from RTApp
+static void
+ModbusRTU_RecordLatency(ModbusCtx* me, const UART_ReadResult* result) {
+    if (result->status == UART_READ_TIMEOUT) {
+        // the latency may be longer than the timeout, count it as the maximum
+        // so that the timeout is extended soon
+        ModbusLatencyHist_Add(&me->latency, me->maxTimeoutMs * 1000);
+    } else if (result->latencyUs != 0) {
+        ModbusLatencyHist_Add(&me->latency, result->latencyUs);
+    }
+}
+
+// Check the status of the response returned from RTApp
+static bool
+ModbusRTU_CheckReadResult(ModbusCtx* me, const UART_ReadResult* result) {
+    ModbusRTU_RecordLatency(me, result);
+
+    switch (result->status) {
+    case UART_READ_OK:
+        return true;
+    case UART_READ_TIMEOUT:
+        Log_Debug("ERROR: Modbus device %d: no response\n", me->devId);
+        break;
+    case UART_READ_EXCEPTION:
+        Log_Debug("ERROR: Modbus device %d: exception response (function 0x%02x, code %d)\n",
+            me->devId, result->readData[1], result->readData[2]);
+        break;
+    case UART_READ_OVERRUN:
+        Log_Debug("ERROR: Modbus device %d: too long response\n", me->devId);
+        break;
+    case UART_READ_CRC_ERROR:
+    default:
+        Log_Debug("ERROR: Modbus device %d: corrupted response\n", me->devId);
+        break;
+    }
+
+    return false;
+}
+
+// Check the response of read request, then store the register values
+static bool
+ModbusRTU_ParseReadResponse(ModbusCtx* me, const uint8_t* req,
+    const UART_ReadResult* result, unsigned short* dst) {
+    int rc;
+    int i;
+    const int offset = me->header_length;
+    const uint8_t* rsp = result->readData;
+
+    if (! ModbusRTU_CheckReadResult(me, result))
+        return false;
+    rc = ModbusRTU_CheckResponseMsg(me, req, rsp, result->readLen);
+    if (rc <= 0)
+        return false;
+
+    if (MODBUS_IS_BIT_READ(rsp[offset])) {
+        // pack the bits into words, LSB first
+        const int byteCount = rsp[offset + 1];
+
+        memset(dst, 0, (size_t)((rc + 15) >> 4) * sizeof(unsigned short));
+        for (i = 0; i < byteCount; i++) {
+            dst[i >> 1] |= (unsigned short)(rsp[offset + 2 + i] << ((i & 1) << 3));
+        }
+        return true;
+    }
+
+    for (i = 0; i < rc; i++) {
+        dst[i] = (unsigned short)((rsp[offset + 2 + (i << 1)] << 8) |
+            rsp[offset + 3 + (i << 1)]);
+    }
+
+    return true;
+}
+
+// Send the request to the device via RTApp, and receive its response
+static bool
+ModbusRTU_WriteAndRead(ModbusCtx* me, const uint8_t* req, int req_length, int readLen,
+    UART_ReadResult* result) {
+    uint32_t sendMessage[(sizeof(UART_DriverMsgHdr) + UART_MsgWriteAndRead_HeaderSize
+        + MAX_UART_WRITE_LEN) / sizeof(uint32_t)];
+    UART_DriverMsg* msg = (UART_DriverMsg*)sendMessage;
+    long received;
+
+    msg->header.requestCode = UART_REQ_WRITE_AND_READ;
+
+    memcpy(msg->body.writeAndReadReq.writeData, req, (size_t)req_length);
+    msg->body.writeAndReadReq.writeLen = (uint16_t)req_length;
+    msg->body.writeAndReadReq.readLen = (uint16_t)readLen;
+    msg->body.writeAndReadReq.timeoutMs = ModbusRTU_GetTimeoutMs(me, readLen);
+    msg->body.writeAndReadReq.reserved = 0;
+    msg->header.messageLen = UART_MsgWriteAndRead_HeaderSize
+        + msg->body.writeAndReadReq.writeLen;
+
+    received = SendRTApp_SendMessageToRTCoreAndReadMessage((const unsigned char*)msg, 
+        (long)(sizeof(msg->header) + msg->header.messageLen),
+        (unsigned char*)result, 
+        (long)sizeof(*result));
+    if (received == 0) {
+        sAppliedParams.valid = false;  // RTApp may have been restarted
+        return false;
+    }
+
+    // reject the reply of other request (e.g. a late one, or the ack of
+    // UART_REQ_SET_PARAMS), it doesn't have the whole result of this request
+    if (received < (long)UART_ReadResult_HeaderSize
+        || result->readLen > MAX_UART_READ_LEN || result->readLen > readLen
+        || received < (long)(UART_ReadResult_HeaderSize + result->readLen)) {
+        Log_Debug("ERROR: Modbus device %d: invalid response from RTApp\n", me->devId);
+        return false;
+    }
+
+    return true;
 }
 
 // Read register
+//   FC01/FC02 read length bits, they are packed into dst LSB first
 bool
 ModbusDevRTU_ReadRegister(ModbusCtx* me, int regAddr, int function, unsigned short* dst, int length) {
-    int rc;
     int req_length;
     uint8_t req[MIN_REQ_LENGTH];
-    uint8_t rsp[MAX_MESSAGE_LENGTH];
-    unsigned char sendMessage[MAX_MESSAGE_LENGTH];
-    UART_DriverMsg* msg = (UART_DriverMsg*)sendMessage;
+    UART_ReadResult result = { 0 };
+
+    if (function == FC_READ_WRITE_MULTIPLE_REGISTERS
+        || length < 1 || length > ModbusRTU_GetMaxReadCount(function)) {
+        return false;
+    }
 
     req_length = ModbusRTU_CreateRequestMsg(me, function, regAddr, length, req);
 
-    msg->header.requestCode = UART_REQ_WRITE_AND_READ;
+    if (! ModbusRTU_WriteAndRead(me, req, req_length,
+            ModbusRTU_GetReadResponseLength(me, function, length), &result)) {
+        return false;
+    }
 
-    memcpy(msg->body.writeAndReadReq.writeData, req, (size_t)req_length);
-    msg->body.writeAndReadReq.writeLen = (uint16_t)req_length;
-    msg->body.writeAndReadReq.readLen = 7;
+    return ModbusRTU_ParseReadResponse(me, req, &result, dst);
+}
 
-    msg->header.messageLen = sizeof(msg->body.writeAndReadReq.writeLen)
-        + sizeof(msg->body.writeAndReadReq.readLen)
-        + msg->body.writeAndReadReq.writeLen;
+// context of ModbusDevRTU_ReadRegisterBatchAsync
+typedef struct ModbusRTU_BatchCtx {
+    ModbusCtx*  me;
+    ModbusReadRequest*  reqs;
+    int         count;
+    int         next;       // index of the request to be packed next
+    int         n;          // number of the requests in flight
+    int         reqIndex[MAX_BATCH_REQUESTS];
+    uint32_t    sendMessage[(sizeof(UART_DriverMsgHdr) + MAX_UART_BATCH_LEN) / sizeof(uint32_t)];
+    uint32_t    readMessage[MAX_UART_BATCH_LEN / sizeof(uint32_t)];
+    ModbusDevRTU_Callback   callback;
+    void*       arg;
+} ModbusRTU_BatchCtx;
+
+// context of ModbusDevRTU_ConnectAsync
+typedef struct ModbusRTU_ConnectCtx {
+    ModbusCtx*  me;
+    ModbusDevRTU_Callback   callback;
+    void*       arg;
+} ModbusRTU_ConnectCtx;
+
+// Estimate the worst processing time of a transaction in RTApp
+static long
+ModbusRTU_EstimateTransactionMs(ModbusCtx* me, int writeLen, int readLen, int timeoutMs) {
+    // 11 bits per character at most (start + 8 data + parity + stop)
+    long frameMs = (long)(writeLen + readLen) * 11 * 1000 / me->baud + 1;
+
+    return (UART_CRC_RETRY_COUNT + 1)
+        * (timeoutMs + frameMs + UART_RETRY_INTERVAL_MS);
+}
 
-    const struct timespec silentInterval = {.tv_sec = 0, .tv_nsec = ModbusDevRTU_CreateInterval(me)};
-    nanosleep(&silentInterval, NULL);
+static void
+ModbusRTU_SyncCallback(void* arg, bool result) {
+    *(bool*)arg = result;
+}
 
-    rc = SendRTApp_SendMessageToRTCoreAndReadMessage((const unsigned char*)msg, 
-        (long)(sizeof(msg->header) + msg->header.messageLen),
-        rsp, 
-        msg->body.writeAndReadReq.readLen);
+static void ModbusRTU_SendNextBatch(ModbusRTU_BatchCtx* ctx);
 
-    if (rc > 0) {
-        int offset;
-        int i;
+static void
+ModbusRTU_FinishBatch(ModbusRTU_BatchCtx* ctx, bool result) {
+    ModbusDevRTU_Callback callback = ctx->callback;
+    void* arg = ctx->arg;
 
-        rc = ModbusRTU_CheckResponseMsg(me, req, rsp);
-        if (rc == -1)
-            return false;
+    free(ctx);
+    callback(arg, result);
+}
 
-        offset = me->header_length;
+static void
+ModbusRTU_OnBatchResponse(void* arg, const unsigned char* rxMessage, long rxMessageSize) {
+    ModbusRTU_BatchCtx* ctx = (ModbusRTU_BatchCtx*)arg;
+    ModbusCtx* me = ctx->me;
+    UART_DriverMsg* msg = (UART_DriverMsg*)ctx->sendMessage;
+    const UART_BatchResult* batchResult = (const UART_BatchResult*)ctx->readMessage;
+    const uint8_t* readEnd = (const uint8_t*)ctx->readMessage + rxMessageSize;
+    const uint8_t* itemCurs;
+    const uint8_t* resultCurs;
+
+    if (rxMessage == NULL) {
+        sAppliedParams.valid = false;  // RTApp may have been restarted
+        ModbusRTU_FinishBatch(ctx, false);
+        return;
+    }
+    memcpy(ctx->readMessage, rxMessage, (size_t)rxMessageSize);  // for alignment
+    if (rxMessageSize < (long)UART_BatchResult_HeaderSize
+        || batchResult->count != ctx->n) {
+        Log_Debug("ERROR: Modbus device %d: invalid batch response\n", me->devId);
+        ModbusRTU_FinishBatch(ctx, false);
+        return;
+    }
 
-        for (i = 0; i < rc; i++) {
-            dst[i] = (unsigned short)((rsp[offset + 2 + (i << 1)] << 8) |
-                rsp[offset + 3 + (i << 1)]);
+    // distribute the responses to each request
+    itemCurs = (const uint8_t*)msg->body.batchReq.items;
+    resultCurs = (const uint8_t*)batchResult->results;
+    for (int i = 0; i < ctx->n; i++) {
+        const UART_MsgWriteAndRead* item = (const UART_MsgWriteAndRead*)itemCurs;
+        const UART_ReadResult* result = (const UART_ReadResult*)resultCurs;
+        ModbusReadRequest* req = &ctx->reqs[ctx->reqIndex[i]];
+
+        if (resultCurs + UART_ReadResult_HeaderSize > readEnd
+            || resultCurs + UART_ReadResult_HeaderSize + result->readLen > readEnd) {
+            Log_Debug("ERROR: Modbus device %d: invalid batch response\n", me->devId);
+            ModbusRTU_FinishBatch(ctx, false);
+            return;
         }
+        req->result = ModbusRTU_ParseReadResponse(me,
+            (const uint8_t*)item->writeData, result, req->values);
+        req->responded = (result->status != UART_READ_TIMEOUT);
+
+        itemCurs += UART_MsgWriteAndRead_Size(item->writeLen);
+        resultCurs += UART_ReadResult_Size(result->readLen);
     }
 
-    return rc;
+    ModbusRTU_SendNextBatch(ctx);
+}
+
+static void
+ModbusRTU_SendNextBatch(ModbusRTU_BatchCtx* ctx) {
+    ModbusCtx* me = ctx->me;
+    UART_DriverMsg* msg = (UART_DriverMsg*)ctx->sendMessage;
+    uint8_t* itemCurs = (uint8_t*)msg->body.batchReq.items;
+    uint32_t reqLen = sizeof(uint16_t) * 2;
+    uint32_t rspLen = UART_BatchResult_HeaderSize;
+    long timeoutMs = 1000;  // margin for intercore communication
+
+    // pack the requests as many as one message can carry
+    ctx->n = 0;
+    for (; ctx->next < ctx->count && ctx->n < MAX_BATCH_REQUESTS; ctx->next++) {
+        ModbusReadRequest* req = &ctx->reqs[ctx->next];
+        UART_MsgWriteAndRead* item = (UART_MsgWriteAndRead*)itemCurs;
+        uint16_t readLen;
+
+        req->result = false;
+        req->responded = false;
+        if (req->funcCode == FC_READ_WRITE_MULTIPLE_REGISTERS
+            || req->regCount < 1 || req->regCount > ModbusRTU_GetMaxReadCount(req->funcCode)) {
+            continue;
+        }
+        readLen = (uint16_t)ModbusRTU_GetReadResponseLength(me, req->funcCode, req->regCount);
+        if (reqLen + UART_MsgWriteAndRead_Size(MODBUS_RTU_READ_REQ_LENGTH) > MAX_UART_BATCH_LEN
+            || rspLen + UART_ReadResult_Size(readLen) > MAX_UART_BATCH_LEN) {
+            break;  // send the rest by the next message
+        }
+        item->writeLen = (uint16_t)ModbusRTU_CreateRequestMsg(me, req->funcCode,
+            req->regAddr, req->regCount, (uint8_t*)item->writeData);
+        item->readLen = readLen;
+        item->timeoutMs = ModbusRTU_GetTimeoutMs(me, readLen);
+        item->reserved = 0;
+
+        reqLen += UART_MsgWriteAndRead_Size(item->writeLen);
+        rspLen += UART_ReadResult_Size(readLen);
+        timeoutMs += ModbusRTU_EstimateTransactionMs(me, item->writeLen, readLen,
+            item->timeoutMs);
+        itemCurs += UART_MsgWriteAndRead_Size(item->writeLen);
+        ctx->reqIndex[ctx->n++] = ctx->next;
+    }
+    if (ctx->n == 0) {
+        ModbusRTU_FinishBatch(ctx, true);  // all the requests are done
+        return;
+    }
+
+    msg->header.requestCode = UART_REQ_BATCH;
+    msg->header.messageLen = reqLen;
+    msg->body.batchReq.count = (uint16_t)ctx->n;
+    msg->body.batchReq.reserved = 0;
+
+    if (! SendRTApp_SubmitMessage((const unsigned char*)msg,
+            (long)(sizeof(msg->header) + msg->header.messageLen),
+            MAX_UART_BATCH_LEN, timeoutMs,
+            ModbusRTU_OnBatchResponse, ctx)) {
+        ModbusRTU_FinishBatch(ctx, false);
+    }
+}
+
+// Read registers of multiple requests by one message to RTApp
+bool
+ModbusDevRTU_ReadRegisterBatch(ModbusCtx* me, ModbusReadRequest* reqs, int count) {
+    bool result = false;
+
+    ModbusDevRTU_ReadRegisterBatchAsync(me, reqs, count,
+        ModbusRTU_SyncCallback, &result);
+    SendRTApp_WaitIdle();
+
+    return result;
+}
+
+void
+ModbusDevRTU_ReadRegisterBatchAsync(ModbusCtx* me, ModbusReadRequest* reqs, int count,
+    ModbusDevRTU_Callback callback, void* arg) {
+    ModbusRTU_BatchCtx* ctx = (ModbusRTU_BatchCtx*)malloc(sizeof(ModbusRTU_BatchCtx));
+
+    if (ctx == NULL) {
+        callback(arg, false);
+        return;
+    }
+    ctx->me = me;
+    ctx->reqs = reqs;
+    ctx->count = count;
+    ctx->next = 0;
+    ctx->n = 0;
+    ctx->callback = callback;
+    ctx->arg = arg;
+
+    ModbusRTU_SendNextBatch(ctx);
+}
+
+// Poll table executed by RTApp
+static void
+ModbusRTU_OnPollPush(void* arg, const unsigned char* message, long messageSize)
+{
+    const UART_DriverMsg* msg = (const UART_DriverMsg*)sPollTable.message;
+    const UART_PollEntry* entry;
+    UART_PollPush push;
+    unsigned short values[MODBUS_MAX_READ_REGISTERS];
+    uint8_t req[MIN_REQ_LENGTH];
+    ModbusCtx* me;
+    bool result;
+
+    if (! sPollTable.isActive
+        || messageSize < (long)(UART_PollPush_HeaderSize + UART_ReadResult_HeaderSize)
+        || messageSize > (long)sizeof(push)) {
+        return;
+    }
+    memcpy(&push, message, (size_t)messageSize);  // for alignment
+    if (push.tableId != msg->body.pollTable.tableId
+        || push.entryIndex >= msg->body.pollTable.count
+        || messageSize < (long)(UART_PollPush_HeaderSize + UART_ReadResult_HeaderSize
+            + push.result.readLen)) {
+        return;  // result of the previous table, or broken
+    }
+    entry = &msg->body.pollTable.entries[push.entryIndex];
+    me = sPollTable.ctx[push.entryIndex];
+
+    ModbusRTU_CreateRequestMsg(me, entry->funcCode, entry->regAddr, entry->regCount, req);
+    result = ModbusRTU_ParseReadResponse(me, req, &push.result, values);
+    sPollTable.handler(sPollTable.arg, push.entryIndex, result ? values : NULL);
+}
+
+void
+ModbusDevRTU_ClearPollTable(void) {
+    UART_DriverMsg* msg = (UART_DriverMsg*)sPollTable.message;
+
+    sPollTable.isActive = false;
+    msg->body.pollTable.count = 0;
+}
+
+int
+ModbusDevRTU_AddPollEntry(ModbusCtx* me, int funcCode, int regAddr, int regCount,
+    uint32_t intervalMs) {
+    UART_DriverMsg* msg = (UART_DriverMsg*)sPollTable.message;
+    UART_PollEntry* entry;
+    int index = msg->body.pollTable.count;
+
+    if (index >= MAX_UART_POLL_ENTRIES
+        || funcCode == FC_READ_WRITE_MULTIPLE_REGISTERS
+        || regCount < 1 || regCount > ModbusRTU_GetMaxReadCount(funcCode)
+        || intervalMs == 0) {
+        return -1;
+    }
+    entry = &msg->body.pollTable.entries[index];
+    entry->baudRate = (uint32_t)me->baud;
+    entry->parity = me->parity;
+    entry->stop = me->stop;
+    entry->slaveId = (uint8_t)me->devId;
+    entry->funcCode = (uint8_t)funcCode;
+    entry->regAddr = (uint16_t)regAddr;
+    entry->regCount = (uint16_t)regCount;
+    entry->intervalMs = intervalMs;
+    entry->timeoutMs = ModbusRTU_GetTimeoutMs(me,
+        ModbusRTU_GetReadResponseLength(me, funcCode, regCount));
+    entry->reserved = 0;
+    sPollTable.ctx[index] = me;
+    msg->body.pollTable.count++;
+
+    return index;
+}
+
+bool
+ModbusDevRTU_LoadPollTable(ModbusDevRTU_PollHandler handler, void* arg) {
+    UART_DriverMsg* msg = (UART_DriverMsg*)sPollTable.message;
+    int readMessage = 0;
+
+    if (msg->body.pollTable.count == 0 && ! sPollTable.isLoaded) {
+        SendRTApp_SetNotificationHandler(0, NULL, NULL);
+        return true;  // nothing to do (RTApp may not support the poll table)
+    }
+
+    // results of the previous table are ignored by tableId
+    msg->header.requestCode = UART_REQ_POLL_TABLE;
+    msg->header.messageLen = (uint32_t)(sizeof(uint16_t) * 2
+        + sizeof(UART_PollEntry) * msg->body.pollTable.count);
+    msg->body.pollTable.tableId++;
+    sPollTable.handler = handler;
+    sPollTable.arg = arg;
+    sPollTable.isActive = true;
+    if (msg->body.pollTable.count > 0) {
+        SendRTApp_SetNotificationHandler(UART_POLL_PUSH_MAGIC, ModbusRTU_OnPollPush, NULL);
+    } else {
+        SendRTApp_SetNotificationHandler(0, NULL, NULL);
+    }
+
+    if (! SendRTApp_SendMessageToRTCoreAndReadMessage((const unsigned char*)msg,
+            (long)(sizeof(msg->header) + msg->header.messageLen),
+            (unsigned char*)&readMessage, sizeof(readMessage))
+        || readMessage != 1) {
+        Log_Debug("ERROR: RTApp rejected the poll table\n");
+        SendRTApp_SetNotificationHandler(0, NULL, NULL);
+        sPollTable.isActive = false;
+        msg->body.pollTable.count = 0;
+        return false;
+    }
+    sPollTable.isLoaded = (msg->body.pollTable.count > 0);
+    sPollTable.isActive = sPollTable.isLoaded;
+
+    return true;
 }
 
 // Initialization and cleanup
@@ -203,22 +724,96 @@ ModbusDevRTU_Initialize(int devId, int baud, uint8_t parity, uint8_t stop) {
     newObj->header_length = MODBUS_RTU_HEADER_LENGTH;
     newObj->checksum_length = MODBUS_RTU_CHECKSUM_LENGTH;
 
+    newObj->minTimeoutMs = MODBUS_DEFAULT_MIN_TIMEOUT_MS;
+    newObj->maxTimeoutMs = MODBUS_DEFAULT_MAX_TIMEOUT_MS;
+    ModbusLatencyHist_Init(&newObj->latency);
+
     return newObj;
 }
 
+// Range of the response timeout adapted to the latency of the device
+void
+ModbusDevRTU_SetTimeoutRange(ModbusCtx* me, uint32_t minTimeoutMs, uint32_t maxTimeoutMs) {
+    me->minTimeoutMs = minTimeoutMs;
+    me->maxTimeoutMs = maxTimeoutMs;
+}
+
+// Estimate the bus occupancy of a read request (in microseconds)
+uint32_t
+ModbusDevRTU_EstimateReadUs(ModbusCtx* me, int funcCode, int regCount) {
+    // request and response frames with the gaps of 3.5 characters
+    // (11 bits per character at most), plus the typical latency of the device
+    int chars = MODBUS_RTU_READ_REQ_LENGTH
+        + ModbusRTU_GetReadResponseLength(me, funcCode, regCount) + 7;
+    uint32_t latencyUs = MODBUS_RTU_EXPECTED_LATENCY_US;
+
+    if (ModbusLatencyHist_GetCount(&me->latency) >= MODBUS_RTU_MIN_LATENCY_SAMPLES) {
+        latencyUs = ModbusLatencyHist_GetPercentileUs(&me->latency, 500);
+    }
+    return (uint32_t)((uint64_t)chars * 11 * 1000000 / (uint32_t)me->baud) + latencyUs;
+}
+
 void
 ModbusDevRTU_Destroy(ModbusCtx* me) {
     free(me);
 }
 
 // Connect
+static void
+ModbusRTU_OnConnectResponse(void* arg, const unsigned char* rxMessage, long rxMessageSize) {
+    ModbusRTU_ConnectCtx* ctx = (ModbusRTU_ConnectCtx*)arg;
+    ModbusCtx* me = ctx->me;
+    ModbusDevRTU_Callback callback = ctx->callback;
+    void* cbArg = ctx->arg;
+    bool result = (rxMessage != NULL && rxMessageSize > 0 && rxMessage[0] == 1);
+
+    free(ctx);
+    if (result) {
+        sAppliedParams.baud = me->baud;
+        sAppliedParams.parity = me->parity;
+        sAppliedParams.stop = me->stop;
+        sAppliedParams.valid = true;
+    }
+    callback(cbArg, result);
+}
+
 bool 
 ModbusDevRTU_Connect(ModbusCtx* me) {
+    bool result = false;
+
+    ModbusDevRTU_ConnectAsync(me, ModbusRTU_SyncCallback, &result);
+    SendRTApp_WaitIdle();
+
+    return result;
+}
+
+void
+ModbusDevRTU_ConnectAsync(ModbusCtx* me, ModbusDevRTU_Callback callback, void* arg) {
     unsigned char sendMessage[256];
-    unsigned char readMessage;
     UART_DriverMsg* msg = (UART_DriverMsg*)sendMessage;
+    ModbusRTU_ConnectCtx* ctx;
     int msgSize;
 
+    // UART of RTApp is shared by all the devices,
+    // reconfigure it only if the line parameters differ
+    if (sAppliedParams.valid
+        && sAppliedParams.baud == me->baud
+        && sAppliedParams.parity == me->parity
+        && sAppliedParams.stop == me->stop) {
+        callback(arg, true);
+        return;
+    }
+    sAppliedParams.valid = false;
+
+    ctx = (ModbusRTU_ConnectCtx*)malloc(sizeof(ModbusRTU_ConnectCtx));
+    if (ctx == NULL) {
+        callback(arg, false);
+        return;
+    }
+    ctx->me = me;
+    ctx->callback = callback;
+    ctx->arg = arg;
+
     msg->header.requestCode = UART_REQ_SET_PARAMS;
     msg->header.messageLen = sizeof(UART_MsgSetParams);
     msg->body.setParams.baudRate = (uint32_t)me->baud;
@@ -226,48 +821,103 @@ ModbusDevRTU_Connect(ModbusCtx* me) {
     msg->body.setParams.stop = (uint8_t)me->stop;
     msgSize = (int)(sizeof(msg->header) + msg->header.messageLen);
 
-    SendRTApp_SendMessageToRTCoreAndReadMessage((const unsigned char*)msg, (long)msgSize, &readMessage, sizeof(readMessage));
-    if (readMessage != 1) {
-        return false;
+    if (! SendRTApp_SubmitMessage((const unsigned char*)msg, (long)msgSize,
+            sizeof(unsigned char), SENDRTAPP_SYNC_TIMEOUT_MS,
+            ModbusRTU_OnConnectResponse, ctx)) {
+        free(ctx);
+        callback(arg, false);
     }
-    return true;
+}
+
+// Compare line parameters (baud rate, parity, stop bits)
+int
+ModbusDevRTU_CompareLineParams(const ModbusCtx* me, const ModbusCtx* other) {
+    if (me->baud != other->baud) {
+        return (me->baud < other->baud) ? -1 : 1;
+    }
+    if (me->parity != other->parity) {
+        return (me->parity < other->parity) ? -1 : 1;
+    }
+    if (me->stop != other->stop) {
+        return (me->stop < other->stop) ? -1 : 1;
+    }
+    return 0;
 }
 
 // Write 2byte
 bool
 ModbusDevRTU_WriteRegister(ModbusCtx* me, int regAddr, int funcCode, unsigned short value) {
-    int rc;
     int req_length;
     uint8_t req[MIN_REQ_LENGTH];
-    uint8_t rsp[MAX_MESSAGE_LENGTH];
-    unsigned char sendMessage[MAX_MESSAGE_LENGTH];
-    UART_DriverMsg* msg = (UART_DriverMsg*)sendMessage;
+    UART_ReadResult result = { 0 };
 
     req_length = ModbusRTU_CreateRequestMsg(me, funcCode, regAddr, (int)value, req);
 
-    msg->header.requestCode = UART_REQ_WRITE_AND_READ;
+    if (! ModbusRTU_WriteAndRead(me, req, req_length, MODBUS_RTU_WRITE_RSP_LENGTH, &result)
+        || ! ModbusRTU_CheckReadResult(me, &result)) {
+        return false;
+    }
+    return ModbusRTU_CheckResponseMsg(me, req, result.readData, result.readLen) > 0;
+}
 
-    memcpy(msg->body.writeAndReadReq.writeData, req, (size_t)req_length);
-    msg->body.writeAndReadReq.writeLen = (uint16_t)req_length;
-    msg->body.writeAndReadReq.readLen = 8;
-    msg->header.messageLen = sizeof(msg->body.writeAndReadReq.writeLen)
-        + sizeof(msg->body.writeAndReadReq.readLen)
-        + msg->body.writeAndReadReq.writeLen;
+// Write multiple coils (FC15) or registers (FC16)
+//   FC15: values are bits packed LSB first
+bool
+ModbusDevRTU_WriteMultiple(ModbusCtx* me, int regAddr, int funcCode,
+    const unsigned short* values, int count) {
+    int req_length;
+    uint8_t req[MAX_UART_WRITE_LEN];
+    UART_ReadResult result = { 0 };
+    int maxCount;
 
-    const struct timespec silentInterval = {.tv_sec = 0, .tv_nsec = ModbusDevRTU_CreateInterval(me)};
-    nanosleep(&silentInterval, NULL);
+    switch (funcCode) {
+    case FC_WRITE_MULTIPLE_COILS:
+        maxCount = MODBUS_MAX_WRITE_BITS;
+        break;
+    case FC_WRITE_MULTIPLE_REGISTERS:
+        maxCount = MODBUS_MAX_WRITE_REGISTERS;
+        break;
+    default:
+        return false;
+    }
+    if (count < 1 || count > maxCount) {
+        return false;
+    }
 
-    rc = SendRTApp_SendMessageToRTCoreAndReadMessage((const unsigned char*)msg, 
-        (long)(sizeof(msg->header) + msg->header.messageLen),
-        rsp, 
-        msg->body.writeAndReadReq.readLen);
+    req_length = ModbusRTU_CreateWriteMultipleMsg(me, funcCode, regAddr, count,
+        0, values, count, req);
 
-    if (rc > 0) {
-        rc = ModbusRTU_CheckResponseMsg(me, req, rsp);
-        if (rc == -1)
-            return false;
+    if (! ModbusRTU_WriteAndRead(me, req, req_length, MODBUS_RTU_WRITE_RSP_LENGTH, &result)
+        || ! ModbusRTU_CheckReadResult(me, &result)) {
+        return false;
     }
-    return rc;
+    return ModbusRTU_CheckResponseMsg(me, req, result.readData, result.readLen) > 0;
+}
+
+// Write registers then read registers in one transaction (FC23)
+bool
+ModbusDevRTU_WriteAndReadRegisters(ModbusCtx* me, int writeAddr,
+    const unsigned short* values, int writeCount,
+    int readAddr, unsigned short* dst, int readCount) {
+    int req_length;
+    uint8_t req[MAX_UART_WRITE_LEN];
+    UART_ReadResult result = { 0 };
+
+    if (writeCount < 1 || writeCount > MODBUS_MAX_RW_WRITE_REGISTERS
+        || readCount < 1 || readCount > MODBUS_MAX_READ_REGISTERS) {
+        return false;
+    }
+
+    req_length = ModbusRTU_CreateWriteMultipleMsg(me, FC_READ_WRITE_MULTIPLE_REGISTERS,
+        readAddr, readCount, writeAddr, values, writeCount, req);
+
+    if (! ModbusRTU_WriteAndRead(me, req, req_length,
+            ModbusRTU_GetReadResponseLength(me, FC_READ_WRITE_MULTIPLE_REGISTERS, readCount),
+            &result)) {
+        return false;
+    }
+
+    return ModbusRTU_ParseReadResponse(me, req, &result, dst);
 }
 
 // Get RTApp Version
@@ -28,21 +28,72 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+#include "ModbusDevConfig.h"
+
 typedef struct ModbusCtx ModbusCtx;
 
+// completion callback of asynchronous operation
+typedef void (*ModbusDevRTU_Callback)(void* arg, bool result);
+
+// read request of ModbusDevRTU_ReadRegisterBatch
+typedef struct ModbusReadRequest {
+    int             regAddr;
+    int             funcCode;
+    int             regCount;   // (<= MODBUS_MAX_READ_REGISTERS, FC01/FC02: MODBUS_MAX_READ_BITS)
+    bool            result;     // [out] succeeded or not
+    bool            responded;  // [out] device responded (even if invalid or exception)
+    unsigned short  values[MODBUS_MAX_READ_REGISTERS];  // [out] read values (FC01/FC02: packed bits)
+} ModbusReadRequest;
+
+// result handler of the poll table entry executed by RTApp
+//   values is NULL if failed
+typedef void (*ModbusDevRTU_PollHandler)(void* arg, int entryIndex, const unsigned short* values);
+
 // Initialization and cleanup
 extern ModbusCtx* ModbusDevRTU_Initialize(int devId, int baud, uint8_t parity, uint8_t stop);
 extern void ModbusDevRTU_Destroy(ModbusCtx* me);
 
+// Range of the response timeout (in milliseconds)
+//   the timeout is derived from the latency histogram of the device
+extern void ModbusDevRTU_SetTimeoutRange(ModbusCtx* me, uint32_t minTimeoutMs, uint32_t maxTimeoutMs);
+
+// Estimate the bus occupancy of a read request (in microseconds)
+extern uint32_t ModbusDevRTU_EstimateReadUs(ModbusCtx* me, int funcCode, int regCount);
+
 // Connect
 extern bool ModbusDevRTU_Connect(ModbusCtx* me);
+extern void ModbusDevRTU_ConnectAsync(ModbusCtx* me, ModbusDevRTU_Callback callback, void* arg);
+
+// Compare line parameters (baud rate, parity, stop bits)
+extern int ModbusDevRTU_CompareLineParams(const ModbusCtx* me, const ModbusCtx* other);
 
 // Read status/register
+//   bits of FC01/FC02 are packed into the values LSB first,
+//   bit i is (values[i >> 4] >> (i & 15)) & 1
 extern bool ModbusDevRTU_ReadRegister(ModbusCtx* me, int regAddr, int function, unsigned short* dst, int length);
+extern bool ModbusDevRTU_ReadRegisterBatch(ModbusCtx* me, ModbusReadRequest* reqs, int count);
+extern void ModbusDevRTU_ReadRegisterBatchAsync(ModbusCtx* me, ModbusReadRequest* reqs, int count,
+    ModbusDevRTU_Callback callback, void* arg);
+
+// Poll table executed by RTApp (results are pushed to the handler)
+//   ModbusDevRTU_AddPollEntry returns index of the entry, or -1 if full
+extern void ModbusDevRTU_ClearPollTable(void);
+extern int ModbusDevRTU_AddPollEntry(ModbusCtx* me, int funcCode, int regAddr, int regCount,
+    uint32_t intervalMs);
+extern bool ModbusDevRTU_LoadPollTable(ModbusDevRTU_PollHandler handler, void* arg);
 
 // Write 2byte
 extern bool ModbusDevRTU_WriteRegister(ModbusCtx* me, int regAddr, int funcCode, unsigned short value);
 
+// Write multiple coils (FC15, values are packed bits) or registers (FC16)
+extern bool ModbusDevRTU_WriteMultiple(ModbusCtx* me, int regAddr, int funcCode,
+    const unsigned short* values, int count);
+
+// Write registers then read registers in one transaction (FC23)
+extern bool ModbusDevRTU_WriteAndReadRegisters(ModbusCtx* me, int writeAddr,
+    const unsigned short* values, int writeCount,
+    int readAddr, unsigned short* dst, int readCount);
+
 // Get RTApp Version
 extern bool ModbusDevRTU_GetRTAppVersion(char* rtAppVersion);
 #endif  // _MODBUS_DEV_RTU_H_
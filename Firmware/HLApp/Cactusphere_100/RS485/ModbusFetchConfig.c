@@ -46,6 +46,11 @@ const char RegisterCountKey[]           = "registerCount";
 const char FuncCodeKey[]                = "funcCode";
 const char OffsetKey[]                  = "offset";
 const char IntervalKey[]                = "interval";
+const char IntervalMsKey[]              = "intervalMs";
+const char AlignToClockKey[]            = "alignToClock";
+const char OverrunPolicyKey[]           = "overrunPolicy";
+const char OverrunSkipValue[]           = "skip";
+const char OverrunCatchUpValue[]        = "catchUp";
 const char MultiplylKey[]               = "multiply";
 const char DeviderKey[]                 = "devider";
 const char AsFloatKey[]                 = "asFloat";
@@ -128,6 +133,7 @@ ModbusFetchConfig_LoadFromJSON(ModbusFetchConfig* me,
     for (unsigned int i = 0, n = configJson->u.object.length; i < n; ++i) {
         ModbusFetchItem pseudo;
         int setFlag = 0;
+        bool hasIntervalMs = false;
         json_value* configItem = configJson->u.object.values[i].value;
         size_t	strLen = strlen(configJson->u.object.values[i].name);
 
@@ -142,7 +148,9 @@ ModbusFetchConfig_LoadFromJSON(ModbusFetchConfig* me,
         pseudo.regCount = 0;
         pseudo.funcCode = 0;
         pseudo.offset = 0;
-        pseudo.intervalSec = 1;
+        pseudo.intervalMs = 1000;
+        pseudo.alignToClock = false;
+        pseudo.overrunPolicy = FETCH_OVERRUN_SKIP;
         pseudo.multiplier = 0;
         pseudo.devider = 0;
         pseudo.asFloat = false;
@@ -180,6 +188,8 @@ ModbusFetchConfig_LoadFromJSON(ModbusFetchConfig* me,
                 } else {
                     switch (pseudo.funcCode)
                     {
+                    case FC_READ_COILS:
+                    case FC_READ_DISCRETE_INPUTS:
                     case FC_READ_HOLDING_REGISTER:
                     case FC_READ_INPUT_REGISTERS:
                         setFlag += SET_TELEMETRYCONF_FUNCCODE;
@@ -191,11 +201,28 @@ ModbusFetchConfig_LoadFromJSON(ModbusFetchConfig* me,
                 }
             } else if (0 == strcmp(configItem->u.object.values[p].name, IntervalKey)) {
                 json_value* item = configItem->u.object.values[p].value;
-                bool ret_parse = json_GetNumericValue(item, &pseudo.intervalSec, 10);
-                if (!ret_parse || pseudo.intervalSec < 1 || pseudo.intervalSec > 86400) {
+                uint32_t intervalSec;
+                bool ret_parse = json_GetNumericValue(item, &intervalSec, 10);
+                if (!ret_parse || intervalSec < 1 || intervalSec > 86400) {
                     ret = false;
                 } else {
-                    setFlag += SET_TELEMETRYCONF_INTERVAL;
+                    if (!hasIntervalMs) {
+                        pseudo.intervalMs = intervalSec * 1000;
+                    }
+                    setFlag |= SET_TELEMETRYCONF_INTERVAL;
+                }
+            } else if (0 == strcmp(configItem->u.object.values[p].name, IntervalMsKey)) {
+                // sub-second acquisition, takes precedence over "interval"
+                json_value* item = configItem->u.object.values[p].value;
+                uint32_t intervalMs;
+                bool ret_parse = json_GetNumericValue(item, &intervalMs, 10);
+                if (!ret_parse || intervalMs < FETCH_ITEM_MIN_INTERVAL_MS
+                    || intervalMs > FETCH_ITEM_MAX_INTERVAL_MS) {
+                    ret = false;
+                } else {
+                    pseudo.intervalMs = intervalMs;
+                    setFlag |= SET_TELEMETRYCONF_INTERVAL;
+                    hasIntervalMs = true;
                 }
             } else if (0 == strcmp(configItem->u.object.values[p].name, OffsetKey)) {
                 json_value* item = configItem->u.object.values[p].value;
@@ -212,10 +239,27 @@ ModbusFetchConfig_LoadFromJSON(ModbusFetchConfig* me,
             } else if (0 == strcmp(configItem->u.object.values[p].name, AsFloatKey)) {
                 json_value* item = configItem->u.object.values[p].value;
                 pseudo.asFloat = item->u.boolean;
+            } else if (0 == strcmp(configItem->u.object.values[p].name, AlignToClockKey)) {
+                json_value* item = configItem->u.object.values[p].value;
+                pseudo.alignToClock = item->u.boolean;
+            } else if (0 == strcmp(configItem->u.object.values[p].name, OverrunPolicyKey)) {
+                json_value* item = configItem->u.object.values[p].value;
+                if (item->type != json_string) {
+                    ret = false;
+                } else if (0 == strcmp(item->u.string.ptr, OverrunSkipValue)) {
+                    pseudo.overrunPolicy = FETCH_OVERRUN_SKIP;
+                } else if (0 == strcmp(item->u.string.ptr, OverrunCatchUpValue)) {
+                    pseudo.overrunPolicy = FETCH_OVERRUN_CATCH_UP;
+                } else {
+                    ret = false;
+                }
             }
         }
         
-        if (setFlag == SET_TELEMETRYCONF_REQUIRED) {
+        // a coil or discrete input is one telemetry item
+        if (MODBUS_IS_BIT_READ(pseudo.funcCode) && pseudo.regCount != 1) {
+            ret = false;
+        } else if (setFlag == SET_TELEMETRYCONF_REQUIRED) {
             vector_add_last(me->mFetchItems, &pseudo);
         } else {
             ret = false;
@@ -31,7 +31,9 @@
 
 typedef struct ModbusFetchItem {
     char        telemetryName[TELEMETRY_NAME_MAX_LEN + 1];  // telemetry name
-    uint32_t    intervalSec;    // periodic acquisition interval (in seconds)
+    uint32_t    intervalMs;    // periodic acquisition interval (in milliseconds)
+    bool        alignToClock;  // expire at the multiples of interval in wall-clock time
+    uint8_t     overrunPolicy; // FetchOverrunPolicy
     uint32_t    devID;          // slave device ID
     uint32_t    regAddr;        // register address
     uint32_t    regCount;       // read register count
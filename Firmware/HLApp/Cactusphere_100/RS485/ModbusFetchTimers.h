@@ -0,0 +1,40 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Atmark Techno, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef _MODBUS_FETCH_TIMERS_H_
+#define _MODBUS_FETCH_TIMERS_H_
+
+#ifndef _FETCH_TIMERS_H_
+#include <FetchTimers.h>
+#endif
+
+// Phase balancing
+//   cost is the bus occupancy of the item (in microseconds), the items of
+//   a device with same interval share a phase to be merged into block reads
+extern uint32_t	ModbusFetchTimers_EstimateCost(
+    FetchTimers* me, const FetchItemBase* fetchItem);
+extern uint32_t	ModbusFetchTimers_GetPhaseGroup(
+    FetchTimers* me, const FetchItemBase* fetchItem);
+
+#endif  // _MODBUS_FETCH_TIMERS_H_
@@ -0,0 +1,90 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Atmark Techno, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "ModbusLatencyHist.h"
+
+#include <string.h>
+
+// halve the counts when the samples reach this number
+#define MODBUS_LATENCY_HIST_DECAY_COUNT	256
+
+// upper bound of each bucket (in microseconds)
+static const uint32_t	sBucketBounds[MODBUS_LATENCY_HIST_BUCKETS] = {
+    500, 1000, 2000, 3000, 5000, 7000, 10000, 15000, 20000,
+    30000, 50000, 70000, 100000, 150000, 200000, 300000, 500000,
+    1000000  // and longer
+};
+
+// Initialization
+void
+ModbusLatencyHist_Init(ModbusLatencyHist* me)
+{
+    memset(me, 0, sizeof(*me));
+}
+
+// Add a sample
+void
+ModbusLatencyHist_Add(ModbusLatencyHist* me, uint32_t latencyUs)
+{
+    int	i;
+
+    for (i = 0; i < MODBUS_LATENCY_HIST_BUCKETS - 1; ++i) {
+        if (latencyUs <= sBucketBounds[i]) {
+            break;
+        }
+    }
+    me->counts[i]++;
+    me->total++;
+
+    if (me->total >= MODBUS_LATENCY_HIST_DECAY_COUNT) {
+        me->total = 0;
+        for (i = 0; i < MODBUS_LATENCY_HIST_BUCKETS; ++i) {
+            me->counts[i] >>= 1;
+            me->total += me->counts[i];
+        }
+    }
+}
+
+// Number of samples
+uint32_t
+ModbusLatencyHist_GetCount(const ModbusLatencyHist* me)
+{
+    return me->total;
+}
+
+// Latency which permille of the samples don't exceed
+uint32_t
+ModbusLatencyHist_GetPercentileUs(const ModbusLatencyHist* me, uint32_t permille)
+{
+    uint32_t	threshold = (me->total * permille + 999) / 1000;
+    uint32_t	sum = 0;
+
+    for (int i = 0; i < MODBUS_LATENCY_HIST_BUCKETS; ++i) {
+        sum += me->counts[i];
+        if (sum >= threshold && sum > 0) {
+            return sBucketBounds[i];
+        }
+    }
+    return sBucketBounds[MODBUS_LATENCY_HIST_BUCKETS - 1];
+}
@@ -0,0 +1,55 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Atmark Techno, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef _MODBUS_LATENCY_HIST_H_
+#define _MODBUS_LATENCY_HIST_H_
+
+#ifndef _STDINT_H
+#include <stdint.h>
+#endif
+
+#define MODBUS_LATENCY_HIST_BUCKETS	18
+
+// histogram of response latency of a device
+//   the counts are halved periodically, so that old samples fade out
+typedef struct ModbusLatencyHist {
+    uint32_t    counts[MODBUS_LATENCY_HIST_BUCKETS];
+    uint32_t    total;      // number of samples (after halving)
+} ModbusLatencyHist;
+
+// Initialization
+extern void	ModbusLatencyHist_Init(ModbusLatencyHist* me);
+
+// Add a sample
+extern void	ModbusLatencyHist_Add(ModbusLatencyHist* me, uint32_t latencyUs);
+
+// Number of samples
+extern uint32_t	ModbusLatencyHist_GetCount(const ModbusLatencyHist* me);
+
+// Latency which permille of the samples don't exceed
+//   returns upper bound of the bucket (in microseconds)
+extern uint32_t	ModbusLatencyHist_GetPercentileUs(
+    const ModbusLatencyHist* me, uint32_t permille);
+
+#endif  // _MODBUS_LATENCY_HIST_H_
@@ -0,0 +1,52 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Atmark Techno, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef _MODBUS_READ_BLOCK_H_
+#define _MODBUS_READ_BLOCK_H_
+
+#ifndef _STDINT_H
+#include <stdint.h>
+#endif
+
+#ifndef CONTAINERS_VECTOR_H
+#include "vector.h"
+#endif
+
+// register range acquired by one read request
+typedef struct ModbusReadBlock {
+    uint32_t    funcCode;   // function code
+    uint32_t    regAddr;    // first register address
+    uint32_t    regCount;   // read register count (FC01/FC02: bit count)
+    int         firstItem;  // index of the first fetch item in the block
+    int         itemCount;  // number of fetch items in the block
+} ModbusReadBlock;
+
+// Merge fetch items into read blocks
+//   fetchItems (vector of ModbusFetchItem*) is sorted by function code and
+//   register address, then every run of items whose gap is at most maxGap
+//   registers becomes one ModbusReadBlock appended to outBlocks
+extern void	ModbusReadBlock_Build(
+    vector fetchItems, uint32_t maxGap, vector outBlocks);
+
+#endif  // _MODBUS_READ_BLOCK_H_
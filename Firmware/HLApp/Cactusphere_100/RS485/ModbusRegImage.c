@@ -0,0 +1,157 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Atmark Techno, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "ModbusRegImage.h"
+
+#include <string.h>
+#include <time.h>
+
+#include "ModbusDevConfig.h"
+#include "vector.h"
+
+// register block of the image
+typedef struct ModbusRegImageBlock {
+    char	source[MODBUS_REG_IMAGE_SOURCE_SIZE];
+    uint32_t	unitId;
+    uint32_t	funcCode;
+    uint32_t	regAddr;
+    uint32_t	regCount;
+    time_t	updated;    // time of acquisition (monotonic, in seconds)
+    unsigned short	values[MODBUS_MAX_READ_REGISTERS];
+} ModbusRegImageBlock;
+
+static vector	sBlocks = NULL;  // vector of ModbusRegImageBlock
+
+static time_t
+ModbusRegImage_GetMonotonicSec(void)
+{
+    struct timespec	now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec;
+}
+
+// Cleanup
+void
+ModbusRegImage_Clear(void)
+{
+    if (sBlocks != NULL) {
+        vector_clear(sBlocks);
+    }
+}
+
+void
+ModbusRegImage_Cleanup(void)
+{
+    if (sBlocks != NULL) {
+        vector_destroy(sBlocks);
+        sBlocks = NULL;
+    }
+}
+
+// Store the values of the read block
+void
+ModbusRegImage_Update(const char* source, uint32_t unitId,
+    uint32_t funcCode, uint32_t regAddr, uint32_t regCount, const unsigned short* values)
+{
+    ModbusRegImageBlock*	curs;
+    ModbusRegImageBlock	newBlock;
+
+    if ((funcCode != FC_READ_HOLDING_REGISTER && funcCode != FC_READ_INPUT_REGISTERS)
+        || regCount < 1 || regCount > MODBUS_MAX_READ_REGISTERS
+        || strlen(source) >= MODBUS_REG_IMAGE_SOURCE_SIZE) {
+        return;
+    }
+    if (sBlocks == NULL) {
+        sBlocks = vector_init(sizeof(ModbusRegImageBlock));
+        if (sBlocks == NULL) {
+            return;
+        }
+    }
+
+    // the blocks are the same every period while the configuration is kept
+    curs = (ModbusRegImageBlock*)vector_get_data(sBlocks);
+    for (int i = 0, n = vector_size(sBlocks); i < n; ++i, ++curs) {
+        if (curs->unitId == unitId && curs->funcCode == funcCode
+            && curs->regAddr == regAddr && curs->regCount == regCount
+            && 0 == strcmp(curs->source, source)) {
+            memcpy(curs->values, values, regCount * sizeof(unsigned short));
+            curs->updated = ModbusRegImage_GetMonotonicSec();
+            return;
+        }
+    }
+
+    strcpy(newBlock.source, source);
+    newBlock.unitId   = unitId;
+    newBlock.funcCode = funcCode;
+    newBlock.regAddr  = regAddr;
+    newBlock.regCount = regCount;
+    newBlock.updated  = ModbusRegImage_GetMonotonicSec();
+    memcpy(newBlock.values, values, regCount * sizeof(unsigned short));
+    vector_add_last(sBlocks, &newBlock);
+}
+
+// Read the registers
+bool
+ModbusRegImage_Read(const char* source, uint32_t unitId,
+    uint32_t funcCode, uint32_t regAddr, uint32_t regCount,
+    unsigned short* dst, uint32_t* ageSec)
+{
+    const ModbusRegImageBlock*	top;
+    int	n;
+    time_t	oldest = 0;
+
+    if (sBlocks == NULL) {
+        return false;
+    }
+    top = (const ModbusRegImageBlock*)vector_get_data(sBlocks);
+    n = vector_size(sBlocks);
+
+    // each register is taken from the latest block which has it
+    for (uint32_t k = 0; k < regCount; ++k) {
+        uint32_t	addr = regAddr + k;
+        const ModbusRegImageBlock*	found = NULL;
+
+        for (int i = 0; i < n; ++i) {
+            const ModbusRegImageBlock*	block = &top[i];
+
+            if (block->unitId == unitId && block->funcCode == funcCode
+                && block->regAddr <= addr && addr < block->regAddr + block->regCount
+                && (found == NULL || found->updated < block->updated)
+                && 0 == strcmp(block->source, source)) {
+                found = block;
+            }
+        }
+        if (found == NULL) {
+            return false;
+        }
+        dst[k] = found->values[addr - found->regAddr];
+        if (k == 0 || found->updated < oldest) {
+            oldest = found->updated;
+        }
+    }
+    *ageSec = (uint32_t)(ModbusRegImage_GetMonotonicSec() - oldest);
+
+    return true;
+}
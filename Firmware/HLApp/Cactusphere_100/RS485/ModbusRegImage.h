@@ -0,0 +1,60 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Atmark Techno, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef _MODBUS_REG_IMAGE_H_
+#define _MODBUS_REG_IMAGE_H_
+
+#ifndef _STDINT_H
+#include <stdint.h>
+#endif
+
+#include <stdbool.h>
+
+// source of the register blocks, RS-485 bus or a Modbus TCP server
+#define MODBUS_REG_IMAGE_SOURCE_RTU	"RTU"   // unit ID is devID
+#define MODBUS_REG_IMAGE_SOURCE_SIZE	22      // "ipAddr:port" and terminator
+
+// Image of the registers acquired by the data acquisition
+//   register blocks are stored per source, unit ID and function code
+//   (FC03/FC04), the local Modbus TCP server answers from it without bus
+//   traffic. The unit ID is the one in the source: devID for the RS-485
+//   bus, or unitId for the Modbus TCP server ("ipAddr:port"), so the same
+//   unit ID of the different sources never mixes.
+
+// Cleanup
+extern void	ModbusRegImage_Clear(void);
+extern void	ModbusRegImage_Cleanup(void);
+
+// Store the values of the read block (coils and discrete inputs are ignored)
+extern void	ModbusRegImage_Update(const char* source, uint32_t unitId,
+    uint32_t funcCode, uint32_t regAddr, uint32_t regCount, const unsigned short* values);
+
+// Read the registers
+//   returns false if any of them has never been acquired,
+//   ageSec is the elapsed time since the oldest of the blocks was acquired
+extern bool	ModbusRegImage_Read(const char* source, uint32_t unitId,
+    uint32_t funcCode, uint32_t regAddr, uint32_t regCount,
+    unsigned short* dst, uint32_t* ageSec);
+
+#endif  // _MODBUS_REG_IMAGE_H_
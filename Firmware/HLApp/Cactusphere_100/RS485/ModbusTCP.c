@@ -28,11 +28,17 @@
 #include <ctype.h>
 #include <stdbool.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
 #include <unistd.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include "ModbusTCP.h"
+#include "ModbusDevConfig.h"
+#include "ModbusTcpParser.h"
+#include "eventloop_timer_utilities.h"
 #include "vector.h"
 
 # include <netinet/in.h>
@@ -40,36 +46,70 @@
 # include <netinet/tcp.h>
 # include <arpa/inet.h>
 
-#define MODBUS_TCP_HEADER_LENGTH 7
+#define MODBUS_TCP_HEADER_LENGTH MODBUS_TCP_MBAP_HEADER_LENGTH
 #define MODBUS_TCP_CHECKSUM_LENGTH 0
 
 #define MIN_REQ_LENGTH 12
-#define MAX_MESSAGE_LENGTH 256
+#define MAX_REQ_LENGTH MODBUS_TCP_MAX_ADU_LENGTH
 
 #define MODBUS_TCP_PRESET_REQ_LENGTH 12
 
-// function
-#define FC_READ_HOLDING_REGISTER 0x03
-#define FC_READ_INPUT_REGISTERS 0x04
-#define FC_WRITE_SINGLE_REGISTER 0x06
+// persistent connection
+#define MODBUS_TCP_KEEPIDLE_SEC     30   // TCP keepalive
+#define MODBUS_TCP_KEEPINTVL_SEC    10
+#define MODBUS_TCP_KEEPCNT          3
+#define MODBUS_TCP_MIN_BACKOFF_SEC  1    // first reconnect interval after failure
+#define MODBUS_TCP_MAX_BACKOFF_SEC  60
 
-typedef enum {
-    PARSE_FUNCTION,
-    PARSE_META,
-    PARSE_DATA
+// pipelined transactions
+#define MODBUS_TCP_RESPONSE_TIMEOUT_MS  3000
 
-}PARSE_STEP;
+// request submitted to the connection
+typedef struct ModbusTCP_Request {
+    uint8_t req[MAX_REQ_LENGTH];
+    int     reqLength;
+    unsigned short* dst;        // [out] read values (NULL if nothing to read)
+    bool    isSent;
+    struct timespec deadline;   // of the response (valid if sent)
+    ModbusTCP_Callback callback;
+    void*   arg;
+}ModbusTCP_Request;
 
 // ModbusTCP structure
 typedef struct ModbusTcpCtx {
-    int socket;
+    int socket;     // -1: not connected
     uint16_t t_id;
     char ip[16];
     int port;
     int header_length;
     int checksum_length;
+    uint32_t backoffSec;    // current reconnect interval
+    time_t nextRetry;   // time of the next connect (monotonic, in seconds)
+    bool isConnecting;  // connect() in progress
+    int connectTimeoutMs;
+    struct timespec connectDeadline;    // of the connect in progress
+    int maxInFlight;    // requests pipelined on the connection
+    int inFlight;       // requests sent (at the head of requests)
+    vector requests;    // vector of ModbusTCP_Request (in submitted order)
+    uint8_t txBuf[MAX_REQ_LENGTH];  // request being sent
+    int txLength;
+    int txOffset;
+    ModbusTcpParser* parser;    // received responses
+    EventRegistration* sockReg;
 }ModbusTcpCtx;
 
+static EventLoop* sEventLoop = NULL;
+static EventLoopTimer* sDeadlineTimer = NULL;
+static vector sActiveCtxs = NULL;   // vector of ModbusTcpCtx* which has requests
+
+static time_t
+ModbusTCP_GetMonotonicSec(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec;
+}
+
 static int
 ModbusTCP_CreateRequestMsg(ModbusTcpCtx* me, uint8_t unitId, int function, int addr, int nb, uint8_t *req) {
 
@@ -100,8 +140,73 @@ ModbusTCP_CreateRequestMsg(ModbusTcpCtx* me, uint8_t unitId, int function, int a
     return MODBUS_TCP_PRESET_REQ_LENGTH;
 }
 
+// Create request of FC15/FC16/FC23
+//   FC15: values are bits packed LSB first (bit i is (values[i >> 4] >> (i & 15)) & 1)
+//   FC23: writes values to wAddr, and reads the registers of addr/nb
+static int
+ModbusTCP_CreateWriteMultipleMsg(ModbusTcpCtx* me, uint8_t unitId, int function, int addr, int nb,
+    int wAddr, const unsigned short* values, int count, uint8_t* req) {
+    int req_length = ModbusTCP_CreateRequestMsg(me, unitId, function, addr, nb, req);
+    int mbap_length;
+    int byteCount;
+
+    if (function == FC_READ_WRITE_MULTIPLE_REGISTERS) {
+        req[req_length++] = (uint8_t)(wAddr >> 8);
+        req[req_length++] = (uint8_t)(wAddr & 0x00ff);
+        req[req_length++] = (uint8_t)(count >> 8);
+        req[req_length++] = (uint8_t)(count & 0x00ff);
+    }
+
+    if (function == FC_WRITE_MULTIPLE_COILS) {
+        byteCount = (count + 7) >> 3;
+        req[req_length++] = (uint8_t)byteCount;
+        for (int i = 0; i < byteCount; i++) {
+            req[req_length++] = (uint8_t)(values[i >> 1] >> ((i & 1) << 3));
+        }
+    } else {
+        req[req_length++] = (uint8_t)(count << 1);
+        for (int i = 0; i < count; i++) {
+            req[req_length++] = (uint8_t)(values[i] >> 8);
+            req[req_length++] = (uint8_t)(values[i] & 0x00ff);
+        }
+    }
+
+    mbap_length = req_length - 6;
+    req[4] = (uint8_t)(mbap_length >> 8);
+    req[5] = (uint8_t)(mbap_length & 0x00FF);
+
+    return req_length;
+}
+
+// Create request of FC01-04 (0 if the count is out of range)
+static int
+ModbusTCP_CreateReadMsg(ModbusTcpCtx* me, int unitId, int regAddr, int function, int count,
+    uint8_t* req) {
+    int maxCount;
+
+    switch (function) {
+    case FC_READ_COILS:
+    case FC_READ_DISCRETE_INPUTS:
+        maxCount = MODBUS_MAX_READ_BITS;
+        break;
+    case FC_READ_HOLDING_REGISTER:
+    case FC_READ_INPUT_REGISTERS:
+        maxCount = MODBUS_MAX_READ_REGISTERS;
+        break;
+    default:
+        return 0;
+    }
+    if (count < 1 || count > maxCount) {
+        return 0;
+    }
+
+    return ModbusTCP_CreateRequestMsg(me, (uint8_t)unitId, function, regAddr, count, req);
+}
+
+// Check the response framed by the parser (protocol ID and length are valid)
 static int 
-ModbusTCP_CheckResponseMsg(ModbusTcpCtx* me, uint8_t* req, uint8_t* rsp){
+ModbusTCP_CheckResponseMsg(ModbusTcpCtx* me, const uint8_t* req, const uint8_t* rsp,
+    int rsp_length){
     int rc = 0;
     const int offset = me->header_length;
     const int function = rsp[offset];
@@ -112,20 +217,47 @@ ModbusTCP_CheckResponseMsg(ModbusTcpCtx* me, uint8_t* req, uint8_t* rsp){
         return -1;
     }
 
-    if (rsp[2] != 0x0 && rsp[3] != 0x0) {
+    // unit ID
+    if (req[offset - 1] != rsp[offset - 1]) {
         return -1;
     }
 
-    if (function >= 0x80) {
+    if (function >= 0x80 || function != req[offset]) {
         return -1;
     }
 
     switch (function) {
+    case FC_READ_COILS:
+    case FC_READ_DISCRETE_INPUTS:
+        // number of bits
+        req_calc_length = (req[offset + 3] << 8) + req[offset + 4];
+        rsp_calc_length = req_calc_length;
+        if (rsp_length != offset + 2 + rsp[offset + 1]
+            || rsp[offset + 1] != ((req_calc_length + 7) >> 3)) {
+            return -1;
+        }
+        break;
     case FC_READ_HOLDING_REGISTER:
     case FC_READ_INPUT_REGISTERS:
+    case FC_READ_WRITE_MULTIPLE_REGISTERS:
+        // byte count must agree with the length of the frame
+        if (rsp_length != offset + 2 + rsp[offset + 1]) {
+            return -1;
+        }
         req_calc_length = (req[offset + 3] << 8) + req[offset + 4];
         rsp_calc_length = (rsp[offset + 1] / 2);
         break;
+    case FC_WRITE_FORCE_SINGLE_COIL:
+    case FC_WRITE_SINGLE_REGISTER:
+    case FC_WRITE_MULTIPLE_COILS:
+    case FC_WRITE_MULTIPLE_REGISTERS:
+        // echo of address and value (FC05/06), or address and quantity (FC15/16)
+        if (rsp_length != offset + 5
+            || memcmp(&req[offset + 1], &rsp[offset + 1], 4) != 0) {
+            return -1;
+        }
+        req_calc_length = rsp_calc_length = 1;
+        break;
     default:
         req_calc_length = rsp_calc_length = 1;
         break;
@@ -138,84 +270,440 @@ ModbusTCP_CheckResponseMsg(ModbusTcpCtx* me, uint8_t* req, uint8_t* rsp){
     return rc;
 }
 
-static int
-ModbusTCP_RecieveMsg(ModbusTcpCtx* me, uint8_t* msg) {
-    int rc = 0;
-    int rsp_length = 0;
-    int msg_length = 0;
-    PARSE_STEP step = PARSE_FUNCTION;
-
-    rsp_length = me->header_length + 1;
-
-    while (rsp_length != 0) {
-        rc = recv(me->socket, (char*)msg + msg_length, (size_t)rsp_length, 0);
-        msg_length += rc;
-        rsp_length -= rc;
-
-        if (rsp_length == 0) {
-            switch (step) {
-            case PARSE_FUNCTION:
-                if (msg[me->header_length] == FC_WRITE_SINGLE_REGISTER) {
-                    rsp_length = 4;
-                }
-                else {
-                    rsp_length = 1;
-                }
-                step = PARSE_META;
-                break;
-            case PARSE_META:
-                if (msg[me->header_length] == FC_READ_HOLDING_REGISTER) {
-                    rsp_length = msg[me->header_length + 1];
-                }
-                else {
-                    rsp_length = 0;
-                }
-                step = PARSE_DATA;
-                break;
-            default:
-                break;
+// Store the read values of the response
+//   bits of FC01/FC02 are packed LSB first
+static void
+ModbusTCP_ParseReadResponse(ModbusTcpCtx* me, const uint8_t* rsp, int rc, unsigned short* dst) {
+    const int offset = me->header_length;
+    int i;
+
+    if (MODBUS_IS_BIT_READ(rsp[offset])) {
+        const int byteCount = rsp[offset + 1];
+
+        memset(dst, 0, (size_t)((rc + 15) >> 4) * sizeof(unsigned short));
+        for (i = 0; i < byteCount; i++) {
+            dst[i >> 1] |= (unsigned short)(rsp[offset + 2 + i] << ((i & 1) << 3));
+        }
+        return;
+    }
+
+    for (i = 0; i < rc; i++) {
+        dst[i] = (unsigned short)((rsp[offset + 2 + (i << 1)] << 8) |
+            rsp[offset + 3 + (i << 1)]);
+    }
+}
+
+static void
+ModbusTCP_SetDeadline(struct timespec* deadline, long ms) {
+    clock_gettime(CLOCK_MONOTONIC, deadline);
+    deadline->tv_sec += ms / 1000;
+    deadline->tv_nsec += (ms % 1000) * 1000000;
+    if (deadline->tv_nsec >= 1000000000) {
+        deadline->tv_sec++;
+        deadline->tv_nsec -= 1000000000;
+    }
+}
+
+static long
+ModbusTCP_GetRemainingMs(const struct timespec* deadline) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long)(deadline->tv_sec - now.tv_sec) * 1000
+        + (deadline->tv_nsec - now.tv_nsec) / 1000000;
+}
+
+static void
+ModbusTCP_SetActive(ModbusTcpCtx* me, bool isActive) {
+    ModbusTcpCtx** curs = (ModbusTcpCtx**)vector_get_data(sActiveCtxs);
+
+    for (int i = 0, n = vector_size(sActiveCtxs); i < n; ++i) {
+        if (curs[i] == me) {
+            if (! isActive) {
+                vector_remove_at(sActiveCtxs, i);
             }
+            return;
         }
     }
-    return msg_length;
+    if (isActive) {
+        vector_add_last(sActiveCtxs, &me);
+    }
 }
 
+// Earliest deadline of the connect or the requests in flight (false if none)
 static bool
-ModbusTCP_ReadRegister(ModbusTcpCtx* me, int unitId, int regAddr, int function, unsigned short* dst) {
-    int rc;
-    int req_length;
-    uint8_t req[MIN_REQ_LENGTH];
-    uint8_t rsp[MAX_MESSAGE_LENGTH];
-    int length = 1;
-    int sendSize = 0;
+ModbusTCP_GetEarliestDeadline(const ModbusTcpCtx* me, struct timespec* deadline) {
+    const ModbusTCP_Request* req = (const ModbusTCP_Request*)vector_get_data(me->requests);
+    bool found = false;
+
+    if (me->isConnecting) {
+        *deadline = me->connectDeadline;
+        found = true;
+    }
+    for (int i = 0; i < me->inFlight; ++i, ++req) {
+        if (! found || req->deadline.tv_sec < deadline->tv_sec
+            || (req->deadline.tv_sec == deadline->tv_sec
+                && req->deadline.tv_nsec < deadline->tv_nsec)) {
+            *deadline = req->deadline;
+            found = true;
+        }
+    }
+    return found;
+}
+
+static void
+ModbusTCP_ArmDeadlineTimer(void) {
+    ModbusTcpCtx** curs = (ModbusTcpCtx**)vector_get_data(sActiveCtxs);
+    long remainingMs = -1;
 
-    req_length = ModbusTCP_CreateRequestMsg(me, (uint8_t)unitId, function, regAddr, length, req);
-    rc = req_length;
+    if (sDeadlineTimer == NULL) {
+        return;
+    }
+    for (int i = 0, n = vector_size(sActiveCtxs); i < n; ++i) {
+        struct timespec deadline;
+
+        if (ModbusTCP_GetEarliestDeadline(curs[i], &deadline)) {
+            long ms = ModbusTCP_GetRemainingMs(&deadline);
 
-    while (rc > 0) {
-        sendSize = send(me->socket, (const char*)req + sendSize, (size_t)rc, MSG_NOSIGNAL);
-        rc -= sendSize;
+            if (remainingMs < 0 || ms < remainingMs) {
+                remainingMs = (ms > 0) ? ms : 1;
+            }
+        }
     }
+    if (remainingMs < 0) {
+        DisarmEventLoopTimer(sDeadlineTimer);
+    } else {
+        struct timespec delay = {
+            .tv_sec = remainingMs / 1000, .tv_nsec = (remainingMs % 1000) * 1000000 };
 
-    if (rc >= 0) {
-        int offset;
-        int i;
+        SetEventLoopTimerOneShot(sDeadlineTimer, &delay);
+    }
+}
+
+static void
+ModbusTCP_UpdateIoEvents(ModbusTcpCtx* me) {
+    if (me->sockReg != NULL) {
+        EventLoop_ModifyIoEvents(sEventLoop, me->sockReg, EventLoop_Input
+            | ((me->isConnecting || me->txOffset < me->txLength) ? EventLoop_Output : 0));
+    }
+}
 
-        rc = ModbusTCP_RecieveMsg(me, rsp);
+// Complete the request with its response (NULL if failed or timed out)
+static void
+ModbusTCP_Complete(ModbusTcpCtx* me, int index, const uint8_t* rsp, int rsp_length) {
+    ModbusTCP_Request req;
+    bool result = false;
 
-        rc = ModbusTCP_CheckResponseMsg(me, req, rsp);
-        if (rc == -1)
+    vector_get_at(&req, me->requests, index);
+    vector_remove_at(me->requests, index);
+    if (req.isSent) {
+        me->inFlight--;
+    }
+    if (vector_is_empty(me->requests) && ! me->isConnecting) {
+        ModbusTCP_SetActive(me, false);
+    }
+
+    if (rsp != NULL) {
+        int rc = ModbusTCP_CheckResponseMsg(me, req.req, rsp, rsp_length);
+
+        if (rc > 0) {
+            if (req.dst != NULL) {
+                ModbusTCP_ParseReadResponse(me, rsp, rc, req.dst);
+            }
+            result = true;
+        }
+    }
+    req.callback(req.arg, result);
+}
+
+static void
+ModbusTCP_FailAll(ModbusTcpCtx* me) {
+    while (! vector_is_empty(me->requests)) {
+        ModbusTCP_Complete(me, 0, NULL, 0);
+    }
+}
+
+// Send the rest of the request (false if the connection is broken)
+static bool
+ModbusTCP_Flush(ModbusTcpCtx* me) {
+    while (me->txOffset < me->txLength) {
+        int sent = send(me->socket, (const char*)me->txBuf + me->txOffset,
+            (size_t)(me->txLength - me->txOffset), MSG_NOSIGNAL | MSG_DONTWAIT);
+
+        if (sent < 0) {
+            return (errno == EAGAIN || errno == EWOULDBLOCK);  // wait for writable
+        }
+        me->txOffset += sent;
+    }
+    return true;
+}
+
+// Send the queued requests while the pipeline has room
+static bool
+ModbusTCP_SendNext(ModbusTcpCtx* me) {
+    if (me->isConnecting) {
+        return true;  // sent after connected
+    }
+    while (me->txOffset == me->txLength && me->inFlight < me->maxInFlight
+        && me->inFlight < vector_size(me->requests)) {
+        ModbusTCP_Request* req = (ModbusTCP_Request*)vector_get_data(me->requests) + me->inFlight;
+
+        memcpy(me->txBuf, req->req, (size_t)req->reqLength);
+        me->txLength = req->reqLength;
+        me->txOffset = 0;
+
+        req->isSent = true;
+        ModbusTCP_SetDeadline(&req->deadline, MODBUS_TCP_RESPONSE_TIMEOUT_MS);
+        me->inFlight++;
+
+        if (! ModbusTCP_Flush(me)) {
             return false;
+        }
+    }
+    ModbusTCP_UpdateIoEvents(me);
+    return true;
+}
 
-        offset = me->header_length;
+// Match the response to the request in flight by the transaction ID
+static void
+ModbusTCP_OnResponse(ModbusTcpCtx* me, const uint8_t* rsp, int rsp_length) {
+    const ModbusTCP_Request* req = (const ModbusTCP_Request*)vector_get_data(me->requests);
 
-        for (i = 0; i < rc; i++) {
-            dst[i] = (unsigned short)((rsp[offset + 2 + (i << 1)] << 8) |
-                rsp[offset + 3 + (i << 1)]);
+    for (int i = 0; i < me->inFlight; ++i, ++req) {
+        if (req->req[0] == rsp[0] && req->req[1] == rsp[1]) {
+            ModbusTCP_Complete(me, i, rsp, rsp_length);
+            return;
         }
     }
+    // late response of the request already timed out, discard it
+}
 
-    return rc;
+// Receive the responses (false if the connection is broken)
+//   a segment may have a part of a response or several responses
+static bool
+ModbusTCP_Receive(ModbusTcpCtx* me) {
+    for (;;) {
+        const uint8_t* rsp;
+        int space;
+        uint8_t* buf = ModbusTcpParser_GetWriteBuf(me->parser, &space);
+        int rc = recv(me->socket, (char*)buf, (size_t)space, MSG_DONTWAIT);
+
+        if (rc == 0) {
+            return false;  // closed by peer
+        } else if (rc < 0) {
+            return (errno == EAGAIN || errno == EWOULDBLOCK);
+        }
+        ModbusTcpParser_Commit(me->parser, rc);
+
+        while (0 < (rc = ModbusTcpParser_Next(me->parser, &rsp))) {
+            ModbusTCP_OnResponse(me, rsp, rc);
+            if (me->socket == -1) {
+                return true;  // disconnected by the callback
+            }
+        }
+        if (rc < 0) {
+            return false;  // out of sync, reset the connection
+        }
+    }
+}
+
+static void
+ModbusTCP_CheckTimeouts(ModbusTcpCtx* me) {
+    int i = 0;
+
+    while (i < me->inFlight) {
+        const ModbusTCP_Request* req = (const ModbusTCP_Request*)vector_get_data(me->requests) + i;
+
+        if (ModbusTCP_GetRemainingMs(&req->deadline) <= 0) {
+            ModbusTCP_Complete(me, i, NULL, 0);
+            if (me->socket == -1) {
+                return;
+            }
+            i = 0;  // the callback may change the requests
+        } else {
+            ++i;
+        }
+    }
+}
+
+// Retry the connect later at exponentially growing intervals
+static void
+ModbusTCP_BackOff(ModbusTcpCtx* me) {
+    me->nextRetry = ModbusTCP_GetMonotonicSec() + me->backoffSec;
+    me->backoffSec *= 2;
+    if (me->backoffSec > MODBUS_TCP_MAX_BACKOFF_SEC) {
+        me->backoffSec = MODBUS_TCP_MAX_BACKOFF_SEC;
+    }
+}
+
+static void
+ModbusTCP_OnConnected(ModbusTcpCtx* me) {
+    me->isConnecting = false;
+    me->backoffSec = MODBUS_TCP_MIN_BACKOFF_SEC;
+    me->nextRetry = 0;
+    if (vector_is_empty(me->requests)) {
+        ModbusTCP_SetActive(me, false);
+    }
+}
+
+// Check the connect in progress (false if failed or timed out)
+static bool
+ModbusTCP_CheckConnect(ModbusTcpCtx* me) {
+    struct pollfd pfd = { .fd = me->socket, .events = POLLOUT };
+    int err = 0;
+    socklen_t errLength = sizeof(err);
+    int rc = poll(&pfd, 1, 0);
+
+    if (rc < 0) {
+        return (errno == EINTR);
+    } else if (rc == 0) {
+        return (ModbusTCP_GetRemainingMs(&me->connectDeadline) > 0);
+    }
+    if (-1 == getsockopt(me->socket, SOL_SOCKET, SO_ERROR, (void*)&err, &errLength)
+        || err != 0) {
+        return false;
+    }
+    ModbusTCP_OnConnected(me);
+
+    return true;
+}
+
+// Do the pending I/O of the connection (non-blocking)
+static void
+ModbusTCP_Process(ModbusTcpCtx* me) {
+    if (me->isConnecting) {
+        if (! ModbusTCP_CheckConnect(me)) {
+            ModbusTCP_Disconnect(me);  // the queued requests fail
+            ModbusTCP_BackOff(me);
+            return;
+        }
+        if (me->isConnecting) {
+            return;
+        }
+    }
+    if (! ModbusTCP_Flush(me) || ! ModbusTCP_Receive(me)) {
+        ModbusTCP_Disconnect(me);  // closed by peer or error
+        return;
+    }
+    if (me->socket == -1) {
+        return;
+    }
+    ModbusTCP_CheckTimeouts(me);
+    if (me->socket != -1 && ! ModbusTCP_SendNext(me)) {
+        ModbusTCP_Disconnect(me);
+    }
+}
+
+// Process the connection without the event loop
+// until the flag is set (or the connect and all the requests complete if NULL)
+static void
+ModbusTCP_ProcessUntil(ModbusTcpCtx* me, const bool* isDone) {
+    while (me->socket != -1 && (me->isConnecting || ! vector_is_empty(me->requests))
+        && (isDone == NULL || ! *isDone)) {
+        struct pollfd pfd = { .fd = me->socket, .events = POLLIN };
+        struct timespec deadline;
+        long remainingMs = MODBUS_TCP_RESPONSE_TIMEOUT_MS;
+
+        if (me->isConnecting || me->txOffset < me->txLength) {
+            pfd.events |= POLLOUT;
+        }
+        if (ModbusTCP_GetEarliestDeadline(me, &deadline)) {
+            remainingMs = ModbusTCP_GetRemainingMs(&deadline);
+        }
+        if (poll(&pfd, 1, (int)(remainingMs > 0 ? remainingMs : 0)) < 0 && errno != EINTR) {
+            ModbusTCP_Disconnect(me);
+            break;
+        }
+        ModbusTCP_Process(me);
+    }
+    ModbusTCP_ArmDeadlineTimer();
+}
+
+static void
+ModbusTCP_SocketEventHandler(EventLoop* el, int fd, EventLoop_IoEvents events, void* context) {
+    ModbusTCP_Process((ModbusTcpCtx*)context);
+    ModbusTCP_ArmDeadlineTimer();
+}
+
+static void
+ModbusTCP_DeadlineTimerEventHandler(EventLoopTimer* timer) {
+    int i = 0;
+
+    if (ConsumeEventLoopTimerEvent(timer) != 0) {
+        return;
+    }
+    // the callbacks may change the active connections, rescan after each
+    while (i < vector_size(sActiveCtxs)) {
+        ModbusTcpCtx* ctx;
+        struct timespec deadline;
+
+        vector_get_at(&ctx, sActiveCtxs, i);
+        if (ModbusTCP_GetEarliestDeadline(ctx, &deadline)
+            && ModbusTCP_GetRemainingMs(&deadline) <= 0) {
+            ModbusTCP_Process(ctx);
+            i = 0;
+        } else {
+            ++i;
+        }
+    }
+    ModbusTCP_ArmDeadlineTimer();
+}
+
+// Submit the request (callback is not called if failed to submit)
+static bool
+ModbusTCP_Submit(ModbusTcpCtx* me, const uint8_t* reqMsg, int req_length,
+    unsigned short* dst, ModbusTCP_Callback callback, void* arg) {
+    ModbusTCP_Request req = {
+        .reqLength = req_length, .dst = dst, .isSent = false,
+        .callback = callback, .arg = arg };
+
+    if (me->socket == -1) {
+        return false;
+    }
+    memcpy(req.req, reqMsg, (size_t)req_length);
+    if (0 != vector_add_last(me->requests, &req)) {
+        return false;
+    }
+    ModbusTCP_SetActive(me, true);
+
+    if (! ModbusTCP_SendNext(me)) {
+        ModbusTCP_Disconnect(me);  // the request fails by callback
+        return true;
+    }
+    if (sEventLoop == NULL) {
+        ModbusTCP_ProcessUntil(me, NULL);  // no event loop, complete here
+    } else {
+        ModbusTCP_ArmDeadlineTimer();
+    }
+    return true;
+}
+
+// context of the synchronous request
+typedef struct ModbusTCP_SyncCtx {
+    bool isDone;
+    bool result;
+}ModbusTCP_SyncCtx;
+
+static void
+ModbusTCP_SyncCallback(void* arg, bool result) {
+    ModbusTCP_SyncCtx* ctx = (ModbusTCP_SyncCtx*)arg;
+
+    ctx->result = result;
+    ctx->isDone = true;
+}
+
+// Send the request, then wait for its response
+//   dst receives the read values if not NULL
+static bool
+ModbusTCP_Transact(ModbusTcpCtx* me, const uint8_t* req, int req_length, unsigned short* dst) {
+    ModbusTCP_SyncCtx ctx = { .isDone = false, .result = false };
+
+    if (! ModbusTCP_Submit(me, req, req_length, dst, ModbusTCP_SyncCallback, &ctx)) {
+        return false;
+    }
+    ModbusTCP_ProcessUntil(me, &ctx.isDone);
+
+    return ctx.result;
 }
 
 // Initialization and cleanup
@@ -224,11 +712,19 @@ ModbusTCP_Initialize(const char* ip, int port) {
     ModbusTcpCtx* newObj;
     size_t dest_size;
 
+    if (sActiveCtxs == NULL) {
+        sActiveCtxs = vector_init(sizeof(ModbusTcpCtx*));
+    }
+
     newObj = (ModbusTcpCtx*)malloc(sizeof(ModbusTcpCtx));
 
-    newObj->socket = 0;
+    newObj->socket = -1;
     newObj->port = port;
     newObj->t_id = 0;
+    newObj->backoffSec = MODBUS_TCP_MIN_BACKOFF_SEC;
+    newObj->nextRetry = 0;
+    newObj->isConnecting = false;
+    newObj->connectTimeoutMs = MODBUS_TCP_DEFAULT_CONNECT_TIMEOUT_MS;
 
     dest_size = sizeof(char) * 16;
     strncpy(newObj->ip, ip, dest_size);
@@ -236,17 +732,87 @@ ModbusTCP_Initialize(const char* ip, int port) {
     newObj->header_length = MODBUS_TCP_HEADER_LENGTH;
     newObj->checksum_length = MODBUS_TCP_CHECKSUM_LENGTH;
 
+    newObj->maxInFlight = 1;
+    newObj->inFlight = 0;
+    newObj->requests = vector_init(sizeof(ModbusTCP_Request));
+    newObj->txLength = 0;
+    newObj->txOffset = 0;
+    newObj->parser = ModbusTcpParser_New();
+    newObj->sockReg = NULL;
+
     return newObj;
 }
 
 void
 ModbusTCP_Destroy(ModbusTcpCtx* me) {
+    ModbusTCP_Disconnect(me);
+    vector_destroy(me->requests);
+    ModbusTcpParser_Destroy(me->parser);
     free(me);
 }
 
-// Connect
-bool 
-ModbusTCP_Connect(ModbusTcpCtx* me) {
+// Process the connections on the event loop
+bool
+ModbusTCP_RegisterEventLoop(EventLoop* eventLoop) {
+    sDeadlineTimer = CreateEventLoopDisarmedTimer(eventLoop,
+        ModbusTCP_DeadlineTimerEventHandler);
+    if (sDeadlineTimer == NULL) {
+        return false;
+    }
+    sEventLoop = eventLoop;
+
+    return true;
+}
+
+void
+ModbusTCP_UnregisterEventLoop(void) {
+    if (sDeadlineTimer != NULL) {
+        DisposeEventLoopTimer(sDeadlineTimer);
+        sDeadlineTimer = NULL;
+    }
+    sEventLoop = NULL;
+}
+
+// Requests pipelined on the connection
+void
+ModbusTCP_SetMaxInFlight(ModbusTcpCtx* me, int maxInFlight) {
+    if (maxInFlight < 1) {
+        maxInFlight = 1;
+    } else if (maxInFlight > MODBUS_TCP_MAX_IN_FLIGHT) {
+        maxInFlight = MODBUS_TCP_MAX_IN_FLIGHT;
+    }
+    me->maxInFlight = maxInFlight;
+}
+
+// Deadline of connecting to the server
+void
+ModbusTCP_SetConnectTimeout(ModbusTcpCtx* me, int timeoutMs) {
+    if (timeoutMs < MODBUS_TCP_MIN_CONNECT_TIMEOUT_MS) {
+        timeoutMs = MODBUS_TCP_MIN_CONNECT_TIMEOUT_MS;
+    } else if (timeoutMs > MODBUS_TCP_MAX_CONNECT_TIMEOUT_MS) {
+        timeoutMs = MODBUS_TCP_MAX_CONNECT_TIMEOUT_MS;
+    }
+    me->connectTimeoutMs = timeoutMs;
+}
+
+// Process the requests until all of them complete
+void
+ModbusTCP_WaitIdle(void) {
+    while (sActiveCtxs != NULL && ! vector_is_empty(sActiveCtxs)) {
+        ModbusTcpCtx* ctx;
+
+        vector_get_first(&ctx, sActiveCtxs);
+        ModbusTCP_ProcessUntil(ctx, NULL);
+        if (ctx->socket == -1) {
+            ModbusTCP_Disconnect(ctx);  // never happens, requests need connection
+        }
+    }
+}
+
+// Open a new connection with keepalive
+//   connect() is not blocked, it is completed by the event loop or poll()
+static bool
+ModbusTCP_Open(ModbusTcpCtx* me) {
     struct sockaddr_in addr;
     int rc = 0;
     int option;
@@ -259,6 +825,28 @@ ModbusTCP_Connect(ModbusTcpCtx* me) {
     option = 1;
     rc = setsockopt(me->socket, IPPROTO_TCP, TCP_NODELAY,
         (const void*)&option, sizeof(int));
+    if (rc != -1) {
+        rc = setsockopt(me->socket, SOL_SOCKET, SO_KEEPALIVE,
+            (const void*)&option, sizeof(int));
+    }
+    if (rc != -1) {
+        option = MODBUS_TCP_KEEPIDLE_SEC;
+        rc = setsockopt(me->socket, IPPROTO_TCP, TCP_KEEPIDLE,
+            (const void*)&option, sizeof(int));
+    }
+    if (rc != -1) {
+        option = MODBUS_TCP_KEEPINTVL_SEC;
+        rc = setsockopt(me->socket, IPPROTO_TCP, TCP_KEEPINTVL,
+            (const void*)&option, sizeof(int));
+    }
+    if (rc != -1) {
+        option = MODBUS_TCP_KEEPCNT;
+        rc = setsockopt(me->socket, IPPROTO_TCP, TCP_KEEPCNT,
+            (const void*)&option, sizeof(int));
+    }
+    if (rc != -1) {
+        rc = fcntl(me->socket, F_SETFL, fcntl(me->socket, F_GETFL) | O_NONBLOCK);
+    }
 
     if (rc == -1) {
         close(me->socket);
@@ -271,57 +859,197 @@ ModbusTCP_Connect(ModbusTcpCtx* me) {
     addr.sin_addr.s_addr = inet_addr(me->ip);
 
     rc = connect(me->socket, (struct sockaddr*)&addr, sizeof(addr));
+    if (rc == -1 && errno == EINPROGRESS) {
+        me->isConnecting = true;
+        ModbusTCP_SetDeadline(&me->connectDeadline, me->connectTimeoutMs);
+        rc = 0;
+    }
+    if (rc != -1 && sEventLoop != NULL) {
+        me->sockReg = EventLoop_RegisterIo(sEventLoop, me->socket,
+            EventLoop_Input | (me->isConnecting ? EventLoop_Output : 0),
+            ModbusTCP_SocketEventHandler, me);
+        if (me->sockReg == NULL) {
+            rc = -1;
+        }
+    }
 
     if (rc == -1) {
         close(me->socket);
         me->socket = -1;
+        me->isConnecting = false;
+        return false;
+    }
+
+    return true;
+}
+
+// Start connecting (false if failed or backing off)
+//   the connection is kept open and reused, a failed connect is
+//   retried at exponentially growing intervals.
+//   Requests can be submitted while connecting, they are sent after connected.
+bool
+ModbusTCP_ConnectAsync(ModbusTcpCtx* me) {
+    if (me->socket != -1) {
+        return true;  // already connected (or connecting)
+    }
+
+    if (ModbusTCP_GetMonotonicSec() < me->nextRetry) {
+        return false;  // backing off
+    }
+    if (! ModbusTCP_Open(me)) {
+        ModbusTCP_BackOff(me);
         return false;
     }
+    if (me->isConnecting) {
+        ModbusTCP_SetActive(me, true);  // watched by the deadline timer
+        ModbusTCP_ArmDeadlineTimer();
+    } else {
+        ModbusTCP_OnConnected(me);
+    }
 
     return true;
 }
 
+// Connect
+//   waits for the connect in progress up to the deadline
+bool 
+ModbusTCP_Connect(ModbusTcpCtx* me) {
+    if (! ModbusTCP_ConnectAsync(me)) {
+        return false;
+    }
+    while (me->isConnecting) {
+        struct pollfd pfd = { .fd = me->socket, .events = POLLOUT };
+        long remainingMs = ModbusTCP_GetRemainingMs(&me->connectDeadline);
+
+        if (poll(&pfd, 1, (int)(remainingMs > 0 ? remainingMs : 0)) < 0 && errno != EINTR) {
+            ModbusTCP_Disconnect(me);
+            ModbusTCP_BackOff(me);
+            break;
+        }
+        ModbusTCP_Process(me);
+    }
+    ModbusTCP_ArmDeadlineTimer();
+
+    return (me->socket != -1);
+}
+
 // Disconnect
+//   the requests submitted to the connection fail
 void 
 ModbusTCP_Disconnect(ModbusTcpCtx* me) {
-    close(me->socket);
-    me->socket = -1;
+    if (me->socket != -1) {
+        if (me->sockReg != NULL) {
+            EventLoop_UnregisterIo(sEventLoop, me->sockReg);
+            me->sockReg = NULL;
+        }
+        close(me->socket);
+        me->socket = -1;
+    }
+    me->isConnecting = false;
+    me->txLength = 0;
+    me->txOffset = 0;
+    ModbusTcpParser_Reset(me->parser);
+    ModbusTCP_FailAll(me);
+    ModbusTCP_SetActive(me, false);
 }
 
 // Read single register
 bool 
 ModbusTCP_ReadSingleRegister(ModbusTcpCtx* me, int unitId, int regAddr, unsigned short* dst) {
-    return ModbusTCP_ReadRegister(me, unitId, regAddr, FC_READ_HOLDING_REGISTER, dst);
+    return ModbusTCP_ReadRegisters(me, unitId, regAddr, FC_READ_HOLDING_REGISTER, dst, 1);
 }
 
 bool
 ModbusTCP_ReadSingleInputRegister(ModbusTcpCtx* me, int unitId, int regAddr, unsigned short* dst) {
-    return ModbusTCP_ReadRegister(me, unitId, regAddr, FC_READ_INPUT_REGISTERS, dst);
+    return ModbusTCP_ReadRegisters(me, unitId, regAddr, FC_READ_INPUT_REGISTERS, dst, 1);
+}
+
+// Read coils, discrete inputs (bits are packed LSB first) or registers
+bool
+ModbusTCP_ReadRegisters(ModbusTcpCtx* me, int unitId, int regAddr, int function,
+    unsigned short* dst, int count) {
+    int req_length;
+    uint8_t req[MIN_REQ_LENGTH];
+
+    req_length = ModbusTCP_CreateReadMsg(me, unitId, regAddr, function, count, req);
+    if (req_length == 0) {
+        return false;
+    }
+
+    return ModbusTCP_Transact(me, req, req_length, dst);
+}
+
+// Read asynchronously (pipelined up to maxInFlight requests)
+bool
+ModbusTCP_ReadRegistersAsync(ModbusTcpCtx* me, int unitId, int regAddr, int function,
+    unsigned short* dst, int count, ModbusTCP_Callback callback, void* arg) {
+    int req_length;
+    uint8_t req[MIN_REQ_LENGTH];
+
+    req_length = ModbusTCP_CreateReadMsg(me, unitId, regAddr, function, count, req);
+    if (req_length == 0) {
+        return false;
+    }
+
+    return ModbusTCP_Submit(me, req, req_length, dst, callback, arg);
 }
 
 // Write single register
 bool
 ModbusTCP_WriteSingleRegister(ModbusTcpCtx* me, int unitId, int regAddr, unsigned short value) {
-    int function = FC_WRITE_SINGLE_REGISTER;
-    int rc;
     int req_length;
     uint8_t req[MIN_REQ_LENGTH];
-    uint8_t rsp[MAX_MESSAGE_LENGTH];
-    int sendSize = 0;
 
-    req_length = ModbusTCP_CreateRequestMsg(me, (uint8_t)unitId, function, regAddr, (int)value, req);
-    rc = req_length;
+    req_length = ModbusTCP_CreateRequestMsg(me, (uint8_t)unitId, FC_WRITE_SINGLE_REGISTER,
+        regAddr, (int)value, req);
+
+    return ModbusTCP_Transact(me, req, req_length, NULL);
+}
+
+// Write multiple coils (FC15, values are packed bits) or registers (FC16)
+bool
+ModbusTCP_WriteMultiple(ModbusTcpCtx* me, int unitId, int regAddr, int function,
+    const unsigned short* values, int count) {
+    int req_length;
+    uint8_t req[MAX_REQ_LENGTH];
+    int maxCount;
 
-    while (rc > 0) {
-        sendSize = send(me->socket, (const char*)req + sendSize, (size_t)rc, MSG_NOSIGNAL);
-        rc -= sendSize;
+    switch (function) {
+    case FC_WRITE_MULTIPLE_COILS:
+        maxCount = MODBUS_MAX_WRITE_BITS;
+        break;
+    case FC_WRITE_MULTIPLE_REGISTERS:
+        maxCount = MODBUS_MAX_WRITE_REGISTERS;
+        break;
+    default:
+        return false;
+    }
+    if (count < 1 || count > maxCount) {
+        return false;
     }
 
-    if (rc >= 0) {
-        rc = ModbusTCP_RecieveMsg(me, rsp);
-        rc = ModbusTCP_CheckResponseMsg(me, req, rsp);
-        if (rc == -1)
-            return false;
+    req_length = ModbusTCP_CreateWriteMultipleMsg(me, (uint8_t)unitId, function,
+        regAddr, count, 0, values, count, req);
+
+    return ModbusTCP_Transact(me, req, req_length, NULL);
+}
+
+// Write registers then read registers in one transaction (FC23)
+bool
+ModbusTCP_WriteAndReadRegisters(ModbusTcpCtx* me, int unitId, int writeAddr,
+    const unsigned short* values, int writeCount,
+    int readAddr, unsigned short* dst, int readCount) {
+    int req_length;
+    uint8_t req[MAX_REQ_LENGTH];
+
+    if (writeCount < 1 || writeCount > MODBUS_MAX_RW_WRITE_REGISTERS
+        || readCount < 1 || readCount > MODBUS_MAX_READ_REGISTERS) {
+        return false;
     }
-    return rc;
+
+    req_length = ModbusTCP_CreateWriteMultipleMsg(me, (uint8_t)unitId,
+        FC_READ_WRITE_MULTIPLE_REGISTERS, readAddr, readCount,
+        writeAddr, values, writeCount, req);
+
+    return ModbusTCP_Transact(me, req, req_length, dst);
 }
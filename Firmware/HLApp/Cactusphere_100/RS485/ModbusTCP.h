@@ -27,16 +27,52 @@
 
 #include <stdbool.h>
 
+#include <applibs/eventloop.h>
+
+// maximum requests pipelined on a connection
+#define MODBUS_TCP_MAX_IN_FLIGHT 16
+
+// deadline of connecting to the server [msec]
+#define MODBUS_TCP_DEFAULT_CONNECT_TIMEOUT_MS   3000
+#define MODBUS_TCP_MIN_CONNECT_TIMEOUT_MS       100
+#define MODBUS_TCP_MAX_CONNECT_TIMEOUT_MS       30000
+
 typedef struct ModbusTcpCtx ModbusTcpCtx;
 
+// completion callback of the asynchronous request
+//   result is false if failed, timed out or exception response
+typedef void (*ModbusTCP_Callback)(void* arg, bool result);
+
 // Initialization and cleanup
 extern ModbusTcpCtx* ModbusTCP_Initialize(const char* ip, int port);
 extern void ModbusTCP_Destroy(ModbusTcpCtx* me);
 
+// Process the connections on the event loop
+//   (until registered, every request completes before it returns)
+extern bool ModbusTCP_RegisterEventLoop(EventLoop* eventLoop);
+extern void ModbusTCP_UnregisterEventLoop(void);
+
+// Requests pipelined on the connection (1 - MODBUS_TCP_MAX_IN_FLIGHT, default 1)
+//   the responses are matched to the requests by the transaction ID
+extern void ModbusTCP_SetMaxInFlight(ModbusTcpCtx* me, int maxInFlight);
+
+// Deadline of connecting to the server (default MODBUS_TCP_DEFAULT_CONNECT_TIMEOUT_MS)
+extern void ModbusTCP_SetConnectTimeout(ModbusTcpCtx* me, int timeoutMs);
+
+// Process the requests of all the connections until they complete
+extern void ModbusTCP_WaitIdle(void);
+
 // Connect
+//   keeps the connection (with TCP keepalive) until it is broken or
+//   disconnected, reconnects with exponential backoff after a failure
 extern bool ModbusTCP_Connect(ModbusTcpCtx* me);
 
-// Disvonnect
+// Start connecting without blocking (false if failed or backing off)
+//   requests submitted while connecting are sent after connected,
+//   or fail if the connect fails or exceeds the deadline
+extern bool ModbusTCP_ConnectAsync(ModbusTcpCtx* me);
+
+// Disvonnect (the requests in progress fail)
 extern void ModbusTCP_Disconnect(ModbusTcpCtx* me);
 
 // Read 1byte holding register
@@ -45,6 +81,25 @@ extern bool ModbusTCP_ReadSingleRegister(ModbusTcpCtx* me, int unitId, int regAd
 // Read 1byte input register 
 extern bool ModbusTCP_ReadSingleInputRegister(ModbusTcpCtx* me, int unitId, int regAddr, unsigned short* dst);
 
+// Read coils/discrete inputs (FC01/FC02) or registers (FC03/FC04)
+//   bits are packed into dst LSB first, bit i is (dst[i >> 4] >> (i & 15)) & 1
+extern bool ModbusTCP_ReadRegisters(ModbusTcpCtx* me, int unitId, int regAddr, int function,
+    unsigned short* dst, int count);
+
+// Read asynchronously, the callback is called on the response (or timeout)
+//   dst must be valid until then, returns false (without callback) if failed to send
+extern bool ModbusTCP_ReadRegistersAsync(ModbusTcpCtx* me, int unitId, int regAddr, int function,
+    unsigned short* dst, int count, ModbusTCP_Callback callback, void* arg);
+
 // Write 1byte
 extern bool ModbusTCP_WriteSingleRegister(ModbusTcpCtx* me, int unitId, int regAddr, unsigned short value);
+
+// Write multiple coils (FC15, values are packed bits) or registers (FC16)
+extern bool ModbusTCP_WriteMultiple(ModbusTcpCtx* me, int unitId, int regAddr, int function,
+    const unsigned short* values, int count);
+
+// Write registers then read registers in one transaction (FC23)
+extern bool ModbusTCP_WriteAndReadRegisters(ModbusTcpCtx* me, int unitId, int writeAddr,
+    const unsigned short* values, int writeCount,
+    int readAddr, unsigned short* dst, int readCount);
 #endif  // _MODBUS_TCP_H_
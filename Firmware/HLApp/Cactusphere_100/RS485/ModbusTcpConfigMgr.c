@@ -33,6 +33,7 @@
 
 #include "json.h"
 #include "LibModbusTcp.h"
+#include "ModbusRegImage.h"
 #include "ModbusTcpFetchConfig.h"
 
 typedef struct ModbusTcpConfigMgr {
@@ -54,6 +55,7 @@ ModbusTcpConfigMgr_Cleanup(void)
 {
     ModbusTcpFetchConfig_Destroy(sModbusTcpConfigMgr.fetchConfig);
     LibmodbusTcp_ModbusDevDestroy();
+    ModbusRegImage_Cleanup();
 }
 
 // Apply new configuration
@@ -77,6 +79,13 @@ ModbusTcpConfigMgr_LoadAndApplyIfChanged(const unsigned char* payload,
         telemetryConfObj = json_GetKeyJson("ModbusTcpTelemetryConfig", desiredObj);
     }
 
+    // the data acquisition in progress refers the devices and fetch items,
+    // the registers of the old configuration are no longer acquired
+    if (modbusConfObj != NULL || telemetryConfObj != NULL) {
+        LibmodbusTcp_WaitIdle();
+        ModbusRegImage_Clear();
+    }
+
     if (modbusConfObj != NULL) {
         modbusConfObj = json_GetKeyJson("value", modbusConfObj);
         modbusConfObj = json_parse(modbusConfObj->u.string.ptr, modbusConfObj->u.string.length);
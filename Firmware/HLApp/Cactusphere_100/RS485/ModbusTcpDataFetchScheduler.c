@@ -24,21 +24,45 @@
 
 #include "ModbusTcpDataFetchScheduler.h"
 
+#include <stdlib.h>
 #include <string.h>
 
 #include "LibModbusTcp.h"
+#include "ModbusDevConfig.h"
+#include "ModbusRegImage.h"
 #include "ModbusTcpDev.h"
 #include "ModbusTcpFetchItem.h"
 #include "ModbusTcpFetchTargets.h"
+#include "ModbusTcpReadBlock.h"
 #include "StringBuf.h"
 #include "TelemetryItems.h"
 
-typedef struct ModbusTcpDataFetchScheduler {
+#define MODBUS_TCP_ID_SIZE 21
+#define MODBUS_TCP_READ_GAP 0   // merge only adjacent registers
+
+typedef struct ModbusTcpDataFetchScheduler	ModbusTcpDataFetchScheduler;
+
+// Read request of a block in acquisition
+typedef struct ModbusTcpReadRequest {
+    ModbusTcpDataFetchScheduler*	self;
+    const char*	id;                 // server ("ipAddr:port")
+    vector	fetchItems;             // vector of ModbusTcpFetchItem* of the server
+    ModbusReadBlock	block;
+    unsigned short	values[MODBUS_MAX_READ_REGISTERS];
+    bool	result;
+} ModbusTcpReadRequest;
+
+struct ModbusTcpDataFetchScheduler {
     DataFetchSchedulerBase	Super;
 
     // data member
     ModbusTcpFetchTargets*	mFetchTargets;  // acquisition targets of Modbus TCP
-} ModbusTcpDataFetchScheduler;
+    vector	mReadBlocks;                // vector of ModbusReadBlock (work area)
+    vector	mReadRequests;              // vector of ModbusTcpReadRequest (work area)
+    int	mPending;                       // requests not completed yet
+    bool	mBusy;                      // acquisition in progress
+    bool	mInDoSchedule;              // in DoSchedule (telemetry is sent by caller)
+};
 
 //
 // DataTcpDataFetchScheduler's private procedure/method
@@ -53,6 +77,101 @@ ModbusTcpFetchTimerCallback(void* arg, const FetchItemBase* fetchTarget)
         scheduler->mFetchTargets, (const ModbusTcpFetchItem*)fetchTarget);
 }
 
+// Add an acquired value as telemetry
+static void
+ModbusTcpDataFetchScheduler_AddTelemetry(DataFetchSchedulerBase* me,
+    const ModbusTcpFetchItem* item, const unsigned short* readVal)
+{
+    unsigned long value;
+
+    if (item->regCount == 2) {
+        value = ((unsigned long)readVal[0] << 16) + readVal[1];
+    } else {
+        value = readVal[0];
+    }
+
+    if (item->asFloat)
+    {
+        double fVal = value;
+
+        fVal += item->offset;
+        if (item->multiplier != 0) {
+            fVal *= item->multiplier;
+        }
+        if (item->devider != 0) {
+            fVal /= item->devider;
+        }
+
+        StringBuf_AppendByPrintf(me->mStringBuf, "%f", fVal);
+    }
+    else
+    {
+        unsigned long ulVal = value;
+
+        ulVal += item->offset;
+        if (item->multiplier != 0) {
+            ulVal *= item->multiplier;
+        }
+        if (item->devider != 0) {
+            ulVal /= item->devider;
+        }
+
+        StringBuf_AppendByPrintf(me->mStringBuf, "%ld", ulVal);
+    }
+
+    TelemetryItems_Add(me->mTelemetryItems,
+        item->telemetryName, StringBuf_GetStr(me->mStringBuf));
+    StringBuf_Clear(me->mStringBuf);
+}
+
+// Completion of the requests of all the servers
+static void
+ModbusTcpDataFetchScheduler_OnDone(ModbusTcpDataFetchScheduler* self)
+{
+    const ModbusTcpReadRequest*	reqCurs =
+        (const ModbusTcpReadRequest*)vector_get_data(self->mReadRequests);
+
+    // one snapshot in the order of the blocks regardless of the order of responses
+    for (int j = 0, n = vector_size(self->mReadRequests); j < n; ++j, ++reqCurs) {
+        const ModbusTcpFetchItem** fiTop =
+            (const ModbusTcpFetchItem**)vector_get_data(reqCurs->fetchItems);
+
+        if (! reqCurs->result) {
+            // error!
+            continue;
+        }
+        ModbusRegImage_Update(reqCurs->id, fiTop[reqCurs->block.firstItem]->unitID,
+            reqCurs->block.funcCode, reqCurs->block.regAddr, reqCurs->block.regCount,
+            reqCurs->values);
+
+        // slice the block into telemetry items
+        for (int k = 0; k < reqCurs->block.itemCount; ++k) {
+            const ModbusTcpFetchItem* item = fiTop[reqCurs->block.firstItem + k];
+
+            ModbusTcpDataFetchScheduler_AddTelemetry(&self->Super, item,
+                &reqCurs->values[item->regAddr - reqCurs->block.regAddr]);
+        }
+    }
+
+    self->mBusy = false;
+    if (! self->mInDoSchedule) {
+        DataFetchScheduler_SendTelemetry(&self->Super);
+    }
+}
+
+// Completion of a read request
+static void
+ModbusTcpDataFetchScheduler_OnRead(void* arg, bool result)
+{
+    ModbusTcpReadRequest*	req = (ModbusTcpReadRequest*)arg;
+    ModbusTcpDataFetchScheduler*	self = req->self;
+
+    req->result = result;
+    if (--self->mPending == 0) {
+        ModbusTcpDataFetchScheduler_OnDone(self);
+    }
+}
+
 // Virtual method
 static void
 ModbusTcpDataFetchScheduler_DoDestroy(DataFetchSchedulerBase* me)
@@ -60,6 +179,8 @@ ModbusTcpDataFetchScheduler_DoDestroy(DataFetchSchedulerBase* me)
     ModbusTcpDataFetchScheduler*	self = (ModbusTcpDataFetchScheduler*)me;
 
     ModbusTcpFetchTargets_Destroy(self->mFetchTargets);
+    vector_destroy(self->mReadBlocks);
+    vector_destroy(self->mReadRequests);
 }
 
 static void
@@ -75,71 +196,89 @@ ModbusTcpDataFetchScheduler_DoSchedule(DataFetchSchedulerBase* me)
 {
     ModbusTcpDataFetchScheduler* self = (ModbusTcpDataFetchScheduler*)me;
     vector	IDs;
+    char*	IDCurs;
+    ModbusTcpReadRequest*	reqCurs;
+    const char*	curID = NULL;
+    ModbusTcpDev*	modbusdev = NULL;
 
     IDs = ModbusTcpFetchTargets_GetDevIDs(self->mFetchTargets);
-    if (!vector_is_empty(IDs)) {
-        char* IDCurs = (char*)vector_get_data(IDs);
-
-        for (int i = 0, n = vector_size(IDs); i < n; i++) {
-
-            vector	fetchItems = ModbusTcpFetchTargets_GetFetchItems(
-                self->mFetchTargets, IDCurs);
-            const ModbusTcpFetchItem** fiCurs =
-                (const ModbusTcpFetchItem**)vector_get_data(fetchItems);
-
-            ModbusTcpDev* modbusdev = LibmodbusTcp_GetAndConnectLib(IDCurs);
-
-            IDCurs += 21; // MODBUS_TCP_ID_SIZE
-
-            if (modbusdev == NULL) {
-                continue;
-            }
-
-            for (int j = 0, m = vector_size(fetchItems); j < m; ++j) {
-                const ModbusTcpFetchItem* item = *fiCurs++;
-                unsigned short value;
-
-                if (!LibmodbusTcp_ReadRegister(modbusdev, (int)item->unitID, (int)item->regAddr, &value)) {
-                    // error!
-                    continue;
-                }
-
-                if (item->asFloat)
-                {
-                    double fVal = value;
-
-                    fVal += item->offset;
-                    if (item->multiplier != 0) {
-                        fVal *= item->multiplier;
-                    }
-                    if (item->devider != 0) {
-                        fVal /= item->devider;
-                    }
-
-                    StringBuf_AppendByPrintf(me->mStringBuf, "%f", fVal);
-                }
-                else
-                {
-                    unsigned long ulVal = value;
-
-                    ulVal += item->offset;
-                    if (item->multiplier != 0) {
-                        ulVal *= item->multiplier;
-                    }
-                    if (item->devider != 0) {
-                        ulVal /= item->devider;
-                    }
-
-                    StringBuf_AppendByPrintf(me->mStringBuf, "%ld", ulVal);
-                }
-
-                TelemetryItems_Add(me->mTelemetryItems,
-                    item->telemetryName, StringBuf_GetStr(me->mStringBuf));
-                StringBuf_Clear(me->mStringBuf);
-            }
-            LibmodbusTcp_Disconnect(modbusdev);
+    if (vector_is_empty(IDs)) {
+        return;
+    }
+
+    // merge the items of each server and unit into contiguous register ranges
+    // and acquire each range by one request
+    vector_clear(self->mReadRequests);
+    IDCurs = (char*)vector_get_data(IDs);
+    for (int i = 0, n = vector_size(IDs); i < n; i++, IDCurs += MODBUS_TCP_ID_SIZE) {
+        vector	fetchItems = ModbusTcpFetchTargets_GetFetchItems(
+            self->mFetchTargets, IDCurs);
+        const ModbusReadBlock*	blockCurs;
+
+        vector_clear(self->mReadBlocks);
+        ModbusTcpReadBlock_Build(fetchItems, MODBUS_TCP_READ_GAP, self->mReadBlocks);
+        blockCurs = (const ModbusReadBlock*)vector_get_data(self->mReadBlocks);
+        for (int j = 0, m = vector_size(self->mReadBlocks); j < m; ++j) {
+            ModbusTcpReadRequest	req = {
+                .self       = self,
+                .id         = IDCurs,
+                .fetchItems = fetchItems,
+                .block      = blockCurs[j],
+                .result     = false,
+            };
+
+            vector_add_last(self->mReadRequests, &req);
         }
     }
+
+    // acquire all the servers concurrently without blocking the event loop,
+    // an unreachable server only fails by its own connect deadline.
+    // The extra count keeps the acquisition until all the requests are submitted,
+    // telemetry is sent on completion.
+    self->mPending = 1;
+    self->mBusy = true;
+    self->mInDoSchedule = true;
+    reqCurs = (ModbusTcpReadRequest*)vector_get_data(self->mReadRequests);
+    for (int j = 0, m = vector_size(self->mReadRequests); j < m; ++j, ++reqCurs) {
+        const ModbusTcpFetchItem**	fiTop =
+            (const ModbusTcpFetchItem**)vector_get_data(reqCurs->fetchItems);
+        const ModbusTcpFetchItem*	first = fiTop[reqCurs->block.firstItem];
+
+        if (reqCurs->id != curID) {
+            curID = reqCurs->id;
+            modbusdev = LibmodbusTcp_GetAndConnectLibAsync((char*)curID);
+        }
+        if (modbusdev == NULL) {
+            continue;
+        }
+        // pipelined by the connection up to its maxInFlight
+        self->mPending++;
+        if (! LibmodbusTcp_ReadRegistersAsync(modbusdev, (int)first->unitID,
+                (int)reqCurs->block.regAddr, (int)reqCurs->block.funcCode,
+                reqCurs->values, (int)reqCurs->block.regCount,
+                ModbusTcpDataFetchScheduler_OnRead, reqCurs)) {
+            self->mPending--;  // error!
+        }
+    }
+    if (--self->mPending == 0) {
+        // all the requests completed (or failed) already
+        ModbusTcpDataFetchScheduler_OnDone(self);
+    }
+    self->mInDoSchedule = false;
+}
+
+static bool
+ModbusTcpDataFetchScheduler_IsBusy(DataFetchSchedulerBase* me)
+{
+    ModbusTcpDataFetchScheduler* self = (ModbusTcpDataFetchScheduler*)me;
+
+    return self->mBusy;
+}
+
+static void
+ModbusTcpDataFetchScheduler_WaitIdle(DataFetchSchedulerBase* me)
+{
+    LibmodbusTcp_WaitIdle();
 }
 
 DataFetchScheduler*
@@ -159,14 +298,31 @@ ModbusTcpDataFetchScheduler_New(void)
         if (NULL == newObj->mFetchTargets) {
             goto err_delete_super;
         }
+        newObj->mReadBlocks = vector_init(sizeof(ModbusReadBlock));
+        if (NULL == newObj->mReadBlocks) {
+            goto err_delete_targets;
+        }
+        newObj->mReadRequests = vector_init(sizeof(ModbusTcpReadRequest));
+        if (NULL == newObj->mReadRequests) {
+            goto err_delete_blocks;
+        }
+        newObj->mPending = 0;
+        newObj->mBusy = false;
+        newObj->mInDoSchedule = false;
     }
 
     super->DoDestroy = ModbusTcpDataFetchScheduler_DoDestroy;
 //	super->DoInit    = ModbusTcpDataFetchScheduler_DoInit;  // don't override
     super->ClearFetchTargets = ModbusTcpDataFetchScheduler_ClearFetchTargets;
     super->DoSchedule        = ModbusTcpDataFetchScheduler_DoSchedule;
+    super->IsBusy            = ModbusTcpDataFetchScheduler_IsBusy;
+    super->WaitIdle          = ModbusTcpDataFetchScheduler_WaitIdle;
 
     return super;
+err_delete_blocks:
+    vector_destroy(newObj->mReadBlocks);
+err_delete_targets:
+    ModbusTcpFetchTargets_Destroy(newObj->mFetchTargets);
 err_delete_super:
     DataFetchScheduler_Destroy(super);
 err:
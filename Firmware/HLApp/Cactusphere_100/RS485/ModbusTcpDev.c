@@ -49,10 +49,10 @@ ModbusTcpDev_Initialize() {
 
 void
 ModbusTcpDev_Destroy(vector modbusDevVec) {
+    // close the connections, the elements are owned by the vector
     ModbusTcpDev* modbusDev = vector_get_data(modbusDevVec);
     for (int i = 0, n = vector_size(modbusDevVec); i < n; ++i) {
         ModbusTCP_Destroy(modbusDev->ctx);
-        free(modbusDev);
         modbusDev++;
     }
 }
@@ -83,12 +83,29 @@ ModbusTcpDev_GetModbusDev(const char* id, vector modbusDevVec) {
     return NULL;
 }
 
+// Requests pipelined on the connection
+void
+ModbusTcpDev_SetMaxInFlight(ModbusTcpDev* me, int maxInFlight) {
+    ModbusTCP_SetMaxInFlight(me->ctx, maxInFlight);
+}
+
+// Deadline of connecting to the server
+void
+ModbusTcpDev_SetConnectTimeout(ModbusTcpDev* me, int timeoutMs) {
+    ModbusTCP_SetConnectTimeout(me->ctx, timeoutMs);
+}
+
 // Connect
 bool 
 ModbusTcpDev_Connect(ModbusTcpDev* me) {
     return ModbusTCP_Connect(me->ctx);
 }
 
+bool
+ModbusTcpDev_ConnectAsync(ModbusTcpDev* me) {
+    return ModbusTCP_ConnectAsync(me->ctx);
+}
+
 // Disconnect
 void 
 ModbusTcpDev_Disconnect(ModbusTcpDev* me) {
@@ -106,8 +123,38 @@ ModbusTcpDev_ReadSingleInputRegister(ModbusTcpDev* me, int unitId, int regAddr,
     return ModbusTCP_ReadSingleInputRegister(me->ctx, unitId, regAddr, dst);
 }
 
+// Read coils/discrete inputs or registers
+bool
+ModbusTcpDev_ReadRegisters(ModbusTcpDev* me, int unitId, int regAddr, int funcCode,
+    unsigned short* dst, int count) {
+    return ModbusTCP_ReadRegisters(me->ctx, unitId, regAddr, funcCode, dst, count);
+}
+
+bool
+ModbusTcpDev_ReadRegistersAsync(ModbusTcpDev* me, int unitId, int regAddr, int funcCode,
+    unsigned short* dst, int count, ModbusTCP_Callback callback, void* arg) {
+    return ModbusTCP_ReadRegistersAsync(me->ctx, unitId, regAddr, funcCode, dst, count,
+        callback, arg);
+}
+
 // Write single register
 bool
 ModbusTcpDev_WriteSingleRegister(ModbusTcpDev* me, int unitId, int regAddr, uint16_t value) {
     return ModbusTCP_WriteSingleRegister(me->ctx, unitId, regAddr, value);
 }
+
+// Write multiple coils (FC15) or registers (FC16)
+bool
+ModbusTcpDev_WriteMultiple(ModbusTcpDev* me, int unitId, int regAddr, int funcCode,
+    const unsigned short* values, int count) {
+    return ModbusTCP_WriteMultiple(me->ctx, unitId, regAddr, funcCode, values, count);
+}
+
+// Write registers then read registers in one transaction (FC23)
+bool
+ModbusTcpDev_WriteAndReadRegisters(ModbusTcpDev* me, int unitId, int writeAddr,
+    const unsigned short* values, int writeCount,
+    int readAddr, unsigned short* dst, int readCount) {
+    return ModbusTCP_WriteAndReadRegisters(me->ctx, unitId, writeAddr, values, writeCount,
+        readAddr, dst, readCount);
+}
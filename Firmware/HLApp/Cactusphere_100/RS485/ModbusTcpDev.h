@@ -28,6 +28,7 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include "vector.h"
+#include "ModbusTCP.h"
 
 typedef struct ModbusTcpDev ModbusTcpDev;
 
@@ -41,8 +42,15 @@ extern ModbusTcpDev* ModbusTcpDev_NewModbusTCP(char* ip, int port);
 // Get ModbusDev*
 extern ModbusTcpDev* ModbusTcpDev_GetModbusDev(const char* id, vector modbusTcpDevVec);
 
-// Connect
+// Requests pipelined on the connection
+extern void ModbusTcpDev_SetMaxInFlight(ModbusTcpDev* me, int maxInFlight);
+
+// Deadline of connecting to the server
+extern void ModbusTcpDev_SetConnectTimeout(ModbusTcpDev* me, int timeoutMs);
+
+// Connect (reuses the connection kept open)
 extern bool ModbusTcpDev_Connect(ModbusTcpDev* me);
+extern bool ModbusTcpDev_ConnectAsync(ModbusTcpDev* me);
 
 // Disconnect
 extern void ModbusTcpDev_Disconnect(ModbusTcpDev* me);
@@ -53,6 +61,21 @@ extern bool ModbusTcpDev_ReadSingleRegister(ModbusTcpDev* me, int unitId, int re
 // Read 1byte input register
 extern bool ModbusTcpDev_ReadSingleInputRegister(ModbusTcpDev* me, int unitId, int regAddr, unsigned short* dst);
 
+// Read coils/discrete inputs (bits are packed LSB first) or registers
+extern bool ModbusTcpDev_ReadRegisters(ModbusTcpDev* me, int unitId, int regAddr, int funcCode,
+    unsigned short* dst, int count);
+extern bool ModbusTcpDev_ReadRegistersAsync(ModbusTcpDev* me, int unitId, int regAddr, int funcCode,
+    unsigned short* dst, int count, ModbusTCP_Callback callback, void* arg);
+
 // Write 1byte
 extern bool ModbusTcpDev_WriteSingleRegister(ModbusTcpDev* me, int unitId, int regAddr, uint16_t value);
+
+// Write multiple coils (FC15) or registers (FC16)
+extern bool ModbusTcpDev_WriteMultiple(ModbusTcpDev* me, int unitId, int regAddr, int funcCode,
+    const unsigned short* values, int count);
+
+// Write registers then read registers in one transaction (FC23)
+extern bool ModbusTcpDev_WriteAndReadRegisters(ModbusTcpDev* me, int unitId, int writeAddr,
+    const unsigned short* values, int writeCount,
+    int readAddr, unsigned short* dst, int readCount);
 #endif  // _MODBUS_TCP_DEV_H_
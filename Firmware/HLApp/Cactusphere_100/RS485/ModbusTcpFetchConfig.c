@@ -28,6 +28,7 @@
 #include <stdlib.h>
 
 #include "json.h"
+#include "ModbusDevConfig.h"
 #include "ModbusTcpFetchItem.h"
 #include "TelemetryItems.h"
 
@@ -43,8 +44,14 @@ const char IpAddrKey[]                      = "ipAddr";
 const char PortKey[]                        = "port";		
 const char UnitIdKey[]                      = "unitId";	
 extern const char RegisterAddrKey[];		
+extern const char RegisterCountKey[];
+extern const char FuncCodeKey[];
 extern const char OffsetKey[];				
-extern const char IntervalKey[];			
+extern const char IntervalKey[];
+extern const char IntervalMsKey[];
+extern const char AlignToClockKey[];
+extern const char OverrunPolicyKey[];
+extern const char OverrunCatchUpValue[];			
 extern const char MultiplylKey[];		
 extern const char DeviderKey[];			
 extern const char AsFloatKey[];		 
@@ -108,6 +115,7 @@ ModbusTcpFetchConfig_LoadFromJSON(ModbusTcpFetchConfig* me,
 
     for (unsigned int i = 0, n = configJson->u.object.length; i < n; ++i) {
         ModbusTcpFetchItem pseudo;
+        bool hasIntervalMs = false;
         json_value* configItem = configJson->u.object.values[i].value;
         size_t	strLen = strlen(configJson->u.object.values[i].name);
 
@@ -121,8 +129,12 @@ ModbusTcpFetchConfig_LoadFromJSON(ModbusTcpFetchConfig* me,
         pseudo.port = 0;
         pseudo.unitID = 0;
         pseudo.regAddr = 0;
+        pseudo.regCount = 1;
+        pseudo.funcCode = FC_READ_HOLDING_REGISTER;
         pseudo.offset = 0;
-        pseudo.intervalSec = 1;
+        pseudo.intervalMs = 1000;
+        pseudo.alignToClock = false;
+        pseudo.overrunPolicy = FETCH_OVERRUN_SKIP;
         pseudo.multiplier = 0;
         pseudo.devider = 0;
         pseudo.asFloat = false;
@@ -161,12 +173,39 @@ ModbusTcpFetchConfig_LoadFromJSON(ModbusTcpFetchConfig* me,
 
                 pseudo.regAddr = (unsigned long)strtol(item->u.string.ptr, &e, 16);
             }
+            else if (0 == strcmp(configItem->u.object.values[p].name, RegisterCountKey)) {
+                json_value* item = configItem->u.object.values[p].value;
+
+                if (! json_GetNumericValue(item, &pseudo.regCount, 16)) {
+                    pseudo.regCount = 0;  // invalid
+                }
+            }
+            else if (0 == strcmp(configItem->u.object.values[p].name, FuncCodeKey)) {
+                json_value* item = configItem->u.object.values[p].value;
+
+                if (! json_GetNumericValue(item, &pseudo.funcCode, 16)) {
+                    pseudo.funcCode = 0;  // invalid
+                }
+            }
             else if (0 == strcmp(configItem->u.object.values[p].name, IntervalKey)) { 
                 json_value* item = configItem->u.object.values[p].value;
 
-                pseudo.intervalSec = (unsigned long)item->u.integer;
-                if (pseudo.intervalSec <= 0) {
-                    pseudo.intervalSec = 1;
+                if (! hasIntervalMs) {
+                    pseudo.intervalMs = (item->u.integer > 0)
+                        ? (unsigned long)item->u.integer * 1000 : 1000;
+                }
+            }
+            else if (0 == strcmp(configItem->u.object.values[p].name, IntervalMsKey)) {
+                // sub-second acquisition, takes precedence over "interval"
+                json_value* item = configItem->u.object.values[p].value;
+
+                if (json_GetNumericValue(item, &pseudo.intervalMs, 10)) {
+                    if (pseudo.intervalMs < FETCH_ITEM_MIN_INTERVAL_MS) {
+                        pseudo.intervalMs = FETCH_ITEM_MIN_INTERVAL_MS;
+                    } else if (pseudo.intervalMs > FETCH_ITEM_MAX_INTERVAL_MS) {
+                        pseudo.intervalMs = FETCH_ITEM_MAX_INTERVAL_MS;
+                    }
+                    hasIntervalMs = true;
                 }
             }
             else if (0 == strcmp(configItem->u.object.values[p].name, OffsetKey)) { 
@@ -189,7 +228,27 @@ ModbusTcpFetchConfig_LoadFromJSON(ModbusTcpFetchConfig* me,
 
                 pseudo.asFloat = item->u.boolean;
             }
+            else if (0 == strcmp(configItem->u.object.values[p].name, AlignToClockKey)) {
+                json_value* item = configItem->u.object.values[p].value;
+
+                pseudo.alignToClock = item->u.boolean;
+            }
+            else if (0 == strcmp(configItem->u.object.values[p].name, OverrunPolicyKey)) {
+                json_value* item = configItem->u.object.values[p].value;
+
+                if (item->type == json_string
+                    && 0 == strcmp(item->u.string.ptr, OverrunCatchUpValue)) {
+                    pseudo.overrunPolicy = FETCH_OVERRUN_CATCH_UP;
+                }
+            }
+
+        }
 
+        // a value is one register or two registers (32bit, high word first)
+        if (pseudo.regCount < 1 || pseudo.regCount > 2
+            || (pseudo.funcCode != FC_READ_HOLDING_REGISTER
+                && pseudo.funcCode != FC_READ_INPUT_REGISTERS)) {
+            continue;  // ignore invalid item
         }
         vector_add_last(me->mFetchItems, &pseudo);
     }
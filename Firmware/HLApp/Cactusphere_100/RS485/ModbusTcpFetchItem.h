@@ -31,11 +31,15 @@
 
 typedef struct ModbusTcpFetchItem {
     char	    telemetryName[TELEMETRY_NAME_MAX_LEN + 1];  // telemetry name
-    uint32_t	intervalSec;    // periodic acquisition interval (in seconds)
+    uint32_t	intervalMs;    // periodic acquisition interval (in milliseconds)
+    bool	    alignToClock;  // expire at the multiples of interval in wall-clock time
+    uint8_t	    overrunPolicy; // FetchOverrunPolicy
     char		ipAddr[16];	    // ip address
     uint32_t	port;			// port num
     uint32_t	unitID;         // unit id
     uint32_t	regAddr;        // register address
+    uint32_t	regCount;       // read register count
+    uint32_t	funcCode;       // function code (FC03 or FC04)
     uint16_t	offset;         // sum value
     uint32_t	multiplier;     // multiply value
     uint32_t	devider;        // divide value
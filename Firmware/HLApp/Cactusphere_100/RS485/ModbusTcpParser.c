@@ -0,0 +1,118 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Atmark Techno, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "ModbusTcpParser.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define MBAP_PROTOCOL_ID_OFFSET	2
+#define MBAP_LENGTH_OFFSET	4   // length field counts the bytes after it
+#define MBAP_LENGTH_END	6
+#define MIN_FRAME_LENGTH	(MODBUS_TCP_MBAP_HEADER_LENGTH + 1)  // function code at least
+
+struct ModbusTcpParser {
+    uint8_t	mBuf[MODBUS_TCP_MAX_ADU_LENGTH * 2];    // received bytes
+    int	mHead;      // start of the bytes not taken out yet
+    int	mTail;      // end of the received bytes
+};
+
+// Initialization and cleanup
+ModbusTcpParser*
+ModbusTcpParser_New(void)
+{
+    ModbusTcpParser*	newObj = (ModbusTcpParser*)malloc(sizeof(ModbusTcpParser));
+
+    if (NULL != newObj) {
+        ModbusTcpParser_Reset(newObj);
+    }
+
+    return newObj;
+}
+
+void
+ModbusTcpParser_Destroy(ModbusTcpParser* me)
+{
+    free(me);
+}
+
+void
+ModbusTcpParser_Reset(ModbusTcpParser* me)
+{
+    me->mHead = 0;
+    me->mTail = 0;
+}
+
+// Buffer to receive the following bytes
+uint8_t*
+ModbusTcpParser_GetWriteBuf(ModbusTcpParser* me, int* space)
+{
+    // the bytes of the frames already taken out are reused,
+    // a partial frame is at most MODBUS_TCP_MAX_ADU_LENGTH - 1 bytes
+    if (me->mHead == me->mTail) {
+        me->mHead = me->mTail = 0;
+    } else if (me->mHead > 0 && me->mTail > MODBUS_TCP_MAX_ADU_LENGTH) {
+        memmove(me->mBuf, me->mBuf + me->mHead, (size_t)(me->mTail - me->mHead));
+        me->mTail -= me->mHead;
+        me->mHead = 0;
+    }
+    *space = (int)sizeof(me->mBuf) - me->mTail;
+
+    return me->mBuf + me->mTail;
+}
+
+void
+ModbusTcpParser_Commit(ModbusTcpParser* me, int length)
+{
+    me->mTail += length;
+}
+
+// Take out the next complete frame
+int
+ModbusTcpParser_Next(ModbusTcpParser* me, const uint8_t** frame)
+{
+    const uint8_t*	top = me->mBuf + me->mHead;
+    int	available = me->mTail - me->mHead;
+    int	frameLength;
+
+    if (available < MBAP_LENGTH_END) {
+        return 0;
+    }
+    if (top[MBAP_PROTOCOL_ID_OFFSET] != 0 || top[MBAP_PROTOCOL_ID_OFFSET + 1] != 0) {
+        return -1;  // not Modbus
+    }
+    frameLength = MBAP_LENGTH_END
+        + ((top[MBAP_LENGTH_OFFSET] << 8) | top[MBAP_LENGTH_OFFSET + 1]);
+    if (frameLength < MIN_FRAME_LENGTH || frameLength > MODBUS_TCP_MAX_ADU_LENGTH) {
+        return -1;
+    }
+    if (available < frameLength) {
+        return 0;
+    }
+
+    *frame = top;
+    me->mHead += frameLength;
+
+    return frameLength;
+}
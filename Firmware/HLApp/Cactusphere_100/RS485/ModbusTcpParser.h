@@ -0,0 +1,59 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Atmark Techno, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef _MODBUS_TCP_PARSER_H_
+#define _MODBUS_TCP_PARSER_H_
+
+#ifndef _STDINT_H
+#include <stdint.h>
+#endif
+
+#define MODBUS_TCP_MBAP_HEADER_LENGTH	7   // transaction ID, protocol ID, length, unit ID
+#define MODBUS_TCP_MAX_ADU_LENGTH	260     // MBAP header + PDU (253 bytes)
+
+typedef struct ModbusTcpParser	ModbusTcpParser;
+
+// Incremental parser of the byte stream of Modbus TCP
+//   received bytes are written to the buffer of the parser, then complete
+//   frames are taken out of it by the length field of MBAP header.
+//   A segment may have a part of a frame or several frames.
+
+// Initialization and cleanup
+extern ModbusTcpParser*	ModbusTcpParser_New(void);
+extern void	ModbusTcpParser_Destroy(ModbusTcpParser* me);
+extern void	ModbusTcpParser_Reset(ModbusTcpParser* me);
+
+// Buffer to receive the following bytes (space is the writable size)
+//   space is at least MODBUS_TCP_MAX_ADU_LENGTH if all the complete frames
+//   are taken out before
+extern uint8_t*	ModbusTcpParser_GetWriteBuf(ModbusTcpParser* me, int* space);
+extern void	ModbusTcpParser_Commit(ModbusTcpParser* me, int length);
+
+// Take out the next complete frame
+//   returns the length of the frame (valid until the next call),
+//   0 if not received entirely, or -1 if the stream is out of sync
+//   (wrong protocol ID or length), then the connection must be reset
+extern int	ModbusTcpParser_Next(ModbusTcpParser* me, const uint8_t** frame);
+
+#endif  // _MODBUS_TCP_PARSER_H_
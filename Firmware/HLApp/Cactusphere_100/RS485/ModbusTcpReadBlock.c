@@ -0,0 +1,96 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Atmark Techno, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "ModbusTcpReadBlock.h"
+
+#include <stdlib.h>
+
+#include "ModbusDevConfig.h"
+#include "ModbusTcpFetchItem.h"
+
+static int
+FetchItem_Comparator(const void* one, const void* two)
+{
+    const ModbusTcpFetchItem*	item1 = *(const ModbusTcpFetchItem**)one;
+    const ModbusTcpFetchItem*	item2 = *(const ModbusTcpFetchItem**)two;
+
+    if (item1->unitID != item2->unitID) {
+        return (item1->unitID < item2->unitID) ? -1 : 1;
+    }
+    if (item1->funcCode != item2->funcCode) {
+        return (item1->funcCode < item2->funcCode) ? -1 : 1;
+    }
+    if (item1->regAddr != item2->regAddr) {
+        return (item1->regAddr < item2->regAddr) ? -1 : 1;
+    }
+    return 0;
+}
+
+// Merge fetch items of a server into read blocks
+void
+ModbusTcpReadBlock_Build(vector fetchItems, uint32_t maxGap, vector outBlocks)
+{
+    const ModbusTcpFetchItem**	fiCurs;
+    ModbusReadBlock	block;
+    uint32_t	blockUnitID = 0;
+    uint32_t	blockEnd = 0;
+    int	n = vector_size(fetchItems);
+
+    if (0 == n) {
+        return;
+    }
+    fiCurs = (const ModbusTcpFetchItem**)vector_get_data(fetchItems);
+    qsort(fiCurs, (size_t)n, sizeof(ModbusTcpFetchItem*), FetchItem_Comparator);
+
+    block.itemCount = 0;
+    for (int i = 0; i < n; ++i) {
+        const ModbusTcpFetchItem*	item = fiCurs[i];
+        uint32_t	itemEnd = item->regAddr + item->regCount;
+        uint32_t	newEnd  = (itemEnd > blockEnd) ? itemEnd : blockEnd;
+
+        if (0 < block.itemCount
+            && item->unitID == blockUnitID
+            && item->funcCode == block.funcCode
+            && item->regAddr <= blockEnd + maxGap
+            && newEnd - block.regAddr <= MODBUS_MAX_READ_REGISTERS) {
+            // extend current block
+            blockEnd = newEnd;
+            block.regCount = blockEnd - block.regAddr;
+            ++block.itemCount;
+            continue;
+        }
+
+        if (0 < block.itemCount) {
+            vector_add_last(outBlocks, &block);
+        }
+        blockUnitID     = item->unitID;
+        block.funcCode  = item->funcCode;
+        block.regAddr   = item->regAddr;
+        block.regCount  = item->regCount;
+        block.firstItem = i;
+        block.itemCount = 1;
+        blockEnd = itemEnd;
+    }
+    vector_add_last(outBlocks, &block);
+}
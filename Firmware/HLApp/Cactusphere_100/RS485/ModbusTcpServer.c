@@ -0,0 +1,388 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Atmark Techno, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "ModbusTcpServer.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#include <applibs_versions.h>
+#include <applibs/log.h>
+
+#include "ModbusDevConfig.h"
+#include "ModbusTcpParser.h"
+
+#define MODBUS_TCP_SERVER_BACKLOG	2
+#define MODBUS_TCP_SERVER_TX_LENGTH	(MODBUS_TCP_MAX_ADU_LENGTH * 2)
+
+// exception codes
+#define MODBUS_EXCEPTION_ILLEGAL_FUNCTION	0x01
+#define MODBUS_EXCEPTION_ILLEGAL_DATA_ADDRESS	0x02
+#define MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE	0x03
+#define MODBUS_EXCEPTION_GATEWAY_PATH	0x0A
+#define MODBUS_EXCEPTION_GATEWAY_TARGET	0x0B
+
+// connection of a client
+typedef struct ModbusTcpServerClient {
+    int	fd;     // -1: not used
+    EventRegistration*	reg;
+    ModbusTcpParser*	parser;
+    uint8_t	txBuf[MODBUS_TCP_SERVER_TX_LENGTH];  // responses not sent yet
+    int	txLength;
+} ModbusTcpServerClient;
+
+static EventLoop*	sEventLoop = NULL;
+static int	sListenFd = -1;
+static EventRegistration*	sListenReg = NULL;
+static uint32_t	sMaxAgeSec = 0;
+static vector	sUnits = NULL;     // vector of ModbusTcpServerUnit, NULL: RTU by devID
+static ModbusTcpServerClient	sClients[MODBUS_TCP_SERVER_MAX_CLIENTS];
+
+static void
+ModbusTcpServer_Close(ModbusTcpServerClient* client)
+{
+    if (client->fd == -1) {
+        return;
+    }
+    if (client->reg != NULL) {
+        EventLoop_UnregisterIo(sEventLoop, client->reg);
+        client->reg = NULL;
+    }
+    close(client->fd);
+    client->fd = -1;
+    ModbusTcpParser_Destroy(client->parser);
+    client->parser = NULL;
+}
+
+// Send the responses queued (false if the connection is broken)
+static bool
+ModbusTcpServer_Flush(ModbusTcpServerClient* client)
+{
+    while (client->txLength > 0) {
+        int	sent = send(client->fd, client->txBuf, (size_t)client->txLength,
+            MSG_NOSIGNAL | MSG_DONTWAIT);
+
+        if (sent < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                return false;
+            }
+            break;
+        }
+        client->txLength -= sent;
+        memmove(client->txBuf, client->txBuf + sent, (size_t)client->txLength);
+    }
+    EventLoop_ModifyIoEvents(sEventLoop, client->reg,
+        EventLoop_Input | ((client->txLength > 0) ? EventLoop_Output : 0));
+
+    return true;
+}
+
+// Queue the response (false if the client doesn't receive)
+static bool
+ModbusTcpServer_Reply(ModbusTcpServerClient* client, const uint8_t* req,
+    const uint8_t* pdu, int pduLength)
+{
+    uint8_t*	rsp;
+    int	mbapLength = pduLength + 1;  // unit ID and PDU
+
+    if (client->txLength + MODBUS_TCP_MBAP_HEADER_LENGTH + pduLength
+            > MODBUS_TCP_SERVER_TX_LENGTH) {
+        // send the preceding responses to make room
+        if (! ModbusTcpServer_Flush(client)
+            || client->txLength + MODBUS_TCP_MBAP_HEADER_LENGTH + pduLength
+                > MODBUS_TCP_SERVER_TX_LENGTH) {
+            return false;
+        }
+    }
+    rsp = client->txBuf + client->txLength;
+    rsp[0] = req[0];  // transaction ID
+    rsp[1] = req[1];
+    rsp[2] = 0;  // protocol ID
+    rsp[3] = 0;
+    rsp[4] = (uint8_t)(mbapLength >> 8);
+    rsp[5] = (uint8_t)(mbapLength & 0x00ff);
+    rsp[6] = req[6];  // unit ID
+    memcpy(rsp + MODBUS_TCP_MBAP_HEADER_LENGTH, pdu, (size_t)pduLength);
+    client->txLength += MODBUS_TCP_MBAP_HEADER_LENGTH + pduLength;
+
+    return true;
+}
+
+// Find the unit in the register image exposed as the unit ID
+static bool
+ModbusTcpServer_FindUnit(uint32_t unitId, const char** source, uint32_t* sourceUnitId)
+{
+    const ModbusTcpServerUnit*	curs;
+
+    if (sUnits == NULL) {
+        *source = MODBUS_REG_IMAGE_SOURCE_RTU;
+        *sourceUnitId = unitId;
+        return true;
+    }
+    curs = (const ModbusTcpServerUnit*)vector_get_data(sUnits);
+    for (int i = 0, n = vector_size(sUnits); i < n; ++i, ++curs) {
+        if (curs->unitId == unitId) {
+            *source = curs->source;
+            *sourceUnitId = curs->sourceUnitId;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Answer the request from the register image
+static bool
+ModbusTcpServer_OnRequest(ModbusTcpServerClient* client, const uint8_t* req, int reqLength)
+{
+    const uint8_t*	pdu = req + MODBUS_TCP_MBAP_HEADER_LENGTH;
+    uint8_t	rsp[2 + MODBUS_MAX_READ_REGISTERS * 2];
+    unsigned short	values[MODBUS_MAX_READ_REGISTERS];
+    uint32_t	regAddr;
+    uint32_t	regCount;
+    uint32_t	ageSec;
+    const char*	source;
+    uint32_t	sourceUnitId;
+    uint8_t	exception = 0;
+
+    rsp[0] = pdu[0];
+    if (pdu[0] != FC_READ_HOLDING_REGISTER && pdu[0] != FC_READ_INPUT_REGISTERS) {
+        exception = MODBUS_EXCEPTION_ILLEGAL_FUNCTION;
+    } else if (reqLength != MODBUS_TCP_MBAP_HEADER_LENGTH + 5) {
+        exception = MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE;
+    } else {
+        regAddr  = (uint32_t)((pdu[1] << 8) | pdu[2]);
+        regCount = (uint32_t)((pdu[3] << 8) | pdu[4]);
+        if (regCount < 1 || regCount > MODBUS_MAX_READ_REGISTERS) {
+            exception = MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE;
+        } else if (! ModbusTcpServer_FindUnit(req[6], &source, &sourceUnitId)) {
+            exception = MODBUS_EXCEPTION_GATEWAY_PATH;
+        } else if (! ModbusRegImage_Read(source, sourceUnitId, pdu[0], regAddr, regCount,
+                values, &ageSec)) {
+            exception = MODBUS_EXCEPTION_ILLEGAL_DATA_ADDRESS;
+        } else if (sMaxAgeSec != 0 && ageSec > sMaxAgeSec) {
+            exception = MODBUS_EXCEPTION_GATEWAY_TARGET;  // stale
+        }
+    }
+
+    if (exception != 0) {
+        rsp[0] |= 0x80;
+        rsp[1] = exception;
+        return ModbusTcpServer_Reply(client, req, rsp, 2);
+    }
+
+    rsp[1] = (uint8_t)(regCount * 2);
+    for (uint32_t i = 0; i < regCount; ++i) {
+        rsp[2 + i * 2] = (uint8_t)(values[i] >> 8);
+        rsp[3 + i * 2] = (uint8_t)(values[i] & 0x00ff);
+    }
+    return ModbusTcpServer_Reply(client, req, rsp, 2 + (int)regCount * 2);
+}
+
+// Receive the requests of the client (false if the connection is broken)
+static bool
+ModbusTcpServer_Receive(ModbusTcpServerClient* client)
+{
+    for (;;) {
+        const uint8_t*	req;
+        int	space;
+        uint8_t*	buf = ModbusTcpParser_GetWriteBuf(client->parser, &space);
+        int	rc = recv(client->fd, buf, (size_t)space, MSG_DONTWAIT);
+
+        if (rc == 0) {
+            return false;  // closed by client
+        } else if (rc < 0) {
+            return (errno == EAGAIN || errno == EWOULDBLOCK);
+        }
+        ModbusTcpParser_Commit(client->parser, rc);
+
+        while (0 < (rc = ModbusTcpParser_Next(client->parser, &req))) {
+            if (! ModbusTcpServer_OnRequest(client, req, rc)) {
+                return false;  // the responses are not received
+            }
+        }
+        if (rc < 0) {
+            return false;  // out of sync
+        }
+    }
+}
+
+static void
+ModbusTcpServer_ClientEventHandler(EventLoop* el, int fd, EventLoop_IoEvents events,
+    void* context)
+{
+    ModbusTcpServerClient*	client = (ModbusTcpServerClient*)context;
+
+    if (! ModbusTcpServer_Receive(client) || ! ModbusTcpServer_Flush(client)) {
+        ModbusTcpServer_Close(client);
+    }
+}
+
+static void
+ModbusTcpServer_ListenEventHandler(EventLoop* el, int fd, EventLoop_IoEvents events,
+    void* context)
+{
+    ModbusTcpServerClient*	client = NULL;
+    int	option = 1;
+    int	newFd = accept(sListenFd, NULL, NULL);
+
+    if (newFd == -1) {
+        return;
+    }
+    for (int i = 0; i < MODBUS_TCP_SERVER_MAX_CLIENTS; ++i) {
+        if (sClients[i].fd == -1) {
+            client = &sClients[i];
+            break;
+        }
+    }
+    if (client == NULL) {
+        Log_Debug("WARNING: Modbus TCP server refused a client (too many clients).\n");
+        close(newFd);
+        return;
+    }
+
+    if (-1 == fcntl(newFd, F_SETFL, fcntl(newFd, F_GETFL) | O_NONBLOCK)
+        || -1 == setsockopt(newFd, IPPROTO_TCP, TCP_NODELAY,
+            (const void*)&option, sizeof(int))
+        || -1 == setsockopt(newFd, SOL_SOCKET, SO_KEEPALIVE,
+            (const void*)&option, sizeof(int))) {
+        close(newFd);
+        return;
+    }
+    client->parser = ModbusTcpParser_New();
+    if (client->parser == NULL) {
+        close(newFd);
+        return;
+    }
+    client->reg = EventLoop_RegisterIo(sEventLoop, newFd, EventLoop_Input,
+        ModbusTcpServer_ClientEventHandler, client);
+    if (client->reg == NULL) {
+        ModbusTcpParser_Destroy(client->parser);
+        client->parser = NULL;
+        close(newFd);
+        return;
+    }
+    client->fd = newFd;
+    client->txLength = 0;
+}
+
+// Serve on the event loop
+bool
+ModbusTcpServer_RegisterEventLoop(EventLoop* eventLoop)
+{
+    for (int i = 0; i < MODBUS_TCP_SERVER_MAX_CLIENTS; ++i) {
+        sClients[i].fd = -1;
+        sClients[i].reg = NULL;
+        sClients[i].parser = NULL;
+    }
+    sEventLoop = eventLoop;
+
+    return true;
+}
+
+void
+ModbusTcpServer_UnregisterEventLoop(void)
+{
+    ModbusTcpServer_Stop();
+    sEventLoop = NULL;
+}
+
+// Start (or restart) listening
+bool
+ModbusTcpServer_Start(int port, uint32_t maxAgeSec, vector units)
+{
+    struct sockaddr_in	addr;
+    int	option = 1;
+
+    if (sEventLoop == NULL) {
+        return false;
+    }
+    ModbusTcpServer_Stop();
+    sMaxAgeSec = maxAgeSec;
+    if (units != NULL) {
+        sUnits = vector_init(sizeof(ModbusTcpServerUnit));
+        if (sUnits == NULL || (! vector_is_empty(units)
+            && 0 != vector_add_last_multi(sUnits, vector_get_data(units), vector_size(units)))) {
+            ModbusTcpServer_Stop();
+            return false;
+        }
+    }
+
+    sListenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (sListenFd == -1) {
+        return false;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+
+    if (-1 == setsockopt(sListenFd, SOL_SOCKET, SO_REUSEADDR,
+            (const void*)&option, sizeof(int))
+        || -1 == bind(sListenFd, (struct sockaddr*)&addr, sizeof(addr))
+        || -1 == listen(sListenFd, MODBUS_TCP_SERVER_BACKLOG)) {
+        Log_Debug("ERROR: Modbus TCP server could not listen on port %d: %s (%d).\n",
+            port, strerror(errno), errno);
+        close(sListenFd);
+        sListenFd = -1;
+        return false;
+    }
+    sListenReg = EventLoop_RegisterIo(sEventLoop, sListenFd, EventLoop_Input,
+        ModbusTcpServer_ListenEventHandler, NULL);
+    if (sListenReg == NULL) {
+        close(sListenFd);
+        sListenFd = -1;
+        return false;
+    }
+
+    return true;
+}
+
+void
+ModbusTcpServer_Stop(void)
+{
+    if (sEventLoop == NULL) {
+        return;  // not started
+    }
+    for (int i = 0; i < MODBUS_TCP_SERVER_MAX_CLIENTS; ++i) {
+        ModbusTcpServer_Close(&sClients[i]);
+    }
+    if (sListenFd != -1) {
+        if (sListenReg != NULL) {
+            EventLoop_UnregisterIo(sEventLoop, sListenReg);
+            sListenReg = NULL;
+        }
+        close(sListenFd);
+        sListenFd = -1;
+    }
+    if (sUnits != NULL) {
+        sUnits = vector_destroy(sUnits);
+    }
+}
@@ -0,0 +1,71 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Atmark Techno, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef _MODBUS_TCP_SERVER_H_
+#define _MODBUS_TCP_SERVER_H_
+
+#ifndef _STDINT_H
+#include <stdint.h>
+#endif
+
+#include <stdbool.h>
+#include <applibs/eventloop.h>
+
+#include "ModbusRegImage.h"
+#include "vector.h"
+
+#define MODBUS_TCP_SERVER_DEFAULT_PORT	502     // must be in AllowedTcpServerPorts
+#define MODBUS_TCP_SERVER_MAX_CLIENTS	4
+
+// Modbus TCP server for the local SCADA/HMI
+//   answers FC03/FC04 reads from ModbusRegImage, so the local clients
+//   share the data acquisition of the cloud without bus traffic.
+//   The unit IDs requested by the clients are mapped to the units of the
+//   sources of ModbusRegImage explicitly, or to the RTU devices by devID
+//   as they are if not mapped.
+//   Exception responses:
+//     01: function other than FC03/FC04
+//     02: any of the registers has never been acquired
+//     03: register count is out of range
+//     0A: unit ID not mapped (gateway path unavailable)
+//     0B: the values are older than maxAgeSec (gateway target failed to respond)
+
+// unit exposed to the clients
+typedef struct ModbusTcpServerUnit {
+    uint32_t	unitId;         // unit ID requested by the clients
+    char	source[MODBUS_REG_IMAGE_SOURCE_SIZE];  // source in ModbusRegImage
+    uint32_t	sourceUnitId;   // unit ID in the source (devID or unitId)
+} ModbusTcpServerUnit;
+
+// Serve on the event loop
+extern bool	ModbusTcpServer_RegisterEventLoop(EventLoop* eventLoop);
+extern void	ModbusTcpServer_UnregisterEventLoop(void);
+
+// Start (or restart) listening, maxAgeSec is 0 if the age is not limited
+//   units is the vector of ModbusTcpServerUnit (copied),
+//   or NULL to expose the RTU devices by devID
+extern bool	ModbusTcpServer_Start(int port, uint32_t maxAgeSec, vector units);
+extern void	ModbusTcpServer_Stop(void);
+
+#endif  // _MODBUS_TCP_SERVER_H_
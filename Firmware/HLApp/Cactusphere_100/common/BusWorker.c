@@ -0,0 +1,124 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Atmark Techno, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "BusWorker.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+
+#include <applibs/log.h>
+
+// interval to check the stop request
+#define BUS_WORKER_POLL_TIMEOUT_MS	100
+
+static EventLoop*	sEventLoop = NULL;
+static pthread_t	sThread;
+static pthread_mutex_t	sLock = PTHREAD_MUTEX_INITIALIZER;
+static atomic_bool	sStopRequested = false;
+
+static void*
+BusWorker_ThreadMain(void* arg)
+{
+    struct pollfd	pollFd;
+
+    pollFd.fd      = EventLoop_GetWaitDescriptor(sEventLoop);
+    pollFd.events  = POLLIN;
+    pollFd.revents = 0;
+
+    while (! atomic_load(&sStopRequested)) {
+        // wait for the events without the lock, then dispatch all of them
+        int	ret = poll(&pollFd, 1, BUS_WORKER_POLL_TIMEOUT_MS);
+
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            Log_Debug("ERROR: bus I/O thread failed to wait: %s (%d).\n",
+                strerror(errno), errno);
+            break;
+        }
+        if (0 < ret) {
+            pthread_mutex_lock(&sLock);
+            if (EventLoop_Run(sEventLoop, 0, false) == EventLoop_Run_Failed
+                && errno != EINTR) {
+                Log_Debug("ERROR: bus I/O thread failed to dispatch: %s (%d).\n",
+                    strerror(errno), errno);
+            }
+            pthread_mutex_unlock(&sLock);
+        }
+    }
+
+    return NULL;
+}
+
+// Start and stop the thread dispatching the events of eventLoop
+bool
+BusWorker_Start(EventLoop* eventLoop)
+{
+    int	err;
+
+    if (NULL != sEventLoop) {
+        return true;  // already started
+    }
+
+    sEventLoop = eventLoop;
+    atomic_store(&sStopRequested, false);
+    err = pthread_create(&sThread, NULL, BusWorker_ThreadMain, NULL);
+    if (0 != err) {
+        Log_Debug("ERROR: could not start bus I/O thread: %s (%d).\n",
+            strerror(err), err);
+        sEventLoop = NULL;
+        return false;
+    }
+
+    return true;
+}
+
+void
+BusWorker_Stop(void)
+{
+    if (NULL == sEventLoop) {
+        return;
+    }
+
+    atomic_store(&sStopRequested, true);
+    pthread_join(sThread, NULL);
+    sEventLoop = NULL;
+}
+
+// Exclusive access to the devices and their configuration from other thread
+void
+BusWorker_Lock(void)
+{
+    pthread_mutex_lock(&sLock);
+}
+
+void
+BusWorker_Unlock(void)
+{
+    pthread_mutex_unlock(&sLock);
+}
@@ -0,0 +1,50 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Atmark Techno, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef _BUS_WORKER_H_
+#define _BUS_WORKER_H_
+
+#ifndef _STDBOOL_H
+#include <stdbool.h>
+#endif
+
+#include <applibs/eventloop.h>
+
+//
+// Thread dedicated to the I/O of the field bus (RS-485, Modbus TCP, DI).
+// It dispatches the events of its own event loop, which the data acquisition
+// (fetch timer, RTApp and Modbus TCP communication) is registered with,
+// so that the acquisition is not delayed by the cloud communication.
+//
+
+// Start and stop the thread dispatching the events of eventLoop
+extern bool	BusWorker_Start(EventLoop* eventLoop);
+extern void	BusWorker_Stop(void);
+
+// Exclusive access to the devices and their configuration from other thread
+// (the events are dispatched while holding the lock)
+extern void	BusWorker_Lock(void);
+extern void	BusWorker_Unlock(void);
+
+#endif  // _BUS_WORKER_H_
@@ -25,14 +25,29 @@
 #include "DataFetchScheduler.h"
 
 #include <string.h>
+#include <time.h>
+
+#include <applibs/log.h>
 
 #include "LibCloud.h"
+#include "SampleQueue.h"
+#include "SendRTApp.h"
 #include "StringBuf.h"
 #include "TelemetryItems.h"
 
 extern bool	IsAuthenticationDone(void);
 
-static DataFetchSchedulerBase*	sPrimaryScheduler = NULL;
+// interval to check the completion of the acquisition in progress
+#define DATA_FETCH_SCHEDULER_BUSY_RETRY_MS	20
+
+// number of the telemetry items passed to the main thread without draining,
+// enlarged to hold two snapshots of the largest configuration
+#define DATA_FETCH_SCHEDULER_QUEUE_SIZE	256
+
+// acquired data from the bus I/O thread to the main thread
+static SampleQueue*	sSampleQueue = NULL;
+static TelemetryItems*	sFlushItems = NULL;    // snapshot being flushed
+static uint32_t	sDropCount = 0;    // dropped records already reported
 
 // Default implementation of virtual method
 static void
@@ -60,27 +75,54 @@ DataFetchSchedulerBase_DoSchedule(DataFetchSchedulerBase* me)
     // do nothing
 }
 
+static bool
+DataFetchSchedulerBase_IsBusy(DataFetchSchedulerBase* me)
+{
+    return false;
+}
+
+static void
+DataFetchSchedulerBase_WaitIdle(DataFetchSchedulerBase* me)
+{
+    SendRTApp_WaitIdle();
+}
+
 // Initialization and cleanup
 void
 DataFetchScheduler_Init(DataFetchScheduler* me, vector fetchItemPtrs)
 {
+    // wait for the data acquisition in progress, it refers the old fetch items
+    if (me->IsBusy(me)) {
+        me->WaitIdle(me);
+    }
+
+    // A snapshot is passed to the main thread as a whole, so the queue must
+    // hold the snapshot of all the fetch items, and the next one while the
+    // main thread is sending it. The queue is enlarged here as the bus I/O
+    // thread is idle and locked out by the caller. (DI adds a few contact
+    // inputs to the fetch items, well within the default size.)
+    if (! SampleQueue_Reserve(sSampleQueue, 2 * (uint32_t)vector_size(fetchItemPtrs))) {
+        Log_Debug("ERROR: no room to pass %d telemetry items, their snapshots are dropped\n",
+            vector_size(fetchItemPtrs));
+    }
+
     // initialize the generalized/base class's member and  
     // do for specialized/derived class
     FetchTimers_Init(me->mFetchTimers, fetchItemPtrs);
+    me->mOverrunCount = 0;
     TelemetryItems_Clear(me->mTelemetryItems);
     StringBuf_Clear(me->mStringBuf);
 
     me->DoInit((DataFetchSchedulerBase*)me, fetchItemPtrs);
-
-    // set first instance as primary
-    if (NULL == sPrimaryScheduler) {
-        sPrimaryScheduler = me;
-    }
 }
 
 void
 DataFetchScheduler_Destroy(DataFetchScheduler* me)
 {
+    if (me->IsBusy(me)) {
+        me->WaitIdle(me);
+    }
+
     // cleanup member of specialized class and generalized class
     me->DoDestroy(me);
 
@@ -91,26 +133,106 @@ DataFetchScheduler_Destroy(DataFetchScheduler* me)
     free(me);
 }
 
-// Periodic operation (per 1[sec])
+// Periodic operation (at the deadline of the fetch timers)
 void
 DataFetchScheduler_Schedule(DataFetchScheduler* me)
 {
     // Do data acquisition by specialized class and send it as telemetry.
-    // If nettwork is down, store the acquired data to cache and send it after recovery. 
-    const char* telemtryStr;
+    // If the previous acquisition is still in progress, the expired timers
+    // are kept until it completes.
+    if (me->IsBusy(me)) {
+        return;
+    }
+    if (FetchTimers_GetNextDeadline(me->mFetchTimers) > FetchTimers_GetCurrentTime()) {
+        return;  // not yet expired
+    }
 
     me->ClearFetchTargets(me);
     TelemetryItems_Clear(me->mTelemetryItems);
     StringBuf_Clear(me->mStringBuf);
 
     FetchTimers_UpdateTimers(me->mFetchTimers);
+    if (me->mOverrunCount != FetchTimers_GetOverrunCount(me->mFetchTimers)) {
+        uint32_t	overrunCount = FetchTimers_GetOverrunCount(me->mFetchTimers);
+
+        Log_Debug("WARNING: data acquisition missed %u period(s), %u in total\n",
+            overrunCount - me->mOverrunCount, overrunCount);
+        me->mOverrunCount = overrunCount;
+    }
 
     me->DoSchedule(me);
 
-    telemtryStr = TelemetryItems_ToJson(me->mTelemetryItems);
+    // specialized class sends telemetry by itself when acquisition completed
+    if (! me->IsBusy(me)) {
+        DataFetchScheduler_SendTelemetry(me);
+    }
+}
+
+uint64_t
+DataFetchScheduler_GetNextDeadline(DataFetchScheduler* me)
+{
+    // retry shortly while the previous acquisition is in progress
+    if (me->IsBusy(me)) {
+        return FetchTimers_GetCurrentTime() + DATA_FETCH_SCHEDULER_BUSY_RETRY_MS;
+    }
+    return FetchTimers_GetNextDeadline(me->mFetchTimers);
+}
+
+uint32_t
+DataFetchScheduler_GetOverrunCount(DataFetchScheduler* me)
+{
+    return FetchTimers_GetOverrunCount(me->mFetchTimers);
+}
+
+// Send acquired data as telemetry
+void
+DataFetchScheduler_SendTelemetry(DataFetchScheduler* me)
+{
+    // Pass the acquired data to the main thread as a snapshot, it's sent or
+    // cached by DataFetchScheduler_FlushTelemetry. If the main thread is
+    // stalled too long, the snapshot is dropped as a whole.
+    int	itemCount = TelemetryItems_Count(me->mTelemetryItems);
+
+    if (0 == itemCount) {
+        return;
+    }
+    if (SampleQueue_CountFree(sSampleQueue) < (uint32_t)itemCount) {
+        SampleQueue_AddDropCount(sSampleQueue, (uint32_t)itemCount);
+    } else {
+        struct timespec	sampledAt;
+        uint32_t	recordCount = 0;
+
+        clock_gettime(CLOCK_REALTIME, &sampledAt);
+
+        for (int i = 0; i < itemCount; i++) {
+            SampleRecord*	record = SampleQueue_GetFreeAt(sSampleQueue, recordCount);
+
+            if (TelemetryItems_ConvToSampleRecordAt(me->mTelemetryItems, i, record)) {
+                record->sampledAt = sampledAt;
+                record->isLast    = false;
+                recordCount++;
+            }
+        }
+        if (0 < recordCount) {
+            SampleQueue_GetFreeAt(sSampleQueue, recordCount - 1)->isLast = true;
+            SampleQueue_Publish(sSampleQueue, recordCount);
+        }
+    }
+    TelemetryItems_Clear(me->mTelemetryItems);
+}
+
+static void
+DataFetchScheduler_SendSnapshot(
+    TelemetryItems* items, const struct timespec* sampledAt, bool isFirst)
+{
+    // If nettwork is down, store the acquired data to cache and send it after recovery. 
+    const char* telemtryStr;
+
+    telemtryStr = TelemetryItems_ToJson(items);
     if (0 != strcmp(telemtryStr, "{}")) {
         bool	isNetworkAlive = IoT_CentralLib_CheckConnection();
-        uint32_t	timeStamp = IoT_CentralLib_GetTmeStamp();
+        uint32_t	timeStamp = IoT_CentralLib_GetTmeStampOf(sampledAt->tv_sec);
+        uint32_t	msec = (uint32_t)(sampledAt->tv_nsec / 1000000);
 
         if (! IsAuthenticationDone()) {
             isNetworkAlive = false;
@@ -118,7 +240,7 @@ DataFetchScheduler_Schedule(DataFetchScheduler* me)
 
         if (isNetworkAlive) {
             if (IoT_CentralLib_HasCachedTelemetryItems()) {  // send cached data first
-                if (me == sPrimaryScheduler
+                if (isFirst
                 && !IoT_CentralLib_ResendCachedTelemetryItems()) {
                     // !!error
                 }
@@ -127,7 +249,7 @@ DataFetchScheduler_Schedule(DataFetchScheduler* me)
                 }
             }
 
-            if (! IoT_CentralLib_SendTelemetry(telemtryStr, &timeStamp)) {
+            if (! IoT_CentralLib_SendTelemetryAt(telemtryStr, timeStamp, msec)) {
                 isNetworkAlive = IoT_CentralLib_CheckConnection();
                 if (isNetworkAlive) {
                     // !!error
@@ -137,13 +259,46 @@ DataFetchScheduler_Schedule(DataFetchScheduler* me)
 
         if (! isNetworkAlive) {
 do_cache:
-            if (! IoT_CentralLib_EnqueueTelemtryItemsToCache(me->mTelemetryItems,
-                    timeStamp)) {
+            if (! IoT_CentralLib_EnqueueTelemtryItemsToCache(items,
+                    timeStamp, msec)) {
                 // failed to caching; Error!
             }
         }
-        TelemetryItems_Clear(me->mTelemetryItems);
     }
+    TelemetryItems_Clear(items);
+}
+
+void
+DataFetchScheduler_FlushTelemetry(void)
+{
+    // Send the snapshots passed from the bus I/O thread in order.
+    // The cached data is resent (a part of it at most) once per call.
+    uint32_t	availCount;
+    uint32_t	dropCount;
+    bool	isFirst = true;
+
+    if (NULL == sSampleQueue) {
+        return;
+    }
+
+    dropCount = SampleQueue_GetDropCount(sSampleQueue);
+    if (sDropCount != dropCount) {
+        Log_Debug("WARNING: %u telemetry item(s) dropped, %u in total\n",
+            dropCount - sDropCount, dropCount);
+        sDropCount = dropCount;
+    }
+
+    availCount = SampleQueue_CountAvail(sSampleQueue);
+    for (uint32_t i = 0; i < availCount; i++) {
+        const SampleRecord*	record = SampleQueue_GetAvailAt(sSampleQueue, i);
+
+        TelemetryItems_AddFromSampleRecord(sFlushItems, record);
+        if (record->isLast) {
+            DataFetchScheduler_SendSnapshot(sFlushItems, &record->sampledAt, isFirst);
+            isFirst = false;
+        }
+    }
+    SampleQueue_Consume(sSampleQueue, availCount);
 }
 
 // For specialized class
@@ -164,12 +319,28 @@ DataFetchScheduler_InitOnNew(DataFetchSchedulerBase* me,
     if (NULL == me->mStringBuf) {
         goto err_delete_telemetryItems;
     }
+    if (NULL == sSampleQueue) {  // shared by all the instances
+        sSampleQueue = SampleQueue_New(DATA_FETCH_SCHEDULER_QUEUE_SIZE);
+        sFlushItems  = TelemetryItems_New();
+        if (NULL == sSampleQueue || NULL == sFlushItems) {
+            SampleQueue_Destroy(sSampleQueue);
+            TelemetryItems_Destroy(sFlushItems);
+            sSampleQueue = NULL;
+            sFlushItems  = NULL;
+            goto err_delete_stringBuf;
+        }
+    }
+    me->mOverrunCount     = 0;
     me->DoDestroy         = DataFetchSchedulerBase_DoDestroy;
     me->DoInit            = DataFetchSchedulerBase_DoInit;
     me->ClearFetchTargets = DataFetchSchedulerBase_ClearFetchTargets;
     me->DoSchedule        = DataFetchSchedulerBase_DoSchedule;
+    me->IsBusy            = DataFetchSchedulerBase_IsBusy;
+    me->WaitIdle          = DataFetchSchedulerBase_WaitIdle;
 
     return me;
+err_delete_stringBuf:
+    StringBuf_Destroy(me->mStringBuf);
 err_delete_telemetryItems:
     TelemetryItems_Destroy(me->mTelemetryItems);
 err_delete_fetchTimers:
@@ -25,6 +25,10 @@
 #ifndef _DATA_FETCH_SCHEDULER_H_
 #define _DATA_FETCH_SCHEDULER_H_
 
+#ifndef _STDBOOL_H
+#include <stdbool.h>
+#endif
+
 #ifndef CONTAINERS_VECTOR_H
 #include <vector.h>
 #endif
@@ -46,24 +50,45 @@ struct DataFetchSchedulerBase {
     void	(*DoInit)(DataFetchSchedulerBase* me, vector fetchItemPtrs);
     void	(*ClearFetchTargets)(DataFetchSchedulerBase* me);
     void	(*DoSchedule)(DataFetchSchedulerBase* me);
+    bool	(*IsBusy)(DataFetchSchedulerBase* me);  // data acquisition in progress
+    void	(*WaitIdle)(DataFetchSchedulerBase* me);  // complete the acquisition in progress
 
 // data member
     FetchTimers*    mFetchTimers;       // timers for data acquistion
     TelemetryItems* mTelemetryItems;    // vector of telemetry item
     StringBuf*      mStringBuf;         // for string processing
+    uint32_t        mOverrunCount;      // missed periods already reported
 };
 
 // alias type
 typedef DataFetchSchedulerBase	DataFetchScheduler;
 
 // Initialization and cleanup
+//   Init is called on the main thread while holding BusWorker_Lock()
 extern void	DataFetchScheduler_Init(
     DataFetchScheduler* me, vector fetchItemPtrs);
 extern void	DataFetchScheduler_Destroy(DataFetchScheduler* me);
 
-// Deriodic operation (per 1[sec])
+// Periodic operation (at the deadline of the fetch timers)
 extern void	DataFetchScheduler_Schedule(DataFetchScheduler* me);
 
+// Time to call DataFetchScheduler_Schedule next
+// (monotonic clock in milliseconds, UINT64_MAX if nothing to acquire)
+extern uint64_t	DataFetchScheduler_GetNextDeadline(DataFetchScheduler* me);
+
+// Number of the periods missed by late acquisition
+extern uint32_t	DataFetchScheduler_GetOverrunCount(DataFetchScheduler* me);
+
+// Send acquired data as telemetry
+// (for specialized class which completes data acquisition asynchronously)
+// The data is passed to the main thread as a snapshot and actually sent by
+// DataFetchScheduler_FlushTelemetry.
+extern void	DataFetchScheduler_SendTelemetry(DataFetchScheduler* me);
+
+// Send (or cache during network down) the snapshots acquired by all the
+// instances, called periodically on the main thread
+extern void	DataFetchScheduler_FlushTelemetry(void);
+
 // For specialized class
 extern DataFetchSchedulerBase*	DataFetchScheduler_InitOnNew(
     DataFetchSchedulerBase* me,
@@ -32,6 +32,7 @@
 #endif
 #if (APP_PRODUCT_ID == PRODUCT_ATMARK_TECHNO_RS485)
 #include "ModbusDataFetchScheduler.h"
+#include "ModbusFetchTimers.h"
 #define USE_MODBUS
 #endif
 
@@ -73,6 +74,10 @@ Factory_CreateFetchTimers(IO_Feature feature,
 #ifdef USE_MODBUS
     case MODBUS_RTU:
         newObj = FetchTimers_New(cbProc, cbArg);
+        if (NULL != newObj) {
+            newObj->EstimateCost  = ModbusFetchTimers_EstimateCost;
+            newObj->GetPhaseGroup = ModbusFetchTimers_GetPhaseGroup;
+        }
         break;
 #endif
 #ifdef USE_MODBUS_TCP
@@ -25,15 +25,31 @@
 #ifndef _FETCH_ITEM_BASE_H_
 #define _FETCH_ITEM_BASE_H_
 
+#ifndef _STDBOOL_H
+#include <stdbool.h>
+#endif
+
 #ifndef _STDINT_H
 #include <stdint.h>
 #endif
 
 #define TELEMETRY_NAME_MAX_LEN	32
 
+// range of the acquisition interval
+#define FETCH_ITEM_MIN_INTERVAL_MS	100
+#define FETCH_ITEM_MAX_INTERVAL_MS	(86400 * 1000)
+
+// handling of the periods missed by a late acquisition
+typedef enum FetchOverrunPolicy {
+    FETCH_OVERRUN_SKIP = 0,     // acquire once, the missed periods are dropped
+    FETCH_OVERRUN_CATCH_UP,     // acquire the missed periods one by one
+} FetchOverrunPolicy;
+
 typedef struct FetchItemBase {
     char        telemetryName[TELEMETRY_NAME_MAX_LEN + 1];  // telemetry name
-    uint32_t    intervalSec;    // periodic acquisition interval (in seconds)
+    uint32_t    intervalMs;    // periodic acquisition interval (in milliseconds)
+    bool        alignToClock;  // expire at the multiples of interval in wall-clock time
+    uint8_t     overrunPolicy; // FetchOverrunPolicy
 } FetchItemBase;
 
 #endif  // _FETCH_ITEM_BASE_H_
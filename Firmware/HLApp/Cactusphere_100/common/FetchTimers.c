@@ -24,12 +24,287 @@
 
 #include "FetchTimers.h"
 
+#include <stdbool.h>
+#include <time.h>
+
+// maximum ticks considered to balance the phases
+#define FETCH_TIMERS_MAX_HORIZON	3600
+
+// maximum missed periods of a timer kept to catch up
+#define FETCH_TIMERS_MAX_BACKLOG	16
+
+// items sharing a phase (work area of FetchTimers_AssignPhases)
+typedef struct FetchTimerSlot {
+    uint32_t	intervalMs;
+    uint32_t	group;
+    uint64_t	cost;       // sum of the item's cost
+    uint32_t	phase;      // first expiration tick - 1
+    int	index;              // creation order (for stable sort)
+} FetchTimerSlot;
+
+// Current time of the wall clock (in milliseconds)
+static uint64_t
+FetchTimers_GetWallClockTime(void)
+{
+    struct timespec	now;
+
+    clock_gettime(CLOCK_REALTIME, &now);
+    return (uint64_t)now.tv_sec * 1000 + (uint64_t)now.tv_nsec / 1000000;
+}
+
+// Move the deadline to the nearest multiple of interval in wall-clock time,
+// it follows the adjustment of the wall clock (e.g. by NTP) gradually
+static uint64_t
+FetchTimer_AlignToClock(uint64_t deadline, uint32_t interval, uint64_t now)
+{
+    uint64_t	wallNow = FetchTimers_GetWallClockTime();
+    uint32_t	rem = (uint32_t)((wallNow + (deadline - now)) % interval);
+
+    if (rem < interval / 2) {
+        deadline -= rem;
+    } else {
+        deadline += interval - rem;
+    }
+    if (deadline <= now) {
+        deadline += interval;
+    }
+    return deadline;
+}
+
 // Initialization
 static void
-FetchTimer_Init(FetchTimer* me, FetchItemBase* fi)
+FetchTimer_Init(FetchTimer* me, FetchItemBase* fi, uint64_t now, int index)
+{
+    me->fetchItem = fi;
+    me->deadline  = now + fi->intervalMs;
+    me->index     = index;
+    me->backlog   = 0;
+    if (fi->alignToClock && fi->intervalMs > 0) {
+        // first boundary after now
+        me->deadline = now + fi->intervalMs
+            - FetchTimers_GetWallClockTime() % fi->intervalMs;
+    }
+}
+
+// Set the next deadline after the expiration, the periods already
+// passed are counted as overrun and kept as backlog to catch up
+static void
+FetchTimer_SetNextDeadline(FetchTimer* me, FetchTimers* timers, uint64_t now)
+{
+    uint32_t	interval = me->fetchItem->intervalMs;
+    uint64_t	next;
+
+    if (interval == 0) {
+        me->deadline = UINT64_MAX;  // never expires again
+        return;
+    }
+    next = me->deadline + interval;
+    if (next <= now) {
+        uint64_t	missed = (now - next) / interval + 1;
+
+        next += missed * interval;  // keep the phase
+        timers->mOverrunCount += (uint32_t)missed;
+        if (me->fetchItem->overrunPolicy == FETCH_OVERRUN_CATCH_UP) {
+            uint32_t	room = FETCH_TIMERS_MAX_BACKLOG - me->backlog;
+            uint32_t	added = (missed < room) ? (uint32_t)missed : room;
+
+            me->backlog += added;
+            timers->mBacklog += added;
+        }
+    }
+    if (me->fetchItem->alignToClock) {
+        next = FetchTimer_AlignToClock(next, interval, now);
+    }
+    me->deadline = next;
+}
+
+// Comparator of the heap order, earlier deadline and then creation order
+static bool
+FetchTimer_IsBefore(const FetchTimer* lhs, const FetchTimer* rhs)
+{
+    if (lhs->deadline != rhs->deadline) {
+        return lhs->deadline < rhs->deadline;
+    }
+    return lhs->index < rhs->index;
+}
+
+// Move down the timer at the position to restore the heap order
+static void
+FetchTimers_SiftDown(FetchTimer* timers, int n, int pos)
 {
-    me->fetchItem   = fi;
-    me->downCounter = fi->intervalSec;
+    FetchTimer	target = timers[pos];
+
+    for (;;) {
+        int	child = pos * 2 + 1;
+
+        if (child >= n) {
+            break;
+        }
+        if (child + 1 < n && FetchTimer_IsBefore(&timers[child + 1], &timers[child])) {
+            child++;
+        }
+        if (! FetchTimer_IsBefore(&timers[child], &target)) {
+            break;
+        }
+        timers[pos] = timers[child];
+        pos = child;
+    }
+    timers[pos] = target;
+}
+
+// Greatest common divisor of the intervals
+static uint32_t
+FetchTimers_Gcd(uint32_t a, uint32_t b)
+{
+    while (b != 0) {
+        uint32_t	r = a % b;
+
+        a = b;
+        b = r;
+    }
+    return a;
+}
+
+// Comparator to place the slot of higher load (cost per second) first
+static int
+FetchTimerSlot_CompareLoad(const void* lhs, const void* rhs)
+{
+    const FetchTimerSlot*	slot1 = (const FetchTimerSlot*)lhs;
+    const FetchTimerSlot*	slot2 = (const FetchTimerSlot*)rhs;
+    uint64_t	load1 = slot1->cost * slot2->intervalMs;
+    uint64_t	load2 = slot2->cost * slot1->intervalMs;
+
+    if (load1 != load2) {
+        return (load1 > load2) ? -1 : 1;
+    }
+    return slot1->index - slot2->index;
+}
+
+// Choose the phase which minimizes the peak (and then total) load of the ticks
+static uint32_t
+FetchTimers_ChoosePhase(const uint64_t* loads, uint32_t horizon, uint32_t interval)
+{
+    uint32_t	nPhases = (interval < horizon) ? interval : horizon;
+    uint32_t	bestPhase = 0;
+    uint64_t	bestPeak = UINT64_MAX;
+    uint64_t	bestSum  = UINT64_MAX;
+
+    for (uint32_t phase = 0; phase < nPhases; ++phase) {
+        uint64_t	peak = 0;
+        uint64_t	sum  = 0;
+
+        for (uint32_t tick = phase; tick < horizon; tick += interval) {
+            if (peak < loads[tick]) {
+                peak = loads[tick];
+            }
+            sum += loads[tick];
+        }
+        if (peak < bestPeak || (peak == bestPeak && sum < bestSum)) {
+            bestPeak  = peak;
+            bestSum   = sum;
+            bestPhase = phase;
+        }
+    }
+    return bestPhase;
+}
+
+// Spread the first expiration of the timers so that the expected bus
+// occupancy is balanced over the ticks, the period is kept as configured.
+// A tick is the greatest common divisor of the balanced intervals.
+static void
+FetchTimers_AssignPhases(FetchTimers* me, uint64_t now)
+{
+    FetchTimer*	timers = vector_get_data(me->mBody);
+    int	n = vector_size(me->mBody);
+    int	nSlots = 0;
+    uint32_t	tickMs = 0;
+    uint32_t	horizon = 0;
+    FetchTimerSlot*	slots;
+    int*	slotOfTimer;
+    uint64_t*	loads;
+
+    if (n == 0) {
+        return;
+    }
+    slots = (FetchTimerSlot*)malloc(sizeof(FetchTimerSlot) * n);
+    slotOfTimer = (int*)malloc(sizeof(int) * n);
+    if (NULL == slots || NULL == slotOfTimer) {
+        goto out;  // keep the phases unbalanced
+    }
+
+    // merge the items of the same group and interval into a slot
+    for (int i = 0; i < n; ++i) {
+        const FetchItemBase*	fetchItem = timers[i].fetchItem;
+        uint32_t	cost  = me->EstimateCost(me, fetchItem);
+        uint32_t	group = me->GetPhaseGroup(me, fetchItem);
+        int	s;
+
+        slotOfTimer[i] = -1;
+        if (cost == 0 || fetchItem->intervalMs == 0 || fetchItem->alignToClock) {
+            continue;
+        }
+        for (s = 0; s < nSlots; ++s) {
+            if (group != FETCH_TIMERS_NO_GROUP && slots[s].group == group
+                && slots[s].intervalMs == fetchItem->intervalMs) {
+                break;
+            }
+        }
+        if (s == nSlots) {
+            slots[s].intervalMs = fetchItem->intervalMs;
+            slots[s].group = group;
+            slots[s].cost  = 0;
+            slots[s].phase = 0;
+            slots[s].index = s;
+            nSlots++;
+        }
+        slots[s].cost += cost;
+        slotOfTimer[i] = slots[s].index;
+        tickMs = FetchTimers_Gcd(fetchItem->intervalMs, tickMs);
+    }
+    if (nSlots == 0) {
+        goto out;
+    }
+    for (int s = 0; s < nSlots; ++s) {
+        if (horizon < slots[s].intervalMs / tickMs) {
+            horizon = slots[s].intervalMs / tickMs;
+        }
+    }
+    if (horizon > FETCH_TIMERS_MAX_HORIZON) {
+        horizon = FETCH_TIMERS_MAX_HORIZON;
+    }
+    loads = (uint64_t*)calloc(horizon, sizeof(uint64_t));
+    if (NULL == loads) {
+        goto out;
+    }
+
+    // place the heavy slots first, then fill the gaps with the lighter ones
+    qsort(slots, (size_t)nSlots, sizeof(FetchTimerSlot), FetchTimerSlot_CompareLoad);
+    for (int s = 0; s < nSlots; ++s) {
+        uint32_t	interval = slots[s].intervalMs / tickMs;
+        uint32_t	phase = FetchTimers_ChoosePhase(loads, horizon, interval);
+
+        for (uint32_t tick = phase; tick < horizon; tick += interval) {
+            loads[tick] += slots[s].cost;
+        }
+        slots[s].phase = phase;
+    }
+    free(loads);
+
+    for (int i = 0; i < n; ++i) {
+        if (slotOfTimer[i] < 0) {
+            continue;
+        }
+        for (int s = 0; s < nSlots; ++s) {
+            if (slots[s].index == slotOfTimer[i]) {
+                timers[i].deadline = now + (uint64_t)(slots[s].phase + 1) * tickMs;
+                break;
+            }
+        }
+    }
+
+out:
+    free(slotOfTimer);
+    free(slots);
 }
 
 // Initialization and cleanup
@@ -47,7 +322,11 @@ FetchTimers_New(FetchTimerCallback cbProc, void* cbArg)
         }
         newObj->mCallbackProc = cbProc;
         newObj->mCbArg        = cbArg;
+        newObj->mBacklog      = 0;
+        newObj->mOverrunCount = 0;
         newObj->InitForTimer = FetchTimers_IntiForTimer;
+        newObj->EstimateCost = FetchTimers_EstimateCost;
+        newObj->GetPhaseGroup = FetchTimers_GetPhaseGroup;
     }
 
     return newObj;
@@ -59,16 +338,27 @@ FetchTimers_Init(FetchTimers* me, vector fetchItemPtrs)
     // initialize the generalized/base class's member and do 
     // specialized/derived class specific timer related initialization
     FetchItemBase**	fetchItemCurs = vector_get_data(fetchItemPtrs);
+    uint64_t	now = FetchTimers_GetCurrentTime();
+    int	n = vector_size(fetchItemPtrs);
 
     vector_clear(me->mBody);
-    for (int i = 0, n = vector_size(fetchItemPtrs); i < n; ++i) {
+    me->mBacklog      = 0;
+    me->mOverrunCount = 0;
+    for (int i = 0; i < n; ++i) {
         FetchItemBase*	fetchItem = *fetchItemCurs++;
         FetchTimer	pseudo;
 
-        FetchTimer_Init(&pseudo, fetchItem);
+        FetchTimer_Init(&pseudo, fetchItem, now, i);
         vector_add_last(me->mBody, &pseudo);
         me->InitForTimer(me, fetchItem);  // specialized class specific
     }
+    FetchTimers_AssignPhases(me, now);
+
+    // order by the first deadline
+    n = vector_size(me->mBody);
+    for (int i = n / 2 - 1; i >= 0; --i) {
+        FetchTimers_SiftDown(vector_get_data(me->mBody), n, i);
+    }
 }
 
 void
@@ -77,6 +367,19 @@ FetchTimers_IntiForTimer(FetchTimers* me, FetchItemBase* fetchItem)
     // do nothing
 }
 
+uint32_t
+FetchTimers_EstimateCost(FetchTimers* me, const FetchItemBase* fetchItem)
+{
+    // not balanced, expires after the full interval
+    return 0;
+}
+
+uint32_t
+FetchTimers_GetPhaseGroup(FetchTimers* me, const FetchItemBase* fetchItem)
+{
+    return FETCH_TIMERS_NO_GROUP;
+}
+
 void
 FetchTimers_Destroy(FetchTimers* me)
 {
@@ -84,18 +387,59 @@ FetchTimers_Destroy(FetchTimers* me)
     free(me);
 }
 
-// Updating timer counters for periodic expiration
+// Notify the expired timers and set their next deadline
 void
 FetchTimers_UpdateTimers(FetchTimers* me)
 {
-    // decrement the timer's down counter and fire when it reaches 0
-    FetchTimer*	timerCurs = vector_get_data(me->mBody);
+    // only the expired timers are visited, they are on top of the heap
+    FetchTimer*	timers = vector_get_data(me->mBody);
+    int	n = vector_size(me->mBody);
+    uint64_t	now = FetchTimers_GetCurrentTime();
 
-    for (int i = 0, n = vector_size(me->mBody); i < n; ++i) {
-        if (0 == --timerCurs->downCounter) {
-            me->mCallbackProc(me->mCbArg, timerCurs->fetchItem);
-            timerCurs->downCounter = timerCurs->fetchItem->intervalSec;  // reset
+    // catch up one missed period per call, unless it expires now
+    if (me->mBacklog > 0) {
+        for (int i = 0; i < n; ++i) {
+            if (timers[i].backlog > 0 && timers[i].deadline > now) {
+                me->mCallbackProc(me->mCbArg, timers[i].fetchItem);
+                timers[i].backlog--;
+                me->mBacklog--;
+            }
         }
-        ++timerCurs;
     }
+
+    while (n > 0 && timers[0].deadline <= now) {
+        me->mCallbackProc(me->mCbArg, timers[0].fetchItem);
+        FetchTimer_SetNextDeadline(&timers[0], me, now);
+        FetchTimers_SiftDown(timers, n, 0);
+    }
+}
+
+// Earliest deadline of the timers
+uint64_t
+FetchTimers_GetNextDeadline(FetchTimers* me)
+{
+    if (vector_is_empty(me->mBody)) {
+        return UINT64_MAX;
+    }
+    if (me->mBacklog > 0) {
+        return 0;  // missed periods to catch up
+    }
+    return ((FetchTimer*)vector_get_data(me->mBody))->deadline;
+}
+
+// Number of the periods missed since initialization
+uint32_t
+FetchTimers_GetOverrunCount(FetchTimers* me)
+{
+    return me->mOverrunCount;
+}
+
+// Current time of the monotonic clock
+uint64_t
+FetchTimers_GetCurrentTime(void)
+{
+    struct timespec	now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000 + (uint64_t)now.tv_nsec / 1000000;
 }
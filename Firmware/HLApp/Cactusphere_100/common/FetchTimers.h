@@ -36,9 +36,14 @@
 // timer for periodic data acquisition
 typedef struct FetchTimer {
     const FetchItemBase* fetchItem;  // telemetry data acquisition spec
-    uint32_t	downCounter;         // down counter for timer expiration
+    uint64_t	deadline;            // next expiration (monotonic clock, in milliseconds)
+    int	index;                       // creation order (for same deadline)
+    uint32_t	backlog;             // missed periods to be notified (catch-up)
 } FetchTimer;
 
+// phase group of the item which is balanced independently
+#define FETCH_TIMERS_NO_GROUP	UINT32_MAX
+
 // callback procedure for timer expiration notification
 typedef void (*FetchTimerCallback)(
     void* arg, const FetchItemBase* fetchTarget);
@@ -49,20 +54,37 @@ typedef struct FetchTimers	FetchTimers;
 struct FetchTimers {
 // virtual method
     void (*InitForTimer)(FetchTimers* me, FetchItemBase* fetchItem);
+    // expected bus occupancy of the item per expiration (0: not balanced)
+    uint32_t (*EstimateCost)(FetchTimers* me, const FetchItemBase* fetchItem);
+    // items of same group and same interval expire at the same time
+    uint32_t (*GetPhaseGroup)(FetchTimers* me, const FetchItemBase* fetchItem);
 
 // data member
-    vector	mBody;                      // vector of timer
+    vector	mBody;                      // binary min-heap of timer by deadline
     FetchTimerCallback	mCallbackProc;  // timer expiration notifier
     void* mCbArg;                       // callback argument
+    uint32_t	mBacklog;               // sum of the timer's backlog
+    uint32_t	mOverrunCount;          // periods missed by late expiration
 };
 
 // Initialization and cleanup
 extern FetchTimers*	FetchTimers_New(FetchTimerCallback cbProc, void* cbArg);
 extern void	FetchTimers_Init(FetchTimers* me, vector fetchItemPtrs);
 extern void	FetchTimers_IntiForTimer(FetchTimers* me, FetchItemBase* fetchItem);
+extern uint32_t	FetchTimers_EstimateCost(FetchTimers* me, const FetchItemBase* fetchItem);
+extern uint32_t	FetchTimers_GetPhaseGroup(FetchTimers* me, const FetchItemBase* fetchItem);
 extern void	FetchTimers_Destroy(FetchTimers* me);
 
-// Updating timer counters for periodic expiration
+// Notify the expired timers and set their next deadline
 extern void	FetchTimers_UpdateTimers(FetchTimers* me);
 
+// Earliest deadline of the timers (UINT64_MAX if no timer)
+extern uint64_t	FetchTimers_GetNextDeadline(FetchTimers* me);
+
+// Number of the periods missed since initialization
+extern uint32_t	FetchTimers_GetOverrunCount(FetchTimers* me);
+
+// Current time of the monotonic clock (in milliseconds)
+extern uint64_t	FetchTimers_GetCurrentTime(void);
+
 #endif  // _FETCH_TIMERS_H_
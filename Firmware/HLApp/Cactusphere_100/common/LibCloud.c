@@ -26,6 +26,7 @@
 
 #include <errno.h>
 #include <stdio.h>
+#include <string.h>
 #include <time.h>
 
 #include <applibs/log.h>
@@ -38,20 +39,25 @@
 #include <iothub.h>
 #include <azure_sphere_provisioning.h>
 
+#include "json.h"
 #include "vector.h"
 
+#include "TelemetryBatch.h"
 #include "TelemetryItemCache.h"
 #include "TelemetryItems.h"
 
 #define RESEND_MAX_NUM	10
 
 extern IOTHUB_DEVICE_CLIENT_LL_HANDLE Get_IOTHUB_DEVICE_CLIENT_LL_HANDLE(void); // main.c
+extern bool	IsAuthenticationDone(void);  // main.c
 
 static int  IoT_CentralLib_FindWaitingMsg(IOTHUB_MESSAGE_HANDLE msgHandle);
+static void IoT_CentralLib_CacheBatch(const char* jsonStr);
 
 typedef struct TelemetryMsgInfo {
     IOTHUB_MESSAGE_HANDLE   msgHandle;
     uint32_t    timeStamp;
+    uint32_t    msec;       // milliseconds of the timeStamp
 } TelemetryMsgInfo;
 
 static IOTHUB_DEVICE_CLIENT_LL_HANDLE sIothubClientHandle = NULL;
@@ -59,6 +65,10 @@ static TelemetryItemCache*	sTelemetryCache = NULL;
 static TelemetryItems*	sTelemetryItems = NULL;
 static vector   sWaitingMsgs = NULL;
 static time_t	sBaseTime;
+static TelemetryBatch*	sTelemetryBatch = NULL;  // snapshots to be uploaded
+static TelemetryBatch*	sResendBatch = NULL;     // snapshots resent from cache
+static uint32_t	sBatchMaxAgeSec = 0;    // 0: a message per snapshot
+static uint32_t	sBatchMaxSize = TELEMETRY_BATCH_DEFAULT_SIZE;
 
 /// <summary>
 ///     Callback confirming message delivered to IoT Hub.
@@ -78,9 +88,12 @@ SendMessageCallback(IOTHUB_CLIENT_CONFIRMATION_RESULT result, void *context)
                 (TelemetryMsgInfo*)vector_get_data(sWaitingMsgs) + theIndex;
             const char* jsonStr = IoTHubMessage_GetString(theMsg->msgHandle);
 
-            if (TelemetryItems_LoadFromJson(sTelemetryItems, jsonStr)) {
+            if ('[' == jsonStr[0]) {
+                IoT_CentralLib_CacheBatch(jsonStr);
+            } else if (TelemetryItems_LoadFromJson(sTelemetryItems, jsonStr)) {
                 (void)TelemetryItemCache_EnqueueItems(
-                    sTelemetryCache, sTelemetryItems, theMsg->timeStamp);
+                    sTelemetryCache, sTelemetryItems,
+                    theMsg->timeStamp, theMsg->msec);
             }
         }
         vector_remove_at(sWaitingMsgs, theIndex);
@@ -99,19 +112,55 @@ GetTimestamp(void)
 }
 
 static void
-MakeDateTimeStr(char* strBuf, size_t bufSize, uint32_t timeStamp)
+MakeDateTimeStr(char* strBuf, size_t bufSize, uint32_t timeStamp, uint32_t msec)
 {
     time_t	theTime = sBaseTime + (time_t)timeStamp;
     struct tm*	tmVal;
 
     tmVal = gmtime(&theTime);
     strftime(strBuf, bufSize, "%Y-%m-%dT%H:%M:%S", tmVal);
-    sprintf(strBuf + strlen(strBuf), ".%07ldZ", 0);
+    snprintf(strBuf + strlen(strBuf), bufSize - strlen(strBuf),
+        ".%03lu0000Z", (unsigned long)(msec % 1000));
 //
-// NOTE: Since the timestamp is a 32-bit integer, time values less than 
-//       seconds (timespec::tv_nsec) that can be obtained by timespec_get() 
-//       are ignored, and time values less than seconds are set to 0 
-//       in the character string returned as an output argument.
+// NOTE: The timestamp counts seconds in a 32-bit integer, so the time
+//       values less than seconds are passed as milliseconds separately.
+}
+
+static bool
+ParseDateTimeStr(const char* strBuf, uint32_t* outTimeStamp, uint32_t* outMsec)
+{
+    // reverse of MakeDateTimeStr()
+    struct tm	tmVal;
+    time_t	theTime;
+    const char* fracStr;
+    uint32_t	msec = 0;
+
+    memset(&tmVal, 0, sizeof(tmVal));
+    if (6 != sscanf(strBuf, "%d-%d-%dT%d:%d:%d", &tmVal.tm_year, &tmVal.tm_mon,
+            &tmVal.tm_mday, &tmVal.tm_hour, &tmVal.tm_min, &tmVal.tm_sec)) {
+        return false;
+    }
+    fracStr = strchr(strBuf, '.');
+    if (NULL != fracStr) {
+        // the first 3 digits of the fraction (the missing ones are 0)
+        ++fracStr;
+        for (int i = 0; i < 3; ++i) {
+            msec *= 10;
+            if ('0' <= *fracStr && *fracStr <= '9') {
+                msec += (uint32_t)(*fracStr++ - '0');
+            }
+        }
+    }
+    tmVal.tm_year -= 1900;
+    tmVal.tm_mon  -= 1;
+    theTime = timegm(&tmVal);
+    if (theTime < sBaseTime) {
+        return false;
+    }
+    *outTimeStamp = (uint32_t)(theTime - sBaseTime);
+    *outMsec = msec;
+
+    return true;
 }
 
 static int
@@ -130,7 +179,8 @@ IoT_CentralLib_FindWaitingMsg(IOTHUB_MESSAGE_HANDLE msgHandle)
 }
 
 static bool
-IoT_CentralLib_DoSendTelemetry(const char* jsonStr, uint32_t timeStamp)
+IoT_CentralLib_DoSendTelemetry(
+    const char* jsonStr, uint32_t timeStamp, uint32_t msec)
 {
     // send telemetry data message to IoT Central with timestamp property
     bool	isOK = true;
@@ -142,10 +192,11 @@ IoT_CentralLib_DoSendTelemetry(const char* jsonStr, uint32_t timeStamp)
         Log_Debug("WARNING: unable to create a new IoTHubMessage\n");
         return false;
     }
-    MakeDateTimeStr(strBuf, sizeof(strBuf), timeStamp);
+    MakeDateTimeStr(strBuf, sizeof(strBuf), timeStamp, msec);
     IoTHubMessage_SetProperty(messageHandle, "iothub-creation-time-utc", strBuf);
     msgInfo.msgHandle = messageHandle;
     msgInfo.timeStamp = timeStamp;
+    msgInfo.msec      = msec;
     vector_add_last(sWaitingMsgs, &msgInfo);
     if (IoTHubDeviceClient_LL_SendEventAsync(
             sIothubClientHandle, messageHandle, SendMessageCallback, messageHandle)
@@ -165,6 +216,89 @@ IoT_CentralLib_DoSendTelemetry(const char* jsonStr, uint32_t timeStamp)
     return isOK;
 }
 
+// Store the snapshots of the batch message to the cache to send them later
+static void
+IoT_CentralLib_CacheBatch(const char* jsonStr)
+{
+    // jsonStr may be owned by sTelemetryItems, so use another work area
+    json_value* jsonObj = json_parse(jsonStr, strlen(jsonStr));
+    TelemetryItems*	items = TelemetryItems_New();
+
+    if (NULL == jsonObj || NULL == items) {
+        goto end;
+    }
+    if (json_array == jsonObj->type) {
+        for (unsigned int i = 0; i < jsonObj->u.array.length; ++i) {
+            json_value* elem = jsonObj->u.array.values[i];
+            json_value* tsObj;
+            json_value* valuesObj;
+            uint32_t	timeStamp;
+            uint32_t	msec;
+
+            if (json_object != elem->type) {
+                continue;  // broken snapshot
+            }
+            tsObj = json_GetKeyJson((unsigned char*)"ts", elem);
+            valuesObj = json_GetKeyJson((unsigned char*)"values", elem);
+            if (NULL == tsObj || json_string != tsObj->type || NULL == valuesObj
+                || ! ParseDateTimeStr(tsObj->u.string.ptr, &timeStamp, &msec)
+                || ! TelemetryItems_LoadFromJsonValue(items, valuesObj)) {
+                continue;  // broken snapshot
+            }
+            (void)TelemetryItemCache_EnqueueItems(
+                sTelemetryCache, items, timeStamp, msec);
+        }
+    }
+
+end:
+    if (NULL != items) {
+        TelemetryItems_Destroy(items);
+    }
+    if (NULL != jsonObj) {
+        json_value_free(jsonObj);
+    }
+}
+
+// Send the batch as a message, the snapshots are cached if failed
+static bool
+IoT_CentralLib_SendBatch(TelemetryBatch* batch)
+{
+    bool	isOK = true;
+
+    if (0 < TelemetryBatch_Count(batch)) {
+        const char* jsonStr = TelemetryBatch_ToJson(batch);
+
+        isOK = IoT_CentralLib_DoSendTelemetry(jsonStr,
+            TelemetryBatch_GetFirstTimeStamp(batch), 0);
+        if (! isOK) {
+            IoT_CentralLib_CacheBatch(jsonStr);
+        }
+        TelemetryBatch_Clear(batch);
+    }
+
+    return isOK;
+}
+
+// Add the snapshot to the batch, send the batch first if it doesn't fit
+static bool
+IoT_CentralLib_AddToBatch(TelemetryBatch* batch,
+    const char* jsonStr, uint32_t timeStamp, uint32_t msec, bool* outSent)
+{
+    bool	isOK = true;
+    char	strBuf[64];
+
+    *outSent = false;
+    MakeDateTimeStr(strBuf, sizeof(strBuf), timeStamp, msec);
+    if (0 < TelemetryBatch_Count(batch)
+        && TelemetryBatch_GetLengthWith(batch, strBuf, jsonStr) > sBatchMaxSize) {
+        isOK = IoT_CentralLib_SendBatch(batch);
+        *outSent = true;
+    }
+    TelemetryBatch_Add(batch, strBuf, jsonStr, timeStamp);
+
+    return isOK;
+}
+
 // Initialization and cleanup
 bool
 IoT_CentralLib_Initialize(
@@ -189,6 +323,13 @@ IoT_CentralLib_Initialize(
             return false;
         }
     }
+    if (NULL == sTelemetryBatch) {
+        sTelemetryBatch = TelemetryBatch_New();
+        sResendBatch = TelemetryBatch_New();
+        if (NULL == sTelemetryBatch || NULL == sResendBatch) {
+            return false;
+        }
+    }
 
     if (NULL == sWaitingMsgs) {
         sWaitingMsgs = vector_init(sizeof(TelemetryMsgInfo));
@@ -228,17 +369,75 @@ IoT_CentralLib_Cleanup(void)
         TelemetryItems_Destroy(sTelemetryItems);
         sTelemetryItems = NULL;
     }
+    if (NULL != sTelemetryBatch) {
+        TelemetryBatch_Destroy(sTelemetryBatch);
+        sTelemetryBatch = NULL;
+    }
+    if (NULL != sResendBatch) {
+        TelemetryBatch_Destroy(sResendBatch);
+        sResendBatch = NULL;
+    }
 }
 
 // Send telemetry data
 bool
 IoT_CentralLib_SendTelemetry(const char* jsonStr, uint32_t* outTimestamp)
 {
-    uint32_t	timeStamp = GetTimestamp();
+    struct timespec	currTime;
+
+    clock_gettime(CLOCK_REALTIME, &currTime);
+    *outTimestamp = IoT_CentralLib_GetTmeStampOf(currTime.tv_sec);
+
+    return IoT_CentralLib_SendTelemetryAt(jsonStr, *outTimestamp,
+        (uint32_t)(currTime.tv_nsec / 1000000));
+}
+
+bool
+IoT_CentralLib_SendTelemetryAt(
+    const char* jsonStr, uint32_t timeStamp, uint32_t msec)
+{
+    bool	isSent;
+
+    if (0 == sBatchMaxAgeSec || NULL == sTelemetryBatch) {
+        return IoT_CentralLib_DoSendTelemetry(jsonStr, timeStamp, msec);
+    }
 
-    *outTimestamp = timeStamp;
+    // the snapshot is owned by the batch, it's cached if failed to send
+    (void)IoT_CentralLib_AddToBatch(
+        sTelemetryBatch, jsonStr, timeStamp, msec, &isSent);
+    IoT_CentralLib_FlushTelemetry(false);
 
-    return IoT_CentralLib_DoSendTelemetry(jsonStr, timeStamp);
+    return true;
+}
+
+// Upload policy of telemetry data
+void
+IoT_CentralLib_SetTelemetryBatch(uint32_t maxAgeSec, uint32_t maxSize)
+{
+    // the snapshots accumulated by the old policy are sent at once
+    IoT_CentralLib_FlushTelemetry(true);
+    sBatchMaxAgeSec = maxAgeSec;
+    sBatchMaxSize   = maxSize;
+}
+
+void
+IoT_CentralLib_FlushTelemetry(bool force)
+{
+    // send the batch if the oldest snapshot reaches the max age
+    if (NULL == sTelemetryBatch || 0 == TelemetryBatch_Count(sTelemetryBatch)) {
+        return;
+    }
+    if (! force
+        && GetTimestamp() - TelemetryBatch_GetFirstTimeStamp(sTelemetryBatch) < sBatchMaxAgeSec) {
+        return;
+    }
+
+    if (IoT_CentralLib_CheckConnection() && IsAuthenticationDone()) {
+        (void)IoT_CentralLib_SendBatch(sTelemetryBatch);
+    } else {
+        IoT_CentralLib_CacheBatch(TelemetryBatch_ToJson(sTelemetryBatch));
+        TelemetryBatch_Clear(sTelemetryBatch);
+    }
 }
 
 // Telemetry data caching during network down
@@ -254,10 +453,10 @@ IoT_CentralLib_CheckConnection(void)
 
 bool
 IoT_CentralLib_EnqueueTelemtryItemsToCache(
-    const TelemetryItems* telemetryItems, uint32_t timeStamp)
+    const TelemetryItems* telemetryItems, uint32_t timeStamp, uint32_t msec)
 {
     return TelemetryItemCache_EnqueueItems(sTelemetryCache,
-        telemetryItems, timeStamp);
+        telemetryItems, timeStamp, msec);
 }
 
 bool
@@ -274,14 +473,41 @@ IoT_CentralLib_ResendCachedTelemetryItems(void)
         return true;
     }
 
+    if (0 != sBatchMaxAgeSec && NULL != sResendBatch) {
+        // pack the cached data into the batch messages
+        int	sentNum = 0;
+
+        while (sentNum < RESEND_MAX_NUM
+            && ! TelemetryItemCache_IsEmpty(sTelemetryCache)) {
+            uint32_t	timeStamp;
+            uint32_t	msec;
+            bool	isSent;
+
+            (void)TelemetryItemCache_DequeueItemsTo(
+                sTelemetryCache, sTelemetryItems, &timeStamp, &msec);
+            if (! IoT_CentralLib_AddToBatch(sResendBatch,
+                    TelemetryItems_ToJson(sTelemetryItems),
+                    timeStamp, msec, &isSent)) {
+                TelemetryItems_Clear(sTelemetryItems);
+                return false;  // error
+            }
+            TelemetryItems_Clear(sTelemetryItems);
+            if (isSent) {
+                ++sentNum;
+            }
+        }
+        return IoT_CentralLib_SendBatch(sResendBatch);
+    }
+
     for (int i = 0; i < RESEND_MAX_NUM; ++i) {
         uint32_t	timeStamp;
+        uint32_t	msec;
         const char* jsonStr;
 
         (void)TelemetryItemCache_DequeueItemsTo(
-            sTelemetryCache, sTelemetryItems, &timeStamp);
+            sTelemetryCache, sTelemetryItems, &timeStamp, &msec);
         jsonStr = TelemetryItems_ToJson(sTelemetryItems);
-        if (! IoT_CentralLib_DoSendTelemetry(jsonStr, timeStamp)) {
+        if (! IoT_CentralLib_DoSendTelemetry(jsonStr, timeStamp, msec)) {
             return false;  // error
         }
         TelemetryItems_Clear(sTelemetryItems);
@@ -300,6 +526,15 @@ IoT_CentralLib_GetTmeStamp(void)
     return GetTimestamp();
 }
 
+uint32_t
+IoT_CentralLib_GetTmeStampOf(time_t theTime)
+{
+    if (theTime < sBaseTime) {
+        return 0;
+    }
+    return (uint32_t)(theTime - sBaseTime);
+}
+
 void IoT_CentralLib_SendProperty(const char* jsonStr)
 {
     Log_Debug("Sending IoT Hub Message: %s\n", jsonStr);
@@ -31,6 +31,9 @@
 #ifndef _STDINT_H
 #include <stdint.h>
 #endif
+#ifndef _TIME_H
+#include <time.h>
+#endif
 
 typedef struct TelemetryItems	TelemetryItems;
 
@@ -42,14 +45,25 @@ extern void IoT_CentralLib_Cleanup(void);
 // Send telemetry data
 extern bool	IoT_CentralLib_SendTelemetry(
     const char* jsonStr, uint32_t* outTimestamp);
+// (timeStamp is the one of IoT_CentralLib_GetTmeStamp[Of], and msec is
+//  the milliseconds of the acquisition time which the timeStamp lacks)
+extern bool	IoT_CentralLib_SendTelemetryAt(
+    const char* jsonStr, uint32_t timeStamp, uint32_t msec);
+
+// Upload policy of telemetry data; the snapshots are packed into a message
+// of maxSize bytes at most and sent within maxAgeSec (0: not packed)
+extern void	IoT_CentralLib_SetTelemetryBatch(uint32_t maxAgeSec, uint32_t maxSize);
+// Send the packed snapshots reaching the max age (or all if force)
+extern void	IoT_CentralLib_FlushTelemetry(bool force);
 
 // Telemetry data caching during network down
 extern bool	IoT_CentralLib_CheckConnection(void);
 extern bool	IoT_CentralLib_EnqueueTelemtryItemsToCache(
-    const TelemetryItems* telemetryItems, uint32_t timeStamp);
+    const TelemetryItems* telemetryItems, uint32_t timeStamp, uint32_t msec);
 extern bool	IoT_CentralLib_HasCachedTelemetryItems(void);
 extern bool	IoT_CentralLib_ResendCachedTelemetryItems(void);
 extern uint32_t	IoT_CentralLib_GetTmeStamp(void);
+extern uint32_t	IoT_CentralLib_GetTmeStampOf(time_t theTime);
 
 // Send property data
 extern void IoT_CentralLib_SendProperty(const char* jsonStr);
@@ -0,0 +1,176 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Atmark Techno, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "SampleQueue.h"
+
+#include <stdatomic.h>
+#include <stdlib.h>
+
+// SampleQueue class's data members
+struct SampleQueue {
+    SampleRecord*   mBody;  // ring buffer
+    uint32_t        mMask;  // capacity - 1
+    // free-running indices; mHead is written only by the producer and
+    // mTail only by the consumer
+    _Atomic uint32_t    mHead;
+    _Atomic uint32_t    mTail;
+    _Atomic uint32_t    mDropCount;
+};
+
+// Initialization and cleanup
+SampleQueue*
+SampleQueue_New(uint32_t capacity)
+{
+    SampleQueue*	newObj = (SampleQueue*)malloc(sizeof(SampleQueue));
+    uint32_t	size = 1;
+
+    if (NULL == newObj) {
+        return NULL;
+    }
+    while (size < capacity) {
+        size <<= 1;
+    }
+    newObj->mBody = (SampleRecord*)calloc(size, sizeof(SampleRecord));
+    if (NULL == newObj->mBody) {
+        free(newObj);
+        return NULL;
+    }
+    newObj->mMask = size - 1;
+    atomic_init(&newObj->mHead, 0);
+    atomic_init(&newObj->mTail, 0);
+    atomic_init(&newObj->mDropCount, 0);
+
+    return newObj;
+}
+
+void
+SampleQueue_Destroy(SampleQueue* me)
+{
+    if (NULL != me) {
+        free(me->mBody);
+        free(me);
+    }
+}
+
+// Capacity
+uint32_t
+SampleQueue_GetCapacity(const SampleQueue* me)
+{
+    return me->mMask + 1;
+}
+
+bool
+SampleQueue_Reserve(SampleQueue* me, uint32_t capacity)
+{
+    uint32_t	head = atomic_load_explicit(&me->mHead, memory_order_relaxed);
+    uint32_t	tail = atomic_load_explicit(&me->mTail, memory_order_relaxed);
+    uint32_t	size = me->mMask + 1;
+    SampleRecord*	newBody;
+
+    if (capacity <= size) {
+        return true;
+    }
+    while (size < capacity) {
+        size <<= 1;
+    }
+    newBody = (SampleRecord*)calloc(size, sizeof(SampleRecord));
+    if (NULL == newBody) {
+        return false;
+    }
+
+    // move the records not consumed to the top of the new ring in order
+    for (uint32_t i = 0; i < head - tail; i++) {
+        newBody[i] = me->mBody[(tail + i) & me->mMask];
+    }
+    free(me->mBody);
+    me->mBody = newBody;
+    me->mMask = size - 1;
+    atomic_store_explicit(&me->mTail, 0, memory_order_relaxed);
+    atomic_store_explicit(&me->mHead, head - tail, memory_order_relaxed);
+
+    return true;
+}
+
+// Producer side
+uint32_t
+SampleQueue_CountFree(const SampleQueue* me)
+{
+    uint32_t	head = atomic_load_explicit(&me->mHead, memory_order_relaxed);
+    uint32_t	tail = atomic_load_explicit(&me->mTail, memory_order_acquire);
+
+    return me->mMask + 1 - (head - tail);
+}
+
+SampleRecord*
+SampleQueue_GetFreeAt(SampleQueue* me, uint32_t offset)
+{
+    uint32_t	head = atomic_load_explicit(&me->mHead, memory_order_relaxed);
+
+    return &me->mBody[(head + offset) & me->mMask];
+}
+
+void
+SampleQueue_Publish(SampleQueue* me, uint32_t count)
+{
+    // make the records visible to the consumer after they are written
+    atomic_fetch_add_explicit(&me->mHead, count, memory_order_release);
+}
+
+void
+SampleQueue_AddDropCount(SampleQueue* me, uint32_t count)
+{
+    atomic_fetch_add_explicit(&me->mDropCount, count, memory_order_relaxed);
+}
+
+// Consumer side
+uint32_t
+SampleQueue_CountAvail(const SampleQueue* me)
+{
+    uint32_t	head = atomic_load_explicit(&me->mHead, memory_order_acquire);
+    uint32_t	tail = atomic_load_explicit(&me->mTail, memory_order_relaxed);
+
+    return head - tail;
+}
+
+const SampleRecord*
+SampleQueue_GetAvailAt(const SampleQueue* me, uint32_t offset)
+{
+    uint32_t	tail = atomic_load_explicit(&me->mTail, memory_order_relaxed);
+
+    return &me->mBody[(tail + offset) & me->mMask];
+}
+
+void
+SampleQueue_Consume(SampleQueue* me, uint32_t count)
+{
+    // hand the records back to the producer after they are read
+    atomic_fetch_add_explicit(&me->mTail, count, memory_order_release);
+}
+
+// Number of the records dropped for lack of room
+uint32_t
+SampleQueue_GetDropCount(const SampleQueue* me)
+{
+    return atomic_load_explicit(&me->mDropCount, memory_order_relaxed);
+}
@@ -0,0 +1,91 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Atmark Techno, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef _SAMPLE_QUEUE_H_
+#define _SAMPLE_QUEUE_H_
+
+#ifndef _STDBOOL_H
+#include <stdbool.h>
+#endif
+#ifndef _STDINT_H
+#include <stdint.h>
+#endif
+#ifndef _TIME_H
+#include <time.h>
+#endif
+
+#ifndef TELEMETRY_NAME_MAX_LEN
+#define TELEMETRY_NAME_MAX_LEN	32
+#endif
+
+// max length of the string representation of a value
+#define SAMPLE_VALUE_MAX_LEN	31
+
+// telemetry item acquired by the bus I/O thread
+typedef struct SampleRecord {
+    char    itemName[TELEMETRY_NAME_MAX_LEN + 1];  // telemetry name
+    char    value[SAMPLE_VALUE_MAX_LEN + 1];       // telemetry value
+    struct timespec sampledAt;  // wall clock time of the acquisition
+    bool    isLast;     // last item of a snapshot
+} SampleRecord;
+
+//
+// Lock-free ring buffer of fixed-size records between a single producer
+// (bus I/O thread) and a single consumer (main thread).
+// The producer fills the free records then publishes them at once, so the
+// consumer never sees a part of a snapshot.
+//
+// NOTE: The producer side also runs on the main thread, when the main
+//       thread completes the acquisition in progress by WaitIdle() (e.g.
+//       in the twin callback) while holding BusWorker_Lock(). There is a
+//       single producer at a time only because the bus I/O thread produces
+//       while holding the same lock.
+//
+typedef struct SampleQueue	SampleQueue;
+
+// Initialization and cleanup (capacity is rounded up to a power of two)
+extern SampleQueue*	SampleQueue_New(uint32_t capacity);
+extern void	SampleQueue_Destroy(SampleQueue* me);
+
+// Capacity, enlarged to hold capacity records at least keeping the records
+// not consumed yet (neither the producer nor the consumer may run meanwhile)
+extern uint32_t	SampleQueue_GetCapacity(const SampleQueue* me);
+extern bool	SampleQueue_Reserve(SampleQueue* me, uint32_t capacity);
+
+// Producer side
+extern uint32_t	SampleQueue_CountFree(const SampleQueue* me);
+extern SampleRecord*	SampleQueue_GetFreeAt(SampleQueue* me, uint32_t offset);
+extern void	SampleQueue_Publish(SampleQueue* me, uint32_t count);
+extern void	SampleQueue_AddDropCount(SampleQueue* me, uint32_t count);
+
+// Consumer side
+extern uint32_t	SampleQueue_CountAvail(const SampleQueue* me);
+extern const SampleRecord*	SampleQueue_GetAvailAt(
+    const SampleQueue* me, uint32_t offset);
+extern void	SampleQueue_Consume(SampleQueue* me, uint32_t count);
+
+// Number of the records dropped for lack of room
+extern uint32_t	SampleQueue_GetDropCount(const SampleQueue* me);
+
+#endif  // _SAMPLE_QUEUE_H_
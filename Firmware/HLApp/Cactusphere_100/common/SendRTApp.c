@@ -30,6 +30,9 @@
 #include <stdio.h>
 #include <string.h>
 #include <signal.h>
+#include <stdlib.h>
+#include <poll.h>
+#include <time.h>
 #include <sys/time.h>
 #include <sys/socket.h>
 
@@ -37,6 +40,8 @@
 #include <applibs/log.h>
 
 #include "cactusphere_product.h"
+#include "eventloop_timer_utilities.h"
+#include "vector.h"
 
 #if (APP_PRODUCT_ID == PRODUCT_ATMARK_TECHNO_DIN)
 static const char rtAppComponentId[] = "c01e5fe8-6c61-4d14-beff-38492b1502b6";  // for DI
@@ -44,28 +49,230 @@ static const char rtAppComponentId[] = "c01e5fe8-6c61-4d14-beff-38492b1502b6";
 static const char rtAppComponentId[] = "c8b178fe-5942-4584-826c-51856ac5e4ff";  // for RS485
 #endif
 
+#define MAX_RX_MESSAGE_SIZE	1024
+
+// request waiting for its response
+typedef struct SendRTApp_Request {
+    unsigned char*	txMessage;
+    long	txMessageSize;
+    long	rxMessageSize;
+    long	timeoutMs;
+    SendRTApp_Callback	callback;
+    void*	arg;
+} SendRTApp_Request;
+
+// context of the synchronous request
+typedef struct SendRTApp_SyncContext {
+    unsigned char*	rxMessage;
+    long	rxMessageSize;
+    bool	isDone;
+    long	rxLength;   // length of the response, 0 if failed
+} SendRTApp_SyncContext;
+
 static int sSockFd = -1;
+static vector	sRequests = NULL;      // vector of SendRTApp_Request (FIFO)
+static bool	sIsInFlight = false;        // first request has been sent
+static struct timespec	sDeadline;      // of the request in flight
+static EventLoop*	sEventLoop = NULL;
+static EventRegistration*	sSockReg = NULL;
+static EventLoopTimer*	sDeadlineTimer = NULL;
+static uint32_t	sNotificationMagic = 0;
+static SendRTApp_NotificationHandler	sNotificationHandler = NULL;
+static void*	sNotificationArg = NULL;
+
+static long
+SendRTApp_GetRemainingMs(void)
+{
+    struct timespec	now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long)(sDeadline.tv_sec - now.tv_sec) * 1000
+        + (sDeadline.tv_nsec - now.tv_nsec) / 1000000;
+}
+
+static void
+SendRTApp_Complete(const unsigned char* rxMessage, long rxMessageSize)
+{
+    SendRTApp_Request	req;
+
+    vector_get_first(&req, sRequests);
+    vector_remove_first(sRequests);
+    sIsInFlight = false;
+    if (sDeadlineTimer != NULL) {
+        DisarmEventLoopTimer(sDeadlineTimer);
+    }
+    free(req.txMessage);
+
+    if (rxMessage != NULL && rxMessageSize > req.rxMessageSize) {
+        rxMessageSize = req.rxMessageSize;
+    }
+    req.callback(req.arg, rxMessage, rxMessageSize);
+}
+
+static bool
+SendRTApp_DispatchNotification(const unsigned char* rxMessage, long rxMessageSize)
+{
+    uint32_t	magic;
+
+    if (sNotificationHandler == NULL || rxMessageSize < (long)sizeof(magic)) {
+        return false;
+    }
+    memcpy(&magic, rxMessage, sizeof(magic));
+    if (magic != sNotificationMagic) {
+        return false;
+    }
+    sNotificationHandler(sNotificationArg, rxMessage, rxMessageSize);
+
+    return true;
+}
+
+static void
+SendRTApp_DiscardMessages(void)
+{
+    // read out the responses for the requests already timed out
+    // (the notifications are processed as usual)
+    unsigned char	rxMessage[MAX_RX_MESSAGE_SIZE];
+    int	bytesReceived;
+
+    while (0 < (bytesReceived = recv(sSockFd, rxMessage, sizeof(rxMessage), MSG_DONTWAIT))) {
+        if (! SendRTApp_DispatchNotification(rxMessage, bytesReceived)) {
+            Log_Debug("WARNING: discarded late response from RTApp\n");
+        }
+    }
+}
+
+static void
+SendRTApp_StartNext(void)
+{
+    // send the first request if it has not been sent yet
+    while (! sIsInFlight && ! vector_is_empty(sRequests)) {
+        SendRTApp_Request*	req = (SendRTApp_Request*)vector_get_data(sRequests);
+
+        SendRTApp_DiscardMessages();
+        if (! SendRTApp_SendMessageToRTCore(req->txMessage, req->txMessageSize)) {
+            SendRTApp_Complete(NULL, 0);
+            continue;
+        }
+        sIsInFlight = true;
+
+        clock_gettime(CLOCK_MONOTONIC, &sDeadline);
+        sDeadline.tv_sec += req->timeoutMs / 1000;
+        sDeadline.tv_nsec += (req->timeoutMs % 1000) * 1000000;
+        if (sDeadline.tv_nsec >= 1000000000) {
+            sDeadline.tv_sec++;
+            sDeadline.tv_nsec -= 1000000000;
+        }
+        if (sDeadlineTimer != NULL) {
+            struct timespec	delay = {
+                .tv_sec = req->timeoutMs / 1000,
+                .tv_nsec = (req->timeoutMs % 1000) * 1000000 };
+
+            SetEventLoopTimerOneShot(sDeadlineTimer, &delay);
+        }
+    }
+}
+
+static void
+SendRTApp_ReceiveMessage(void)
+{
+    unsigned char	rxMessage[MAX_RX_MESSAGE_SIZE];
+    int	bytesReceived;
+
+    bytesReceived = recv(sSockFd, rxMessage, sizeof(rxMessage), MSG_DONTWAIT);
+    if (bytesReceived == -1) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            Log_Debug("ERROR: Unable to receive message: %d (%s)\n", errno, strerror(errno));
+        }
+        return;
+    }
+    if (SendRTApp_DispatchNotification(rxMessage, bytesReceived)) {
+        return;
+    }
+    if (! sIsInFlight) {
+        Log_Debug("WARNING: discarded late response from RTApp\n");
+        return;
+    }
+
+    SendRTApp_Complete(rxMessage, bytesReceived);
+    SendRTApp_StartNext();
+}
+
+static void
+SendRTApp_CheckTimeout(void)
+{
+    if (sIsInFlight && SendRTApp_GetRemainingMs() <= 0) {
+        Log_Debug("ERROR: No response from RTApp\n");
+        SendRTApp_Complete(NULL, 0);
+        SendRTApp_StartNext();
+    }
+}
+
+static void
+SendRTApp_ProcessUntil(const bool* isDone)
+{
+    // process responses without the event loop
+    // until the flag is set (or all the requests complete if NULL)
+    struct pollfd	pfd = { .fd = sSockFd, .events = POLLIN };
+
+    while (sIsInFlight && (isDone == NULL || ! *isDone)) {
+        long	remainingMs = SendRTApp_GetRemainingMs();
+        int	ret;
+
+        ret = poll(&pfd, 1, (int)(remainingMs > 0 ? remainingMs : 0));
+        if (ret > 0) {
+            SendRTApp_ReceiveMessage();
+        } else if (ret == 0) {
+            SendRTApp_CheckTimeout();
+        } else if (errno != EINTR) {
+            Log_Debug("ERROR: Unable to poll socket: %d (%s)\n", errno, strerror(errno));
+            SendRTApp_Complete(NULL, 0);
+            SendRTApp_StartNext();
+        }
+    }
+}
+
+static void
+SendRTApp_SocketEventHandler(EventLoop* el, int fd,
+    EventLoop_IoEvents events, void* context)
+{
+    SendRTApp_ReceiveMessage();
+}
+
+static void
+SendRTApp_DeadlineTimerEventHandler(EventLoopTimer* timer)
+{
+    if (ConsumeEventLoopTimerEvent(timer) != 0) {
+        return;
+    }
+    SendRTApp_CheckTimeout();
+}
+
+static void
+SendRTApp_SyncCallback(void* arg, const unsigned char* rxMessage, long rxMessageSize)
+{
+    SendRTApp_SyncContext*	ctx = (SendRTApp_SyncContext*)arg;
+
+    if (rxMessage != NULL) {
+        memcpy(ctx->rxMessage, rxMessage, (size_t)rxMessageSize);
+        ctx->rxLength = rxMessageSize;
+    }
+    ctx->isDone = true;
+}
 
 // Initialization and cleanup
 bool
 SendRTApp_InitHandlers(void)
 {
-    // open connection to RTApp and set receive timeout time
-    static const struct timeval recvTimeout =
-        { .tv_sec = 5 * 10,.tv_usec = 0 };
-    int result;
-
+    // open connection to RTApp
+    sRequests = vector_init(sizeof(SendRTApp_Request));
+    if (sRequests == NULL) {
+        return false;
+    }
     sSockFd = Application_Connect(rtAppComponentId);
     if (sSockFd == -1) {
         Log_Debug("ERROR: Unable to create socket: %d (%s)\n", errno, strerror(errno));
         return false;
     }
-    result = setsockopt(sSockFd,
-        SOL_SOCKET, SO_RCVTIMEO, &recvTimeout, sizeof(recvTimeout));
-    if (result == -1) {
-        Log_Debug("ERROR: Unable to set socket timeout: %d (%s)\n", errno, strerror(errno));
-        return false;
-    }
 
     return true;
 }
@@ -73,13 +280,67 @@ SendRTApp_InitHandlers(void)
 void SendRTApp_CloseHandlers(void)
 {
     Log_Debug("Closing file descriptors.\n");
+    if (sSockReg != NULL) {
+        EventLoop_UnregisterIo(sEventLoop, sSockReg);
+        sSockReg = NULL;
+    }
+    if (sDeadlineTimer != NULL) {
+        DisposeEventLoopTimer(sDeadlineTimer);
+        sDeadlineTimer = NULL;
+    }
+    sEventLoop = NULL;
+    if (sRequests != NULL) {
+        SendRTApp_Request*	reqCurs = (SendRTApp_Request*)vector_get_data(sRequests);
+
+        for (int i = 0, n = vector_size(sRequests); i < n; i++, reqCurs++) {
+            free(reqCurs->txMessage);
+        }
+        sRequests = vector_destroy(sRequests);
+        sIsInFlight = false;
+    }
     if (sSockFd >= 0) {
         if (close(sSockFd) != 0) {
             Log_Debug("ERROR: Could not close fd %s: %s (%d).\n", "Socket", strerror(errno), errno);
         }
+        sSockFd = -1;
     }
 }
 
+// Receive responses and detect timeouts on the event loop
+bool
+SendRTApp_RegisterEventLoop(EventLoop* eventLoop)
+{
+    if (sSockFd < 0) {
+        return false;
+    }
+    sSockReg = EventLoop_RegisterIo(eventLoop, sSockFd, EventLoop_Input,
+        SendRTApp_SocketEventHandler, NULL);
+    if (sSockReg == NULL) {
+        Log_Debug("ERROR: Unable to register socket: %d (%s)\n", errno, strerror(errno));
+        return false;
+    }
+    sDeadlineTimer = CreateEventLoopDisarmedTimer(eventLoop,
+        SendRTApp_DeadlineTimerEventHandler);
+    if (sDeadlineTimer == NULL) {
+        EventLoop_UnregisterIo(eventLoop, sSockReg);
+        sSockReg = NULL;
+        return false;
+    }
+    sEventLoop = eventLoop;
+
+    return true;
+}
+
+// Receive the message which begins with magic by the handler
+void
+SendRTApp_SetNotificationHandler(uint32_t magic,
+    SendRTApp_NotificationHandler handler, void* arg)
+{
+    sNotificationMagic = magic;
+    sNotificationHandler = handler;
+    sNotificationArg = arg;
+}
+
 // Send request message to RTApp (and receve response)
 bool
 SendRTApp_SendMessageToRTCore(
@@ -89,29 +350,66 @@ SendRTApp_SendMessageToRTCore(
 
     if (bytesSent == -1) {
         Log_Debug("ERROR: Unable to send message: %d (%s)\n", errno, strerror(errno));
-        SendRTApp_CloseHandlers();
         return false;
     }
 
     return true;
 }
 
-bool
+long
 SendRTApp_SendMessageToRTCoreAndReadMessage(
     const unsigned char* txMessage, long txMessageSize,
     unsigned char* rxMessage, long rxMessageSize)
 {
-    int bytesReceived;
+    // wait for the response while processing the preceding requests
+    SendRTApp_SyncContext	ctx = {
+        .rxMessage = rxMessage, .rxMessageSize = rxMessageSize,
+        .isDone = false, .rxLength = 0 };
+
+    if (! SendRTApp_SubmitMessage(txMessage, txMessageSize, rxMessageSize,
+            SENDRTAPP_SYNC_TIMEOUT_MS, SendRTApp_SyncCallback, &ctx)) {
+        return 0;
+    }
+    SendRTApp_ProcessUntil(&ctx.isDone);
+
+    return ctx.rxLength;
+}
+
+// Send request message to RTApp and call back on its response (or timeout)
+bool
+SendRTApp_SubmitMessage(
+    const unsigned char* txMessage, long txMessageSize,
+    long rxMessageSize, long timeoutMs,
+    SendRTApp_Callback callback, void* arg)
+{
+    SendRTApp_Request	req = {
+        .txMessageSize = txMessageSize, .rxMessageSize = rxMessageSize,
+        .timeoutMs = timeoutMs, .callback = callback, .arg = arg };
 
-    if (! SendRTApp_SendMessageToRTCore(txMessage, txMessageSize)) {
+    if (sSockFd < 0 || rxMessageSize > MAX_RX_MESSAGE_SIZE) {
         return false;
     }
-    bytesReceived = recv(sSockFd, rxMessage, (size_t)rxMessageSize, 0);
-    if (bytesReceived == -1) {
-        Log_Debug("ERROR: Unable to receive message: %d (%s)\n", errno, strerror(errno));
-        SendRTApp_CloseHandlers();
+    req.txMessage = (unsigned char*)malloc((size_t)txMessageSize);
+    if (req.txMessage == NULL) {
         return false;
     }
+    memcpy(req.txMessage, txMessage, (size_t)txMessageSize);
+    if (0 != vector_add_last(sRequests, &req)) {
+        free(req.txMessage);
+        return false;
+    }
+
+    SendRTApp_StartNext();
+    if (sEventLoop == NULL) {
+        SendRTApp_ProcessUntil(NULL);  // no event loop, complete here
+    }
 
     return true;
 }
+
+// Process responses until all the submitted requests complete
+void
+SendRTApp_WaitIdle(void)
+{
+    SendRTApp_ProcessUntil(NULL);
+}
@@ -28,16 +28,55 @@
 #ifndef _STDBOOL_H
 #include <stdbool.h>
 #endif
+#ifndef _STDINT_H
+#include <stdint.h>
+#endif
+
+#include <applibs/eventloop.h>
+
+// deadline of the synchronous request
+#define SENDRTAPP_SYNC_TIMEOUT_MS	5000
+
+// completion callback of the asynchronous request
+//   rxMessage is NULL if failed to send or timed out,
+//   it is valid only until the callback returns
+typedef void (*SendRTApp_Callback)(
+    void* arg, const unsigned char* rxMessage, long rxMessageSize);
+
+// handler of the message which RTApp sends without request
+//   message is valid only until the handler returns
+typedef void (*SendRTApp_NotificationHandler)(
+    void* arg, const unsigned char* message, long messageSize);
 
 // Initialization and cleanup
 extern bool SendRTApp_InitHandlers(void);
 extern void SendRTApp_CloseHandlers(void);
 
+// Receive responses and detect timeouts on the event loop
+extern bool SendRTApp_RegisterEventLoop(EventLoop* eventLoop);
+
+// Receive the message which begins with magic (uint32_t) by the handler
+// instead of as a response (handler NULL to stop)
+extern void SendRTApp_SetNotificationHandler(uint32_t magic,
+    SendRTApp_NotificationHandler handler, void* arg);
+
 // Send request message to RTApp (and receve response)
+//   SendMessageToRTCoreAndReadMessage returns the length of the response
+//   stored in rxMessage, or 0 if failed (no response)
 extern bool SendRTApp_SendMessageToRTCore(
     const unsigned char* txMessage, long txMessageSize);
-extern bool SendRTApp_SendMessageToRTCoreAndReadMessage(
+extern long SendRTApp_SendMessageToRTCoreAndReadMessage(
     const unsigned char* txMessage, long txMessageSize,
     unsigned char* rxMessage, long rxMessageSize);
 
+// Send request message to RTApp and call back on its response (or timeout)
+//   requests are sent one by one in submitted order
+extern bool SendRTApp_SubmitMessage(
+    const unsigned char* txMessage, long txMessageSize,
+    long rxMessageSize, long timeoutMs,
+    SendRTApp_Callback callback, void* arg);
+
+// Process responses until all the submitted requests complete
+extern void SendRTApp_WaitIdle(void);
+
 #endif  // _TELEMETRYITEMS_H_
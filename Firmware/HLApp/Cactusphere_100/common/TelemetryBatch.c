@@ -0,0 +1,143 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Atmark Techno, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "TelemetryBatch.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "StringBuf.h"
+
+// format of a snapshot
+#define TELEMETRY_BATCH_ELEM_FORMAT	"{\"ts\":\"%s\",\"values\":%s}"
+
+// TelemetryBatch class's data members
+struct TelemetryBatch {
+    StringBuf*	mBody;          // snapshots separated by comma
+    StringBuf*	mJson;          // for ToJson()
+    int	mCount;                 // number of snapshots
+    uint32_t	mFirstTimeStamp;    // time stamp of the first snapshot
+};
+
+// Initialization and cleanup
+TelemetryBatch*
+TelemetryBatch_New(void)
+{
+    TelemetryBatch*	newObj = (TelemetryBatch*)malloc(sizeof(TelemetryBatch));
+
+    if (NULL != newObj) {
+        newObj->mBody = StringBuf_New();
+        newObj->mJson = StringBuf_New();
+        if (NULL == newObj->mBody || NULL == newObj->mJson) {
+            if (NULL != newObj->mBody) {
+                StringBuf_Destroy(newObj->mBody);
+            }
+            if (NULL != newObj->mJson) {
+                StringBuf_Destroy(newObj->mJson);
+            }
+            free(newObj);
+            return NULL;
+        }
+        newObj->mCount = 0;
+        newObj->mFirstTimeStamp = 0;
+    }
+
+    return newObj;
+}
+
+void
+TelemetryBatch_Destroy(TelemetryBatch* me)
+{
+    StringBuf_Destroy(me->mJson);
+    StringBuf_Destroy(me->mBody);
+    free(me);
+}
+
+void
+TelemetryBatch_Clear(TelemetryBatch* me)
+{
+    StringBuf_Clear(me->mBody);
+    StringBuf_Clear(me->mJson);
+    me->mCount = 0;
+    me->mFirstTimeStamp = 0;
+}
+
+// Attribute
+int
+TelemetryBatch_Count(const TelemetryBatch* me)
+{
+    return me->mCount;
+}
+
+uint32_t
+TelemetryBatch_GetFirstTimeStamp(const TelemetryBatch* me)
+{
+    return me->mFirstTimeStamp;
+}
+
+// Length of the JSON text if the snapshot is added
+size_t
+TelemetryBatch_GetLengthWith(TelemetryBatch* me,
+    const char* dateTimeStr, const char* valuesJson)
+{
+    // brackets, separator and the snapshot
+    size_t	length = 2;
+
+    if (me->mCount > 0) {
+        // length of the buffer counts the terminator, in place of separator
+        length += StringBuf_GetLength(me->mBody);
+    }
+    return length + strlen(TELEMETRY_BATCH_ELEM_FORMAT) - 4
+        + strlen(dateTimeStr) + strlen(valuesJson);
+}
+
+// Add a snapshot of telemetry values taken at the time
+void
+TelemetryBatch_Add(TelemetryBatch* me,
+    const char* dateTimeStr, const char* valuesJson, uint32_t timeStamp)
+{
+    if (me->mCount == 0) {
+        me->mFirstTimeStamp = timeStamp;
+    } else {
+        StringBuf_AppendChar(me->mBody, ',');
+    }
+    StringBuf_AppendByPrintf(me->mBody, TELEMETRY_BATCH_ELEM_FORMAT,
+        dateTimeStr, valuesJson);
+    me->mCount++;
+}
+
+// Convert to JSON text
+const char*
+TelemetryBatch_ToJson(TelemetryBatch* me)
+{
+    StringBuf_Clear(me->mJson);
+    StringBuf_AppendChar(me->mJson, '[');
+    if (me->mCount > 0) {
+        // buffer of the cleared body still has the head of the old snapshots
+        StringBuf_Append(me->mJson, StringBuf_GetStr(me->mBody));
+    }
+    StringBuf_AppendChar(me->mJson, ']');
+
+    return StringBuf_GetStr(me->mJson);
+}
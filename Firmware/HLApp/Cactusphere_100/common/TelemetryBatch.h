@@ -0,0 +1,67 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Atmark Techno, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef _TELEMETRY_BATCH_H_
+#define _TELEMETRY_BATCH_H_
+
+#ifndef _STDDEF_H
+#include <stddef.h>
+#endif
+#ifndef _STDINT_H
+#include <stdint.h>
+#endif
+
+// billing unit of IoT Hub device-to-cloud message (in bytes)
+#define TELEMETRY_BATCH_BILLING_UNIT	4096
+
+// default size of a batch, leaves room for the message properties
+#define TELEMETRY_BATCH_DEFAULT_SIZE	(TELEMETRY_BATCH_BILLING_UNIT - 128)
+
+// range of the size of a batch (up to the maximum message size of IoT Hub)
+#define TELEMETRY_BATCH_MIN_SIZE	256
+#define TELEMETRY_BATCH_MAX_SIZE	(256 * 1024)
+
+typedef struct TelemetryBatch	TelemetryBatch;
+
+// Initialization and cleanup
+extern TelemetryBatch*	TelemetryBatch_New(void);
+extern void	TelemetryBatch_Destroy(TelemetryBatch* me);
+extern void	TelemetryBatch_Clear(TelemetryBatch* me);
+
+// Attribute
+extern int	TelemetryBatch_Count(const TelemetryBatch* me);
+extern uint32_t	TelemetryBatch_GetFirstTimeStamp(const TelemetryBatch* me);
+
+// Length of the JSON text if the snapshot is added
+extern size_t	TelemetryBatch_GetLengthWith(TelemetryBatch* me,
+    const char* dateTimeStr, const char* valuesJson);
+
+// Add a snapshot of telemetry values (JSON object) taken at the time
+extern void	TelemetryBatch_Add(TelemetryBatch* me,
+    const char* dateTimeStr, const char* valuesJson, uint32_t timeStamp);
+
+// Convert to JSON text, [{"ts":<date time>,"values":{...}}, ...]
+extern const char*	TelemetryBatch_ToJson(TelemetryBatch* me);
+
+#endif  // _TELEMETRY_BATCH_H_
@@ -31,6 +31,7 @@
 #include "TelemetryItems.h"
 
 const char	MARKER_NAME[] = "___-___";
+const char	MSEC_NAME[]   = "___ms___";
 
 typedef struct TelemetryItemCache {
     TelemetryCacheElem* mRingBuf;	// ring buffer area
@@ -161,9 +162,9 @@ TelemetryItemCache_CountAvailItems(const TelemetryItemCache* me)
         }
     }
 
-    return (0 < numSpace ? (numSpace - 1) : 0);
+    return (2 < numSpace ? (numSpace - 2) : 0);
 //
-// NOET: Subtract 1 for time stamp / separator markers
+// NOET: Subtract 2 for time stamp / separator markers and milliseconds
 }
 
 bool
@@ -175,10 +176,11 @@ TelemetryItemCache_IsEmpty(const TelemetryItemCache* me)
 // Add and remove chace elem
 bool
 TelemetryItemCache_EnqueueItems(TelemetryItemCache* me,
-    const TelemetryItems* items, uint32_t timeStamp)
+    const TelemetryItems* items, uint32_t timeStamp, uint32_t msec)
 {
     // Puts all passed telemetry data items into the ring buffer 
-    // with a timestamp/separation marker at the beginning.
+    // with a timestamp/separation marker and the milliseconds of the
+    // timestamp at the beginning.
     // When there is no enough space left, discard old caches.
     TelemetryCacheElem* curs;
 
@@ -195,6 +197,12 @@ TelemetryItemCache_EnqueueItems(TelemetryItemCache* me,
     if (++(me->mWritePos) > me->mIndexMax) {
         me->mWritePos = 0;
     }
+    curs = me->mRingBuf + (me->mWritePos % me->mBufSize);
+    curs->itemName = MSEC_NAME;
+    curs->value.ul = msec;
+    if (++(me->mWritePos) > me->mIndexMax) {
+        me->mWritePos = 0;
+    }
 
     for (int i = 0, n = TelemetryItems_Count(items); i < n; ++i) {
         curs = me->mRingBuf + (me->mWritePos % me->mBufSize);
@@ -210,7 +218,7 @@ TelemetryItemCache_EnqueueItems(TelemetryItemCache* me,
 
 bool
 TelemetryItemCache_DequeueItemsTo(TelemetryItemCache* me,
-    TelemetryItems* outItems, uint32_t* outTimeStamp)
+    TelemetryItems* outItems, uint32_t* outTimeStamp, uint32_t* outMsec)
 {
     // Retrieve a set of telemetry data items from the cache. Extract 
     // from the first time stamp / separation marker to the next one.
@@ -222,6 +230,7 @@ TelemetryItemCache_DequeueItemsTo(TelemetryItemCache* me,
 
     TelemetryItems_Clear(outItems);
     *outTimeStamp = 0;
+    *outMsec = 0;
 
     cacheElem = me->mRingBuf + (me->mReadPos % me->mBufSize);
     if (0 != strcmp(cacheElem->itemName, MARKER_NAME)) {
@@ -246,7 +255,11 @@ TelemetryItemCache_DequeueItemsTo(TelemetryItemCache* me,
         if (0 == strcmp(cacheElem->itemName, MARKER_NAME)) {
             break;
         }
-        TelemetryItems_AddFromCacheElem(outItems, cacheElem);
+        if (0 == strcmp(cacheElem->itemName, MSEC_NAME)) {
+            *outMsec = cacheElem->value.ul;
+        } else {
+            TelemetryItems_AddFromCacheElem(outItems, cacheElem);
+        }
         if (++(me->mReadPos) > me->mIndexMax) {
             me->mReadPos = 0;
         }
@@ -57,8 +57,8 @@ extern bool	TelemetryItemCache_IsEmpty(const TelemetryItemCache* me);
 
 // Add and remove chace elem
 extern bool	TelemetryItemCache_EnqueueItems(TelemetryItemCache* me,
-    const TelemetryItems* items, uint32_t timeStamp);
+    const TelemetryItems* items, uint32_t timeStamp, uint32_t msec);
 extern bool	TelemetryItemCache_DequeueItemsTo(TelemetryItemCache* me,
-    TelemetryItems* outItems, uint32_t* outTimeStamp);
+    TelemetryItems* outItems, uint32_t* outTimeStamp, uint32_t* outMsec);
 
 #endif  // _TELEMETRY_ITEM_CACHE_H_
@@ -34,6 +34,7 @@
 
 #include "TelemetryItems.h"
 #include "TelemetryItemCache.h"
+#include "SampleQueue.h"
 #include "StringBuf.h"
 
 // string representation of telemetry data item
@@ -165,6 +166,33 @@ TelemetryItems_Clear(TelemetryItems* me) {
     vector_clear(me->mBody);
 }
 
+void
+TelemetryItems_Set(TelemetryItems* me, const char* name, const char* value)
+{
+    TelemetryItem* tempP = (TelemetryItem*)vector_get_data(me->mBody);
+
+    for (int i = 0, n = vector_size(me->mBody); i < n; i++) {
+        if (0 == strcmp(tempP[i].name, name)) {
+            char* newValue = strdup(value);
+
+            free(tempP[i].value);
+            tempP[i].value = newValue;
+            return;
+        }
+    }
+    TelemetryItems_Add(me, name, value);
+}
+
+void
+TelemetryItems_Append(TelemetryItems* me, const TelemetryItems* other)
+{
+    const TelemetryItem* tempP = (const TelemetryItem*)vector_get_data(other->mBody);
+
+    for (int i = 0, n = vector_size(other->mBody); i < n; i++) {
+        TelemetryItems_Add(me, tempP[i].name, tempP[i].value);
+    }
+}
+
 // Mutual conversion between cache elem
 TelemetryCacheElem*
 TelemetryItems_ConvToCacheElemAt(
@@ -211,6 +239,40 @@ TelemetryItems_AddFromCacheElem(TelemetryItems* me,
     TelemetryItems_Add(me, cacheElem->itemName, StringBuf_GetStr(me->mSb));
 }
 
+// Mutual conversion between sample record
+bool
+TelemetryItems_ConvToSampleRecordAt(
+    const TelemetryItems* me, int index, SampleRecord* outRecord)
+{
+    TelemetryItem*	item = (TelemetryItem*)vector_get_data(me->mBody) + index;
+
+    if (strlen(item->name) > TELEMETRY_NAME_MAX_LEN
+        || strlen(item->value) > SAMPLE_VALUE_MAX_LEN) {
+        Log_Debug("ERROR: too long telemetry item %s:%s\n", item->name, item->value);
+        return false;
+    }
+    strcpy(outRecord->itemName, item->name);
+    strcpy(outRecord->value, item->value);
+
+    return true;
+}
+
+void
+TelemetryItems_AddFromSampleRecord(TelemetryItems* me,
+    const SampleRecord* record)
+{
+    // The record has a copy of the item name, so refer the name in the
+    // telemetry item data type dictionary instead of it.
+    // The item removed by configuration change after acquisition is ignored.
+    TelemetryItemDictElem	dictElem;
+    const char*	itemName = record->itemName;
+
+    if (! dictionary_get(&dictElem, sTelemetryItemDict, &itemName)) {
+        return;  // not found
+    }
+    TelemetryItems_Add(me, dictElem.itemName, record->value);
+}
+
 // Convert to JSON text
 const char*
 TelemetryItems_ToJson(TelemetryItems* me)
@@ -235,11 +297,21 @@ bool
 TelemetryItems_LoadFromJson(TelemetryItems* me, const char* jsonStr)
 {
     json_value* jsonObj = json_parse(jsonStr, strlen(jsonStr));
+    bool	ret;
 
     if (NULL == jsonObj) {
         return false;
-    } else if (json_object != jsonObj->type) {
-        json_value_free(jsonObj);
+    }
+    ret = TelemetryItems_LoadFromJsonValue(me, jsonObj);
+    json_value_free(jsonObj);
+
+    return ret;
+}
+
+bool
+TelemetryItems_LoadFromJsonValue(TelemetryItems* me, const json_value* jsonObj)
+{
+    if (json_object != jsonObj->type) {
         return false;
     } else {
         json_object_entry*  curs = jsonObj->u.object.values;
@@ -249,7 +321,7 @@ TelemetryItems_LoadFromJson(TelemetryItems* me, const char* jsonStr)
         TelemetryItems_Clear(me);
         for (; curs < end; ++curs) {
             if (! dictionary_get(&dictElem, sTelemetryItemDict, &curs->name)) {
-                goto err;  // unkown item
+                return false;  // unkown item
             }
 
             StringBuf_Clear(me->mSb);
@@ -263,14 +335,11 @@ TelemetryItems_LoadFromJson(TelemetryItems* me, const char* jsonStr)
                     me->mSb, "%f", (float)curs->value->u.dbl);
                 break;
             default:
-                goto err;  // unexpected type
+                return false;  // unexpected type
             }
             TelemetryItems_Add(me, dictElem.itemName, StringBuf_GetStr(me->mSb));
         }
 
         return true;
-err:
-        json_value_free(jsonObj);
-        return false;
     }
 }
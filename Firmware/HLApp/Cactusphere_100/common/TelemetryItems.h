@@ -31,6 +31,8 @@
 
 typedef struct TelemetryItems	TelemetryItems;
 typedef struct TelemetryCacheElem	TelemetryCacheElem;
+typedef struct SampleRecord	SampleRecord;
+typedef struct _json_value	json_value;
 
 // Initialization and cleanup of the telemetry item data type dicitionary
 extern void	TelemetryItems_InitDictionary(void);
@@ -53,17 +55,33 @@ extern void TelemetryItems_Add(
     TelemetryItems* me, const char* name, const char* value);
 extern void TelemetryItems_Clear(TelemetryItems* me);
 
+// Replace the value of the item of same name (add if not found)
+extern void TelemetryItems_Set(
+    TelemetryItems* me, const char* name, const char* value);
+
+// Add all the items of other
+extern void TelemetryItems_Append(
+    TelemetryItems* me, const TelemetryItems* other);
+
 // Mutual conversion between cache elem
 extern TelemetryCacheElem* TelemetryItems_ConvToCacheElemAt(
     const TelemetryItems* me, int index, TelemetryCacheElem* outCacheElem);
 extern void	TelemetryItems_AddFromCacheElem(TelemetryItems* me,
     const TelemetryCacheElem* cacheElem);
 
+// Mutual conversion between sample record
+extern bool	TelemetryItems_ConvToSampleRecordAt(
+    const TelemetryItems* me, int index, SampleRecord* outRecord);
+extern void	TelemetryItems_AddFromSampleRecord(TelemetryItems* me,
+    const SampleRecord* record);
+
 // Convert to JSON text
 extern const char* TelemetryItems_ToJson(TelemetryItems* me);
 
 // Convert from JSON text
 extern bool TelemetryItems_LoadFromJson(
     TelemetryItems* me, const char* jsonStr);
+extern bool TelemetryItems_LoadFromJsonValue(
+    TelemetryItems* me, const json_value* jsonObj);
 
 #endif  // _TELEMETRYITEMS_H_
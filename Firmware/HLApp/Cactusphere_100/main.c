@@ -98,6 +98,13 @@ typedef enum {
     ExitCode_Validate_ConnectionType,
     ExitCode_Validate_ScopeId,
     ExitCode_Validate_IotHubHostname,
+
+    ExitCode_FetchTimer_Consume,
+    ExitCode_Init_FetchTimer,
+
+    ExitCode_TelemetryTimer_Consume,
+    ExitCode_Init_TelemetryTimer,
+    ExitCode_Init_BusWorker,
 } ExitCode;
 
 static volatile sig_atomic_t exitCode = ExitCode_Success;
@@ -105,8 +112,11 @@ static volatile sig_atomic_t exitCode = ExitCode_Success;
 #include "json.h"
 
 #include "LibCloud.h"
+#include "BusWorker.h"
 #include "DataFetchScheduler.h"
+#include "FetchTimers.h"
 #include "SendRTApp.h"
+#include "TelemetryBatch.h"
 #include "TelemetryItems.h"
 #include "PropertyItems.h"
 
@@ -131,11 +141,13 @@ static volatile sig_atomic_t exitCode = ExitCode_Success;
 #include "ModbusFetchConfig.h"
 #include "LibModbus.h"
 #include "ModbusDataFetchScheduler.h"
+#include "ModbusTcpServer.h"
 #endif  // USE_MODBUS
 
 #ifdef USE_MODBUS_TCP
 #include "ModbusTcpConfigMgr.h"
 #include "ModbusTcpFetchConfig.h"
+#include "LibModbusTcp.h"
 #endif // USE_MODBUS_TCP
 
 #ifdef USE_DI
@@ -239,6 +251,11 @@ static EventLoop *eventLoop = NULL;
 static EventLoopTimer *azureTimer = NULL;
 static EventLoopTimer *watchdogLoopTimer = NULL;
 static EventLoopTimer *ledEventLoopTimer = NULL;
+static EventLoopTimer *telemetryTimer = NULL;
+
+// Data acquisition is dispatched by the bus I/O thread
+static EventLoop *busEventLoop = NULL;
+static EventLoopTimer *fetchTimer = NULL;
 
 // Azure IoT poll periods
 static const int AzureIoTDefaultPollPeriodSeconds = 1; // 1[s]
@@ -247,10 +264,20 @@ static const int AzureIoTMaxReconnectPeriodSeconds = 10 * 60;
 
 static int azureIoTPollPeriodSeconds = -1;
 
+// Data acquisition timer is armed for the earliest deadline of the schedulers,
+// and at least once in this period to apply the configuration changes
+static const uint64_t FetchTimerMaxPeriodMs = 1000; // 1[s]
+
+// Period to send the telemetry acquired by the bus I/O thread
+static const long TelemetryTimerPeriodMs = 100; // 100[ms]
+
 #define MAX_SCHEDULER_NUM   3
 static DataFetchScheduler* mTelemetrySchedulerArr[MAX_SCHEDULER_NUM] = { NULL };
 
 static void AzureTimerEventHandler(EventLoopTimer *timer);
+static void TelemetryTimerEventHandler(EventLoopTimer *timer);
+static void FetchTimerEventHandler(EventLoopTimer *timer);
+static void ArmFetchTimer(void);
 static void WatchdogEventHandler(EventLoopTimer *timer);
 static void LedEventHandler(EventLoopTimer *timer);
 static ExitCode ValidateUserConfiguration(void);
@@ -409,6 +436,9 @@ int main(int argc, char *argv[])
     }
 
     exitCode = InitPeripheralsAndHandlers();
+    if (exitCode == ExitCode_Success && ! BusWorker_Start(busEventLoop)) {
+        exitCode = ExitCode_Init_BusWorker;
+    }
 
     // Main loop
     while (exitCode == ExitCode_Success) {
@@ -419,6 +449,14 @@ int main(int argc, char *argv[])
         }
     }
 
+    // stop the bus I/O thread, then
+    // wait for the data acquisition in progress before releasing its targets
+    BusWorker_Stop();
+    SendRTApp_WaitIdle();
+#ifdef USE_MODBUS_TCP
+    LibmodbusTcp_WaitIdle();
+#endif  // USE_MODBUS_TCP
+
     TelemetryItems_CleanupDictionary();
 #ifdef USE_MODBUS
     ModbusConfigMgr_Cleanup();
@@ -492,23 +530,85 @@ static void AzureTimerEventHandler(EventLoopTimer *timer)
         }
     }
 
+    // send the packed telemetry reaching the max age
+    if (ct_error >= 0) {
+        IoT_CentralLib_FlushTelemetry(false);
+    }
 
-    if (ct_error < 0) {
-        goto dowork;
+    if (iothubClientHandle != NULL) {
+        IoTHubDeviceClient_LL_DoWork(iothubClientHandle);
     }
+}
 
-    for (int i = 0; i < MAX_SCHEDULER_NUM; i++) {
-        DataFetchScheduler* scheduler = mTelemetrySchedulerArr[i];
+/// <summary>
+/// Telemetry timer event:  Send the telemetry acquired by the bus I/O thread
+/// </summary>
+static void TelemetryTimerEventHandler(EventLoopTimer *timer)
+{
+    if (ConsumeEventLoopTimerEvent(timer) != 0) {
+        exitCode = ExitCode_TelemetryTimer_Consume;
+        return;
+    }
 
-        if (NULL != scheduler) {
-            DataFetchScheduler_Schedule(scheduler);
+    if (ct_error >= 0) {
+        DataFetchScheduler_FlushTelemetry();
+    }
+}
+
+/// <summary>
+/// Data acquisition timer event:  Acquire the data of expired items
+/// (on the bus I/O thread)
+/// </summary>
+static void FetchTimerEventHandler(EventLoopTimer *timer)
+{
+    if (ConsumeEventLoopTimerEvent(timer) != 0) {
+        exitCode = ExitCode_FetchTimer_Consume;
+        return;
+    }
+
+    if (ct_error >= 0) {
+        for (int i = 0; i < MAX_SCHEDULER_NUM; i++) {
+            DataFetchScheduler* scheduler = mTelemetrySchedulerArr[i];
+
+            if (NULL != scheduler) {
+                DataFetchScheduler_Schedule(scheduler);
+            }
         }
     }
 
-dowork:
-    if (iothubClientHandle != NULL) {
-        IoTHubDeviceClient_LL_DoWork(iothubClientHandle);
+    ArmFetchTimer();
+}
+
+/// <summary>
+/// Arm the data acquisition timer for the earliest deadline of the schedulers
+/// </summary>
+static void ArmFetchTimer(void)
+{
+    uint64_t now = FetchTimers_GetCurrentTime();
+    uint64_t delayMs = FetchTimerMaxPeriodMs;
+
+    if (ct_error >= 0) {
+        for (int i = 0; i < MAX_SCHEDULER_NUM; i++) {
+            DataFetchScheduler* scheduler = mTelemetrySchedulerArr[i];
+
+            if (NULL != scheduler) {
+                uint64_t deadline = DataFetchScheduler_GetNextDeadline(scheduler);
+
+                if (deadline <= now) {
+                    delayMs = 0;
+                } else if (deadline - now < delayMs) {
+                    delayMs = deadline - now;
+                }
+            }
+        }
+    }
+    if (delayMs == 0) {
+        delayMs = 1;  // zero disarms the timer
     }
+
+    struct timespec fetchDelay = {.tv_sec = (time_t)(delayMs / 1000),
+                                  .tv_nsec = (long)(delayMs % 1000) * 1000 * 1000};
+    SetEventLoopTimerOneShot(fetchTimer, &fetchDelay);
 }
 
 /// <summary>
@@ -833,6 +933,27 @@ static ExitCode InitPeripheralsAndHandlers(void)
         return ExitCode_SetUpSysEvent_EventLoop;
     }
 
+    // data acquisition is dispatched by the bus I/O thread
+    busEventLoop = EventLoop_Create();
+    if (busEventLoop == NULL) {
+        Log_Debug("Could not create event loop for bus I/O.\n");
+        return ExitCode_Init_EventLoop;
+    }
+
+    // communicate with RTApp without blocking the event loop
+    if (! SendRTApp_RegisterEventLoop(busEventLoop)) {
+        Log_Debug("WARNING: RTApp communication falls back to blocking mode.\n");
+    }
+#ifdef USE_MODBUS
+    // local Modbus TCP server is started by ModbusServerConfig
+    (void)ModbusTcpServer_RegisterEventLoop(busEventLoop);
+#endif  // USE_MODBUS
+#ifdef USE_MODBUS_TCP
+    if (! LibmodbusTcp_RegisterEventLoop(busEventLoop)) {
+        Log_Debug("WARNING: Modbus TCP communication falls back to blocking mode.\n");
+    }
+#endif  // USE_MODBUS_TCP
+
     SetupWatchdog();
     struct timespec watchdogKickPeriod = {.tv_sec = 0, .tv_nsec = 500 * 1000 * 1000};
     watchdogLoopTimer =
@@ -849,6 +970,20 @@ static ExitCode InitPeripheralsAndHandlers(void)
         return ExitCode_Init_AzureTimer;
     }
 
+    struct timespec telemetryPeriod = {.tv_sec = 0,
+                                       .tv_nsec = TelemetryTimerPeriodMs * 1000 * 1000};
+    telemetryTimer =
+        CreateEventLoopPeriodicTimer(eventLoop, &TelemetryTimerEventHandler, &telemetryPeriod);
+    if (telemetryTimer == NULL) {
+        return ExitCode_Init_TelemetryTimer;
+    }
+
+    fetchTimer = CreateEventLoopDisarmedTimer(busEventLoop, &FetchTimerEventHandler);
+    if (fetchTimer == NULL) {
+        return ExitCode_Init_FetchTimer;
+    }
+    ArmFetchTimer();
+
     updateEventReg = SysEvent_RegisterForEventNotifications(
         eventLoop, SysEvent_Events_UpdateReadyForInstall, UpdateCallback, NULL);
     if (updateEventReg == NULL) {
@@ -886,11 +1021,20 @@ static void ClosePeripheralsAndHandlers(void)
     Log_Debug("Closing file descriptors\n");
 
     DisposeEventLoopTimer(azureTimer);
+    DisposeEventLoopTimer(telemetryTimer);
+    DisposeEventLoopTimer(fetchTimer);
     DisposeEventLoopTimer(watchdogLoopTimer);
     DisposeEventLoopTimer(ledEventLoopTimer);
 
     SysEvent_UnregisterForEventNotifications(updateEventReg);
 
+#ifdef USE_MODBUS
+    ModbusTcpServer_UnregisterEventLoop();
+#endif  // USE_MODBUS
+#ifdef USE_MODBUS_TCP
+    LibmodbusTcp_UnregisterEventLoop();
+#endif  // USE_MODBUS_TCP
+    EventLoop_Close(busEventLoop);
     EventLoop_Close(eventLoop);
 }
 
@@ -972,6 +1116,7 @@ static void HubConnectionStatusCallback(IOTHUB_CLIENT_CONNECTION_STATUS result,
                 snprintf(propertyStr, sizeof(propertyStr), EventMsgTemplate, eepromProperty[i].name, eepromProperty[i].value);
                 IoT_CentralLib_SendProperty(propertyStr);
             }
+            BusWorker_Lock();  // ct_error is referred by the bus I/O thread
             if ((eeprom.venderId[0] | ((eeprom.venderId[1] << 8) & 0xFF00)) != APP_VENDOR_ID) {
                 Log_Debug("ERROR: Illegal vendor id.\n");
                 ct_error = -ILLEGAL_PACKAGE;
@@ -984,6 +1129,7 @@ static void HubConnectionStatusCallback(IOTHUB_CLIENT_CONNECTION_STATUS result,
                 Log_Debug("ERROR: Illegal generation.\n");
                 ct_error = -ILLEGAL_PACKAGE;
             }
+            BusWorker_Unlock();
             if (ct_error < 0) {
                 sphereStatus.isEepromDataValid = false;
                 ChangeLedStatus(LED_BLINK);
@@ -1258,6 +1404,83 @@ static bool CheckDeferredUpdateConfig(const unsigned char* payload,
     return ret;
 }
 
+static bool ParseTelemetryBatchConfig(json_value* json, vector item)
+{
+    uint32_t maxAgeSec = 0;
+    uint32_t maxSize = TELEMETRY_BATCH_DEFAULT_SIZE;
+    bool ret = true;
+
+    if (json->type != json_string) {
+        json = json_GetKeyJson("value", json);
+        if (json == NULL || json->type != json_string) {
+            return false;
+        }
+    }
+    PropertyItems_AddItem(item, "TelemetryBatchConfig", TYPE_STR, json->u.string.ptr);
+    json = json_parse(json->u.string.ptr, json->u.string.length);
+    if (json == NULL || json->type != json_object) {
+        ret = false;
+        goto end;
+    }
+
+    for (unsigned int i = 0; i < json->u.object.length; i++) {
+        char* propertyName = json->u.object.values[i].name;
+        json_value* value = json->u.object.values[i].value;
+
+        if (0 == strcmp(propertyName, "maxAge")) {
+            if (!json_GetNumericValue(value, &maxAgeSec, 10) || maxAgeSec > 86400) {
+                ret = false;
+            }
+        } else if (0 == strcmp(propertyName, "maxSize")) {
+            if (!json_GetNumericValue(value, &maxSize, 10)
+                || maxSize < TELEMETRY_BATCH_MIN_SIZE || maxSize > TELEMETRY_BATCH_MAX_SIZE) {
+                ret = false;
+            }
+        }
+    }
+    if (ret) {
+        IoT_CentralLib_SetTelemetryBatch(maxAgeSec, maxSize);
+    }
+
+end:
+    if (json != NULL) {
+        json_value_free(json);
+    }
+    return ret;
+}
+
+static bool CheckTelemetryBatchConfig(const unsigned char* payload,
+    unsigned int payloadSize, vector item)
+{
+    json_value* jsonObj = json_parse(payload, payloadSize);
+    json_value* desiredObj = NULL;
+    json_value* batchObj = NULL;
+    bool ret = false;
+
+    if (jsonObj == NULL) {
+        return false;
+    }
+    desiredObj = json_GetKeyJson("desired", jsonObj);
+    if (desiredObj == NULL) {
+        batchObj = json_GetKeyJson("TelemetryBatchConfig", jsonObj);
+    } else {
+        batchObj = json_GetKeyJson("TelemetryBatchConfig", desiredObj);
+    }
+
+    if (batchObj != NULL) {
+        if (batchObj->type == json_null) {
+            PropertyItems_AddItem(item, "TelemetryBatchConfig", TYPE_NULL);
+            IoT_CentralLib_SetTelemetryBatch(0, TELEMETRY_BATCH_DEFAULT_SIZE);
+        } else if (!ParseTelemetryBatchConfig(batchObj, item)) {
+            Log_Debug("TelemetryBatchConfig error!\n");
+        }
+        ret = true;
+    }
+    json_value_free(jsonObj);
+
+    return ret;
+}
+
 /// <summary>
 ///     Callback invoked when a Device Twin update is received from IoT Hub.
 ///     Updates local state for 'showEvents' (bool).
@@ -1274,10 +1497,14 @@ static void TwinCallback(DEVICE_TWIN_UPDATE_STATE updateState, const unsigned ch
     vector Send_PropertyItem = vector_init(sizeof(ResponsePropertyItem));
 
     bool defupderr = CheckDeferredUpdateConfig(payload, payloadSize, Send_PropertyItem);
+    bool batchcfg = CheckTelemetryBatchConfig(payload, payloadSize, Send_PropertyItem);
+
+    // the devices and the fetch items are used by the bus I/O thread
+    BusWorker_Lock();
 
 #ifdef USE_MODBUS
     SphereWarning err = ModbusConfigMgr_LoadAndApplyIfChanged(payload, payloadSize, Send_PropertyItem);
-    if (defupderr && err == UNSUPPORTED_PROPERTY) {
+    if ((defupderr || batchcfg) && err == UNSUPPORTED_PROPERTY) {
         err = NO_ERROR;
     }
     switch (err)
@@ -1324,7 +1551,7 @@ static void TwinCallback(DEVICE_TWIN_UPDATE_STATE updateState, const unsigned ch
 
 #ifdef USE_DI
     SphereWarning err = DI_ConfigMgr_LoadAndApplyIfChanged(payload, payloadSize, Send_PropertyItem);
-    if (defupderr && err == UNSUPPORTED_PROPERTY) {
+    if ((defupderr || batchcfg) && err == UNSUPPORTED_PROPERTY) {
         err = NO_ERROR;
     }
     switch (err)
@@ -1363,6 +1590,7 @@ static void TwinCallback(DEVICE_TWIN_UPDATE_STATE updateState, const unsigned ch
     }
 
 #endif  // USE_DI
+    BusWorker_Unlock();
     vector_destroy(Send_PropertyItem);
 
     if (ct_error < 0) {
@@ -1381,21 +1609,28 @@ static int CommandCallback(const char* method_name, const unsigned char* payload
         goto end;
     }
 
+#ifdef USE_DI
     char deviceMethodResponse[100];
+#endif
     char reportedPropertiesString[100];
 
 #ifdef USE_MODBUS
     static const char* ReportMsgTemplate = "{ \"ModbusWriteRegisterResult\": \"%s\" }";
+    static char modbusResponse[MODBUS_ONESHOT_RESPONSE_SIZE];
 
-    ModbusOneshotcommand(payload, size, deviceMethodResponse);
+    BusWorker_Lock();
+    ModbusOneshotcommand(payload, size, modbusResponse);
+    BusWorker_Unlock();
 
     // send result
-    *response_size = strlen(deviceMethodResponse);
+    *response_size = strlen(modbusResponse);
     *response = malloc(*response_size);
     if (NULL != response) {
-        (void)memcpy(*response, deviceMethodResponse, *response_size);
+        (void)memcpy(*response, modbusResponse, *response_size);
     }
-    snprintf(reportedPropertiesString, sizeof(reportedPropertiesString), ReportMsgTemplate, deviceMethodResponse);
+    // read values of FC23 are returned by the response only
+    snprintf(reportedPropertiesString, sizeof(reportedPropertiesString), ReportMsgTemplate,
+        (modbusResponse[0] == '[') ? "\"Success\"" : modbusResponse);
     IoT_CentralLib_SendProperty(reportedPropertiesString);
 #endif
 
@@ -1422,7 +1657,10 @@ static int CommandCallback(const char* method_name, const unsigned char* payload
                 free(cmdPayload);
                 goto err_value;
             }
-            if (!DI_Lib_ResetPulseCount((unsigned long)pinId, (unsigned long)initVal)) {
+            BusWorker_Lock();
+            bool isReset = DI_Lib_ResetPulseCount((unsigned long)pinId, (unsigned long)initVal);
+            BusWorker_Unlock();
+            if (!isReset) {
                 Log_Debug("DI_Lib_ResetPulseCount() error");
                 strcpy(deviceMethodResponse, "\"Reset Error\"");
                 snprintf(reportedPropertiesString, sizeof(reportedPropertiesString), ReportMsgTemplate, pinId + DI_PORT_OFFSET, "Reset Error");
@@ -0,0 +1,71 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Atmark Techno, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+// Stubs of the Azure Sphere application libraries for the host tests
+
+#include <stdarg.h>
+#include <stdio.h>
+
+#include <applibs/eventloop.h>
+#include <applibs/log.h>
+
+struct EventRegistration {
+    int	fd;
+};
+
+static struct EventRegistration	sRegistration;
+
+int
+Log_Debug(const char* fmt, ...)
+{
+    va_list	args;
+    int	rc;
+
+    va_start(args, fmt);
+    rc = vfprintf(stderr, fmt, args);
+    va_end(args);
+
+    return rc;
+}
+
+EventRegistration*
+EventLoop_RegisterIo(EventLoop* el, int fd, EventLoop_IoEvents eventBitmask,
+    EventLoopIoCallback* callback, void* context)
+{
+    sRegistration.fd = fd;
+    return &sRegistration;
+}
+
+int
+EventLoop_ModifyIoEvents(EventLoop* el, EventRegistration* reg,
+    EventLoop_IoEvents eventBitmask)
+{
+    return 0;
+}
+
+int
+EventLoop_UnregisterIo(EventLoop* el, EventRegistration* reg)
+{
+    return 0;
+}
@@ -0,0 +1,52 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Atmark Techno, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+// Stub of applibs/eventloop.h for the host tests (implemented in HostStubs.c)
+//   the registrations are not dispatched, the tests call the handlers.
+
+#ifndef _HOSTTEST_APPLIBS_EVENTLOOP_H_
+#define _HOSTTEST_APPLIBS_EVENTLOOP_H_
+
+#include <stdint.h>
+
+typedef struct EventLoop	EventLoop;
+typedef struct EventRegistration	EventRegistration;
+typedef uint32_t	EventLoop_IoEvents;
+
+enum {
+    EventLoop_Input  = 0x01,
+    EventLoop_Output = 0x04,
+    EventLoop_Error  = 0x08,
+};
+
+typedef void	EventLoopIoCallback(EventLoop* el, int fd, EventLoop_IoEvents events,
+    void* context);
+
+extern EventRegistration*	EventLoop_RegisterIo(EventLoop* el, int fd,
+    EventLoop_IoEvents eventBitmask, EventLoopIoCallback* callback, void* context);
+extern int	EventLoop_ModifyIoEvents(EventLoop* el, EventRegistration* reg,
+    EventLoop_IoEvents eventBitmask);
+extern int	EventLoop_UnregisterIo(EventLoop* el, EventRegistration* reg);
+
+#endif  // _HOSTTEST_APPLIBS_EVENTLOOP_H_
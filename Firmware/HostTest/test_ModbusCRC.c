@@ -0,0 +1,142 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Atmark Techno, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "HostTest.h"
+#include "ModbusCRC.h"
+
+// bit-by-bit implementation used before the table, as the reference
+static uint16_t
+BitwiseCRC(const uint8_t* req, int req_length)
+{
+    uint16_t crc = 0xFFFF;
+    for (int i = 0; i < req_length; i++) {
+        crc = (uint16_t)(crc ^ req[i]);
+        for (int j = 0; j < 8; j++) {
+            if ((crc & 1) == 1) {
+                crc = crc >> 1;
+                crc ^= 0xA001;
+            }
+            else {
+                crc = crc >> 1;
+            }
+        }
+    }
+    return crc;
+}
+
+// frames with the CRC field (low byte first)
+static const struct {
+    uint8_t	frame[16];
+    int	len;
+} sKnownFrames[] = {
+    // example of the specification (MODBUS over Serial Line, 6.2.2)
+    { { 0x02, 0x07, 0x41, 0x12 }, 4 },
+    // read holding registers 0-9 of slave 1, and its exception response
+    { { 0x01, 0x03, 0x00, 0x00, 0x00, 0x0A, 0xC5, 0xCD }, 8 },
+    { { 0x01, 0x83, 0x02, 0xC0, 0xF1 }, 5 },
+    // read input register 0 of slave 1
+    { { 0x01, 0x04, 0x00, 0x00, 0x00, 0x01, 0x31, 0xCA }, 8 },
+};
+
+static void
+TestKnownFrames(void)
+{
+    for (size_t i = 0; i < sizeof(sKnownFrames) / sizeof(sKnownFrames[0]); i++) {
+        const uint8_t*	frame = sKnownFrames[i].frame;
+        int	len = sKnownFrames[i].len;
+        uint16_t	expected = (uint16_t)(frame[len - 2] | (frame[len - 1] << 8));
+        uint8_t	broken[16];
+
+        HOSTTEST_CHECK(BitwiseCRC(frame, len - 2) == expected);
+        HOSTTEST_CHECK(ModbusCRC_Calc(frame, len - 2) == expected);
+        HOSTTEST_CHECK(ModbusCRC_Check(frame, len));
+
+        memcpy(broken, frame, len);
+        broken[0] ^= 0x01;
+        HOSTTEST_CHECK(! ModbusCRC_Check(broken, len));
+    }
+    HOSTTEST_CHECK(! ModbusCRC_Check(sKnownFrames[0].frame, 2));  // too short
+}
+
+static void
+TestRandomBuffers(void)
+{
+    uint8_t	buf[256];
+
+    srand(1);
+    for (int i = 0; i < 10000; i++) {
+        int	len = rand() % (int)sizeof(buf);
+
+        for (int j = 0; j < len; j++) {
+            buf[j] = (uint8_t)rand();
+        }
+        HOSTTEST_CHECK(ModbusCRC_Calc(buf, len) == BitwiseCRC(buf, len));
+    }
+}
+
+static void
+Benchmark(void)
+{
+    // RTU frames are 256 bytes at most
+    static uint8_t	buf[256];
+    const int	repeat = 20000;
+    volatile uint16_t	sink = 0;
+    double	start, bitwiseNs, tableNs;
+
+    for (size_t i = 0; i < sizeof(buf); i++) {
+        buf[i] = (uint8_t)(i * 31 + 7);
+    }
+
+    start = HostTest_GetTimeNs();
+    for (int i = 0; i < repeat; i++) {
+        buf[0] = (uint8_t)i;
+        sink ^= BitwiseCRC(buf, sizeof(buf));
+    }
+    bitwiseNs = HostTest_GetTimeNs() - start;
+
+    start = HostTest_GetTimeNs();
+    for (int i = 0; i < repeat; i++) {
+        buf[0] = (uint8_t)i;
+        sink ^= ModbusCRC_Calc(buf, sizeof(buf));
+    }
+    tableNs = HostTest_GetTimeNs() - start;
+
+    printf("bitwise: %.2f ns/byte, table: %.2f ns/byte (x%.1f)\n",
+        bitwiseNs / repeat / sizeof(buf), tableNs / repeat / sizeof(buf),
+        bitwiseNs / tableNs);
+    (void)sink;
+}
+
+int
+main(void)
+{
+    TestKnownFrames();
+    TestRandomBuffers();
+    Benchmark();
+
+    return HOSTTEST_RESULT();
+}
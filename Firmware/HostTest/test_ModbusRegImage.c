@@ -0,0 +1,204 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Atmark Techno, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <time.h>
+
+#include "HostTest.h"
+
+// the image is built with a fake monotonic clock to test the age
+static time_t	sFakeNow = 1000;
+
+static int
+FakeClockGettime(clockid_t clockId, struct timespec* ts)
+{
+    ts->tv_sec = sFakeNow;
+    ts->tv_nsec = 0;
+    return 0;
+}
+#define clock_gettime	FakeClockGettime
+
+#include "ModbusRegImage.c"
+
+#define RTU	MODBUS_REG_IMAGE_SOURCE_RTU
+#define TCP1	"192.168.0.10:502"
+#define TCP2	"192.168.0.11:502"
+
+static void
+MakeValues(unsigned short* values, uint32_t regAddr, uint32_t regCount, unsigned short tag)
+{
+    for (uint32_t i = 0; i < regCount; i++) {
+        values[i] = (unsigned short)(tag + regAddr + i);
+    }
+}
+
+static bool
+CheckValues(const unsigned short* values, uint32_t regAddr, uint32_t regCount,
+    unsigned short tag)
+{
+    for (uint32_t i = 0; i < regCount; i++) {
+        if (values[i] != (unsigned short)(tag + regAddr + i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void
+TestReadBlock(void)
+{
+    unsigned short	values[MODBUS_MAX_READ_REGISTERS];
+    uint32_t	ageSec = 99;
+
+    HOSTTEST_CHECK(! ModbusRegImage_Read(RTU, 1, FC_READ_HOLDING_REGISTER, 100, 1, values, &ageSec));
+
+    MakeValues(values, 100, 10, 0);
+    ModbusRegImage_Update(RTU, 1, FC_READ_HOLDING_REGISTER, 100, 10, values);
+    memset(values, 0, sizeof(values));
+    HOSTTEST_CHECK(ModbusRegImage_Read(RTU, 1, FC_READ_HOLDING_REGISTER, 100, 10, values, &ageSec));
+    HOSTTEST_CHECK(CheckValues(values, 100, 10, 0));
+    HOSTTEST_CHECK(ageSec == 0);
+    HOSTTEST_CHECK(ModbusRegImage_Read(RTU, 1, FC_READ_HOLDING_REGISTER, 103, 2, values, &ageSec));
+    HOSTTEST_CHECK(CheckValues(values, 103, 2, 0));
+
+    // other unit, function, or registers out of the block
+    HOSTTEST_CHECK(! ModbusRegImage_Read(RTU, 2, FC_READ_HOLDING_REGISTER, 100, 10, values, &ageSec));
+    HOSTTEST_CHECK(! ModbusRegImage_Read(RTU, 1, FC_READ_INPUT_REGISTERS, 100, 10, values, &ageSec));
+    HOSTTEST_CHECK(! ModbusRegImage_Read(RTU, 1, FC_READ_HOLDING_REGISTER, 99, 2, values, &ageSec));
+    HOSTTEST_CHECK(! ModbusRegImage_Read(RTU, 1, FC_READ_HOLDING_REGISTER, 109, 2, values, &ageSec));
+
+    // the same block is overwritten every period
+    sFakeNow += 5;
+    MakeValues(values, 100, 10, 1000);
+    ModbusRegImage_Update(RTU, 1, FC_READ_HOLDING_REGISTER, 100, 10, values);
+    HOSTTEST_CHECK(vector_size(sBlocks) == 1);
+    HOSTTEST_CHECK(ModbusRegImage_Read(RTU, 1, FC_READ_HOLDING_REGISTER, 100, 10, values, &ageSec));
+    HOSTTEST_CHECK(CheckValues(values, 100, 10, 1000));
+
+    ModbusRegImage_Clear();
+    HOSTTEST_CHECK(! ModbusRegImage_Read(RTU, 1, FC_READ_HOLDING_REGISTER, 100, 10, values, &ageSec));
+}
+
+// a read spanning the blocks takes each register from the latest block,
+// and its age is the one of the oldest block
+static void
+TestSpanningBlocks(void)
+{
+    unsigned short	values[MODBUS_MAX_READ_REGISTERS];
+    uint32_t	ageSec = 0;
+
+    MakeValues(values, 0, 10, 0);
+    ModbusRegImage_Update(RTU, 3, FC_READ_INPUT_REGISTERS, 0, 10, values);
+    sFakeNow += 7;
+    MakeValues(values, 10, 10, 0);
+    ModbusRegImage_Update(RTU, 3, FC_READ_INPUT_REGISTERS, 10, 10, values);
+    sFakeNow += 3;
+    HOSTTEST_CHECK(ModbusRegImage_Read(RTU, 3, FC_READ_INPUT_REGISTERS, 5, 10, values, &ageSec));
+    HOSTTEST_CHECK(CheckValues(values, 5, 10, 0));
+    HOSTTEST_CHECK(ageSec == 10);
+    HOSTTEST_CHECK(ModbusRegImage_Read(RTU, 3, FC_READ_INPUT_REGISTERS, 12, 3, values, &ageSec));
+    HOSTTEST_CHECK(ageSec == 3);
+
+    // overlapping block acquired later
+    MakeValues(values, 8, 4, 500);
+    ModbusRegImage_Update(RTU, 3, FC_READ_INPUT_REGISTERS, 8, 4, values);
+    HOSTTEST_CHECK(ModbusRegImage_Read(RTU, 3, FC_READ_INPUT_REGISTERS, 6, 8, values, &ageSec));
+    HOSTTEST_CHECK(CheckValues(values, 6, 2, 0));
+    HOSTTEST_CHECK(CheckValues(values + 2, 8, 4, 500));
+    HOSTTEST_CHECK(CheckValues(values + 6, 12, 2, 0));
+
+    // gap between the blocks
+    MakeValues(values, 30, 5, 0);
+    ModbusRegImage_Update(RTU, 3, FC_READ_INPUT_REGISTERS, 30, 5, values);
+    HOSTTEST_CHECK(! ModbusRegImage_Read(RTU, 3, FC_READ_INPUT_REGISTERS, 15, 20, values, &ageSec));
+
+    ModbusRegImage_Clear();
+}
+
+// only the register reads of the valid count are stored
+static void
+TestIgnoredBlocks(void)
+{
+    unsigned short	values[MODBUS_MAX_READ_REGISTERS + 1];
+    uint32_t	ageSec = 0;
+
+    MakeValues(values, 0, MODBUS_MAX_READ_REGISTERS + 1, 0);
+    ModbusRegImage_Update(RTU, 1, FC_READ_COILS, 0, 8, values);
+    ModbusRegImage_Update(RTU, 1, FC_READ_DISCRETE_INPUTS, 0, 8, values);
+    ModbusRegImage_Update(RTU, 1, FC_READ_HOLDING_REGISTER, 0, 0, values);
+    ModbusRegImage_Update(RTU, 1, FC_READ_HOLDING_REGISTER, 0, MODBUS_MAX_READ_REGISTERS + 1, values);
+    HOSTTEST_CHECK(vector_size(sBlocks) == 0);
+    HOSTTEST_CHECK(! ModbusRegImage_Read(RTU, 1, FC_READ_COILS, 0, 1, values, &ageSec));
+
+    ModbusRegImage_Update(RTU, 1, FC_READ_HOLDING_REGISTER, 0, MODBUS_MAX_READ_REGISTERS, values);
+    HOSTTEST_CHECK(ModbusRegImage_Read(RTU, 1, FC_READ_HOLDING_REGISTER, 0,
+        MODBUS_MAX_READ_REGISTERS, values, &ageSec));
+    HOSTTEST_CHECK(CheckValues(values, 0, MODBUS_MAX_READ_REGISTERS, 0));
+}
+
+// the same unit ID of the different sources never mixes
+static void
+TestSources(void)
+{
+    unsigned short	values[MODBUS_MAX_READ_REGISTERS];
+    uint32_t	ageSec = 0;
+
+    ModbusRegImage_Clear();
+    MakeValues(values, 0, 10, 100);
+    ModbusRegImage_Update(RTU, 1, FC_READ_HOLDING_REGISTER, 0, 10, values);
+    sFakeNow += 1;
+    MakeValues(values, 0, 10, 200);
+    ModbusRegImage_Update(TCP1, 1, FC_READ_HOLDING_REGISTER, 0, 10, values);
+    sFakeNow += 1;
+    MakeValues(values, 5, 10, 300);
+    ModbusRegImage_Update(TCP2, 1, FC_READ_HOLDING_REGISTER, 5, 10, values);
+    HOSTTEST_CHECK(vector_size(sBlocks) == 3);
+
+    HOSTTEST_CHECK(ModbusRegImage_Read(RTU, 1, FC_READ_HOLDING_REGISTER, 0, 10, values, &ageSec));
+    HOSTTEST_CHECK(CheckValues(values, 0, 10, 100));
+    HOSTTEST_CHECK(ModbusRegImage_Read(TCP1, 1, FC_READ_HOLDING_REGISTER, 0, 10, values, &ageSec));
+    HOSTTEST_CHECK(CheckValues(values, 0, 10, 200));
+    HOSTTEST_CHECK(ModbusRegImage_Read(TCP2, 1, FC_READ_HOLDING_REGISTER, 5, 10, values, &ageSec));
+    HOSTTEST_CHECK(CheckValues(values, 5, 10, 300));
+    HOSTTEST_CHECK(! ModbusRegImage_Read(TCP2, 1, FC_READ_HOLDING_REGISTER, 0, 10, values, &ageSec));
+    HOSTTEST_CHECK(! ModbusRegImage_Read("192.168.0.12:502", 1, FC_READ_HOLDING_REGISTER,
+        0, 1, values, &ageSec));
+
+    // too long source is ignored
+    ModbusRegImage_Update("255.255.255.255:65535:1", 1, FC_READ_HOLDING_REGISTER, 0, 10, values);
+    HOSTTEST_CHECK(vector_size(sBlocks) == 3);
+
+    ModbusRegImage_Clear();
+}
+
+int
+main(void)
+{
+    TestReadBlock();
+    TestSpanningBlocks();
+    TestIgnoredBlocks();
+    TestSources();
+    ModbusRegImage_Cleanup();
+
+    return HOSTTEST_RESULT();
+}
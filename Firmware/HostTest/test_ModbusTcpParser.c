@@ -0,0 +1,173 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Atmark Techno, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "HostTest.h"
+#include "ModbusTcpParser.h"
+
+// FC03 request, transaction ID 0x0102, unit ID 1, registers 0-9
+static const uint8_t	sRequest[] = {
+    0x01, 0x02, 0x00, 0x00, 0x00, 0x06, 0x01, 0x03, 0x00, 0x00, 0x00, 0x0A
+};
+
+// Write the bytes to the parser as one segment
+static void
+Feed(ModbusTcpParser* parser, const uint8_t* bytes, int length)
+{
+    int	space;
+    uint8_t*	buf = ModbusTcpParser_GetWriteBuf(parser, &space);
+
+    HOSTTEST_CHECK(space >= length);
+    memcpy(buf, bytes, (size_t)length);
+    ModbusTcpParser_Commit(parser, length);
+}
+
+static void
+TestSingleFrame(void)
+{
+    ModbusTcpParser*	parser = ModbusTcpParser_New();
+    const uint8_t*	frame = NULL;
+
+    HOSTTEST_CHECK(ModbusTcpParser_Next(parser, &frame) == 0);
+    Feed(parser, sRequest, sizeof(sRequest));
+    HOSTTEST_CHECK(ModbusTcpParser_Next(parser, &frame) == sizeof(sRequest));
+    HOSTTEST_CHECK(memcmp(frame, sRequest, sizeof(sRequest)) == 0);
+    HOSTTEST_CHECK(ModbusTcpParser_Next(parser, &frame) == 0);
+
+    ModbusTcpParser_Destroy(parser);
+}
+
+// a frame received byte by byte is taken out when it is complete
+static void
+TestSplitFrame(void)
+{
+    ModbusTcpParser*	parser = ModbusTcpParser_New();
+    const uint8_t*	frame = NULL;
+
+    for (size_t i = 0; i < sizeof(sRequest) - 1; i++) {
+        Feed(parser, &sRequest[i], 1);
+        HOSTTEST_CHECK(ModbusTcpParser_Next(parser, &frame) == 0);
+    }
+    Feed(parser, &sRequest[sizeof(sRequest) - 1], 1);
+    HOSTTEST_CHECK(ModbusTcpParser_Next(parser, &frame) == sizeof(sRequest));
+    HOSTTEST_CHECK(memcmp(frame, sRequest, sizeof(sRequest)) == 0);
+
+    ModbusTcpParser_Destroy(parser);
+}
+
+// segments of odd length with several frames and partial frames,
+// the buffer is reused while the frames are taken out
+static void
+TestCoalescedFrames(void)
+{
+    ModbusTcpParser*	parser = ModbusTcpParser_New();
+    uint8_t	stream[sizeof(sRequest) * 200];
+    const uint8_t*	frame = NULL;
+    int	frames = 0;
+    int	rc;
+
+    for (int i = 0; i < 200; i++) {
+        memcpy(stream + i * sizeof(sRequest), sRequest, sizeof(sRequest));
+        stream[i * sizeof(sRequest) + 1] = (uint8_t)i;  // transaction ID
+    }
+    for (size_t pos = 0; pos < sizeof(stream); pos += 29) {
+        size_t	length = sizeof(stream) - pos < 29 ? sizeof(stream) - pos : 29;
+
+        Feed(parser, stream + pos, (int)length);
+        while (0 < (rc = ModbusTcpParser_Next(parser, &frame))) {
+            HOSTTEST_CHECK(rc == sizeof(sRequest));
+            HOSTTEST_CHECK(frame[1] == (uint8_t)frames);
+            HOSTTEST_CHECK(memcmp(frame + 2, sRequest + 2, sizeof(sRequest) - 2) == 0);
+            frames++;
+        }
+        HOSTTEST_CHECK(rc == 0);
+    }
+    HOSTTEST_CHECK(frames == 200);
+
+    ModbusTcpParser_Destroy(parser);
+}
+
+// a frame of the maximum length is accepted, and there is room for
+// another one after the complete frames are taken out
+static void
+TestMaxLengthFrame(void)
+{
+    ModbusTcpParser*	parser = ModbusTcpParser_New();
+    uint8_t	adu[MODBUS_TCP_MAX_ADU_LENGTH] = { 0 };
+    const uint8_t*	frame = NULL;
+    int	space;
+
+    adu[4] = (uint8_t)((MODBUS_TCP_MAX_ADU_LENGTH - 6) >> 8);
+    adu[5] = (uint8_t)((MODBUS_TCP_MAX_ADU_LENGTH - 6) & 0x00ff);
+    adu[7] = 0x10;
+    Feed(parser, sRequest, 5);  // partial frame follows the complete one
+    for (int i = 0; i < 3; i++) {
+        HOSTTEST_CHECK(ModbusTcpParser_Next(parser, &frame) == 0);
+        Feed(parser, sRequest + 5, sizeof(sRequest) - 5);
+        HOSTTEST_CHECK(ModbusTcpParser_Next(parser, &frame) == sizeof(sRequest));
+        Feed(parser, adu, sizeof(adu));
+        HOSTTEST_CHECK(ModbusTcpParser_Next(parser, &frame) == MODBUS_TCP_MAX_ADU_LENGTH);
+        Feed(parser, sRequest, 5);
+        ModbusTcpParser_GetWriteBuf(parser, &space);
+        HOSTTEST_CHECK(space >= MODBUS_TCP_MAX_ADU_LENGTH);
+    }
+
+    ModbusTcpParser_Destroy(parser);
+}
+
+// wrong protocol ID or length is out of sync
+static void
+TestOutOfSync(void)
+{
+    static const uint8_t	invalid[][8] = {
+        { 0x00, 0x01, 0x00, 0x01, 0x00, 0x06, 0x01, 0x03 },  // protocol ID
+        { 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x01, 0x03 },  // no function code
+        { 0x00, 0x01, 0x00, 0x00, 0x00, 0xff, 0x01, 0x03 },  // too long
+    };
+    const uint8_t*	frame = NULL;
+
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+        ModbusTcpParser*	parser = ModbusTcpParser_New();
+
+        Feed(parser, invalid[i], sizeof(invalid[i]));
+        HOSTTEST_CHECK(ModbusTcpParser_Next(parser, &frame) == -1);
+        ModbusTcpParser_Reset(parser);
+        Feed(parser, sRequest, sizeof(sRequest));
+        HOSTTEST_CHECK(ModbusTcpParser_Next(parser, &frame) == sizeof(sRequest));
+        ModbusTcpParser_Destroy(parser);
+    }
+}
+
+int
+main(void)
+{
+    TestSingleFrame();
+    TestSplitFrame();
+    TestCoalescedFrames();
+    TestMaxLengthFrame();
+    TestOutOfSync();
+
+    return HOSTTEST_RESULT();
+}
@@ -0,0 +1,319 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Atmark Techno, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "HostTest.h"
+
+// the image is built with a fake monotonic clock to test the stale data
+static time_t	sFakeNow = 1000;
+
+static int
+FakeClockGettime(clockid_t clockId, struct timespec* ts)
+{
+    ts->tv_sec = sFakeNow;
+    ts->tv_nsec = 0;
+    return 0;
+}
+#define clock_gettime	FakeClockGettime
+
+#include "ModbusRegImage.c"
+#include "ModbusTcpServer.c"
+
+#define RTU	MODBUS_REG_IMAGE_SOURCE_RTU
+#define TCP1	"192.168.0.10:502"
+
+static ModbusTcpServerClient	sClient;
+static int	sPeerFd = -1;  // HMI side of the connection
+
+// Connect the client by a socket pair instead of accept()
+static void
+Connect(void)
+{
+    int	fds[2];
+
+    HOSTTEST_CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    sClient.fd = fds[0];
+    sClient.parser = ModbusTcpParser_New();
+    sClient.reg = EventLoop_RegisterIo(NULL, fds[0], EventLoop_Input, NULL, &sClient);
+    sClient.txLength = 0;
+    sPeerFd = fds[1];
+}
+
+static void
+Disconnect(void)
+{
+    sClient.reg = NULL;
+    close(sClient.fd);
+    ModbusTcpParser_Destroy(sClient.parser);
+    close(sPeerFd);
+}
+
+// Send the requests and receive the responses
+static int
+Transact(const uint8_t* req, int reqLength, uint8_t* rsp, int rspSize)
+{
+    int	rc;
+
+    HOSTTEST_CHECK(send(sPeerFd, req, (size_t)reqLength, 0) == reqLength);
+    if (! ModbusTcpServer_Receive(&sClient) || ! ModbusTcpServer_Flush(&sClient)) {
+        return -1;
+    }
+    rc = (int)recv(sPeerFd, rsp, (size_t)rspSize, MSG_DONTWAIT);
+
+    return (rc < 0) ? 0 : rc;
+}
+
+// Make a read request
+static void
+MakeRead(uint8_t* req, uint16_t transactionId, uint8_t unitId, uint8_t funcCode,
+    uint16_t regAddr, uint16_t regCount)
+{
+    req[0] = (uint8_t)(transactionId >> 8);
+    req[1] = (uint8_t)(transactionId & 0x00ff);
+    req[2] = 0;
+    req[3] = 0;
+    req[4] = 0;
+    req[5] = 6;
+    req[6] = unitId;
+    req[7] = funcCode;
+    req[8] = (uint8_t)(regAddr >> 8);
+    req[9] = (uint8_t)(regAddr & 0x00ff);
+    req[10] = (uint8_t)(regCount >> 8);
+    req[11] = (uint8_t)(regCount & 0x00ff);
+}
+
+// Check the exception response
+static bool
+IsException(const uint8_t* rsp, int rspLength, const uint8_t* req, uint8_t exception)
+{
+    return rspLength == MODBUS_TCP_MBAP_HEADER_LENGTH + 2
+        && memcmp(rsp, req, 4) == 0 && rsp[4] == 0 && rsp[5] == 3
+        && rsp[6] == req[6] && rsp[7] == (req[7] | 0x80) && rsp[8] == exception;
+}
+
+static void
+Setup(void)
+{
+    unsigned short	values[MODBUS_MAX_READ_REGISTERS];
+
+    for (int i = 0; i < 20; i++) {
+        values[i] = (unsigned short)(0x1100 + i);
+    }
+    ModbusRegImage_Update(RTU, 1, FC_READ_HOLDING_REGISTER, 0, 10, values);
+    ModbusRegImage_Update(RTU, 1, FC_READ_HOLDING_REGISTER, 10, 10, values + 10);
+    ModbusRegImage_Update(RTU, 7, FC_READ_INPUT_REGISTERS, 100, 2, values);
+}
+
+static void
+TestRead(void)
+{
+    uint8_t	req[12];
+    uint8_t	rsp[MODBUS_TCP_SERVER_TX_LENGTH];
+    int	rspLength;
+
+    // spanning two blocks
+    MakeRead(req, 0x1234, 1, FC_READ_HOLDING_REGISTER, 8, 4);
+    rspLength = Transact(req, sizeof(req), rsp, sizeof(rsp));
+    HOSTTEST_CHECK(rspLength == MODBUS_TCP_MBAP_HEADER_LENGTH + 2 + 8);
+    HOSTTEST_CHECK(memcmp(rsp, req, 4) == 0);
+    HOSTTEST_CHECK(rsp[4] == 0 && rsp[5] == 11);
+    HOSTTEST_CHECK(rsp[6] == 1 && rsp[7] == FC_READ_HOLDING_REGISTER && rsp[8] == 8);
+    for (int i = 0; i < 4; i++) {
+        HOSTTEST_CHECK(rsp[9 + i * 2] == 0x11 && rsp[10 + i * 2] == 8 + i);
+    }
+
+    MakeRead(req, 0x0001, 7, FC_READ_INPUT_REGISTERS, 100, 2);
+    rspLength = Transact(req, sizeof(req), rsp, sizeof(rsp));
+    HOSTTEST_CHECK(rspLength == MODBUS_TCP_MBAP_HEADER_LENGTH + 2 + 4);
+    HOSTTEST_CHECK(rsp[6] == 7 && rsp[7] == FC_READ_INPUT_REGISTERS);
+    HOSTTEST_CHECK(rsp[9] == 0x11 && rsp[10] == 0x00 && rsp[11] == 0x11 && rsp[12] == 0x01);
+}
+
+// requests coalesced into a segment are answered in order
+static void
+TestCoalescedRequests(void)
+{
+    uint8_t	req[3 * 12];
+    uint8_t	rsp[MODBUS_TCP_SERVER_TX_LENGTH];
+    int	rspLength;
+
+    MakeRead(req, 1, 1, FC_READ_HOLDING_REGISTER, 0, 1);
+    MakeRead(req + 12, 2, 1, FC_READ_HOLDING_REGISTER, 19, 1);
+    MakeRead(req + 24, 3, 1, FC_READ_HOLDING_REGISTER, 20, 1);
+    rspLength = Transact(req, sizeof(req), rsp, sizeof(rsp));
+    HOSTTEST_CHECK(rspLength == 11 + 11 + 9);
+    HOSTTEST_CHECK(rsp[1] == 1 && rsp[9] == 0x11 && rsp[10] == 0);
+    HOSTTEST_CHECK(rsp[12] == 2 && rsp[20] == 0x11 && rsp[21] == 19);
+    HOSTTEST_CHECK(IsException(rsp + 22, 9, req + 24, MODBUS_EXCEPTION_ILLEGAL_DATA_ADDRESS));
+}
+
+static void
+TestExceptions(void)
+{
+    uint8_t	req[13];
+    uint8_t	rsp[MODBUS_TCP_SERVER_TX_LENGTH];
+    int	rspLength;
+
+    // function other than FC03/FC04
+    MakeRead(req, 1, 1, FC_WRITE_SINGLE_REGISTER, 0, 1);
+    rspLength = Transact(req, 12, rsp, sizeof(rsp));
+    HOSTTEST_CHECK(IsException(rsp, rspLength, req, MODBUS_EXCEPTION_ILLEGAL_FUNCTION));
+
+    // never acquired
+    MakeRead(req, 2, 2, FC_READ_HOLDING_REGISTER, 0, 1);
+    rspLength = Transact(req, 12, rsp, sizeof(rsp));
+    HOSTTEST_CHECK(IsException(rsp, rspLength, req, MODBUS_EXCEPTION_ILLEGAL_DATA_ADDRESS));
+    MakeRead(req, 3, 1, FC_READ_INPUT_REGISTERS, 0, 1);
+    rspLength = Transact(req, 12, rsp, sizeof(rsp));
+    HOSTTEST_CHECK(IsException(rsp, rspLength, req, MODBUS_EXCEPTION_ILLEGAL_DATA_ADDRESS));
+
+    // register count out of range, or wrong length of the request
+    MakeRead(req, 4, 1, FC_READ_HOLDING_REGISTER, 0, 0);
+    rspLength = Transact(req, 12, rsp, sizeof(rsp));
+    HOSTTEST_CHECK(IsException(rsp, rspLength, req, MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE));
+    MakeRead(req, 5, 1, FC_READ_HOLDING_REGISTER, 0, MODBUS_MAX_READ_REGISTERS + 1);
+    rspLength = Transact(req, 12, rsp, sizeof(rsp));
+    HOSTTEST_CHECK(IsException(rsp, rspLength, req, MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE));
+    MakeRead(req, 6, 1, FC_READ_HOLDING_REGISTER, 0, 1);
+    req[5] = 7;
+    req[12] = 0;
+    rspLength = Transact(req, 13, rsp, sizeof(rsp));
+    HOSTTEST_CHECK(IsException(rsp, rspLength, req, MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE));
+}
+
+// values older than maxAge are answered with 0B
+static void
+TestStale(void)
+{
+    uint8_t	req[12];
+    uint8_t	rsp[MODBUS_TCP_SERVER_TX_LENGTH];
+    unsigned short	values[10] = { 0 };
+    int	rspLength;
+
+    sMaxAgeSec = 60;
+    MakeRead(req, 1, 1, FC_READ_HOLDING_REGISTER, 0, 1);
+    sFakeNow += 60;
+    rspLength = Transact(req, sizeof(req), rsp, sizeof(rsp));
+    HOSTTEST_CHECK(rspLength == MODBUS_TCP_MBAP_HEADER_LENGTH + 2 + 2);
+    sFakeNow += 1;
+    rspLength = Transact(req, sizeof(req), rsp, sizeof(rsp));
+    HOSTTEST_CHECK(IsException(rsp, rspLength, req, MODBUS_EXCEPTION_GATEWAY_TARGET));
+
+    // any of the blocks is stale
+    Setup();
+    MakeRead(req, 2, 1, FC_READ_HOLDING_REGISTER, 0, 20);
+    rspLength = Transact(req, sizeof(req), rsp, sizeof(rsp));
+    HOSTTEST_CHECK(rspLength == MODBUS_TCP_MBAP_HEADER_LENGTH + 2 + 40);
+    sFakeNow += 30;
+    ModbusRegImage_Update(RTU, 1, FC_READ_HOLDING_REGISTER, 0, 10, values);
+    sFakeNow += 31;
+    rspLength = Transact(req, sizeof(req), rsp, sizeof(rsp));
+    HOSTTEST_CHECK(IsException(rsp, rspLength, req, MODBUS_EXCEPTION_GATEWAY_TARGET));
+
+    sMaxAgeSec = 0;  // not limited
+    rspLength = Transact(req, sizeof(req), rsp, sizeof(rsp));
+    HOSTTEST_CHECK(rspLength == MODBUS_TCP_MBAP_HEADER_LENGTH + 2 + 40);
+}
+
+// the unit IDs are mapped to the sources explicitly,
+// the same unit ID of the Modbus TCP server is not served as the RTU device
+static void
+TestUnitMap(void)
+{
+    static EventLoop*	fakeEventLoop = (EventLoop*)&sClient;
+    unsigned short	values[2] = { 0x2200, 0x2201 };
+    ModbusTcpServerUnit	map[] = {
+        { .unitId = 1,  .source = RTU,  .sourceUnitId = 1 },
+        { .unitId = 11, .source = TCP1, .sourceUnitId = 1 },
+    };
+    vector	units = vector_init(sizeof(ModbusTcpServerUnit));
+    uint8_t	req[12];
+    uint8_t	rsp[MODBUS_TCP_SERVER_TX_LENGTH];
+    int	rspLength;
+
+    Setup();
+    ModbusRegImage_Update(TCP1, 1, FC_READ_HOLDING_REGISTER, 0, 2, values);
+    ModbusRegImage_Update(TCP1, 7, FC_READ_INPUT_REGISTERS, 100, 2, values);
+
+    // without the map, only the RTU devices are served by devID
+    MakeRead(req, 1, 1, FC_READ_HOLDING_REGISTER, 0, 1);
+    rspLength = Transact(req, sizeof(req), rsp, sizeof(rsp));
+    HOSTTEST_CHECK(rspLength == MODBUS_TCP_MBAP_HEADER_LENGTH + 2 + 2);
+    HOSTTEST_CHECK(rsp[9] == 0x11 && rsp[10] == 0x00);
+
+    sEventLoop = fakeEventLoop;
+    vector_add_last_multi(units, map, sizeof(map) / sizeof(map[0]));
+    HOSTTEST_CHECK(ModbusTcpServer_Start(0, 0, units));  // any free port
+    vector_destroy(units);
+
+    rspLength = Transact(req, sizeof(req), rsp, sizeof(rsp));
+    HOSTTEST_CHECK(rspLength == MODBUS_TCP_MBAP_HEADER_LENGTH + 2 + 2);
+    HOSTTEST_CHECK(rsp[9] == 0x11 && rsp[10] == 0x00);
+    MakeRead(req, 2, 11, FC_READ_HOLDING_REGISTER, 0, 2);
+    rspLength = Transact(req, sizeof(req), rsp, sizeof(rsp));
+    HOSTTEST_CHECK(rspLength == MODBUS_TCP_MBAP_HEADER_LENGTH + 2 + 4);
+    HOSTTEST_CHECK(rsp[6] == 11);
+    HOSTTEST_CHECK(rsp[9] == 0x22 && rsp[10] == 0x00 && rsp[11] == 0x22 && rsp[12] == 0x01);
+
+    // not mapped, even if the RTU device or the unit of the server exists
+    MakeRead(req, 3, 7, FC_READ_INPUT_REGISTERS, 100, 2);
+    rspLength = Transact(req, sizeof(req), rsp, sizeof(rsp));
+    HOSTTEST_CHECK(IsException(rsp, rspLength, req, MODBUS_EXCEPTION_GATEWAY_PATH));
+
+    ModbusTcpServer_Stop();
+    HOSTTEST_CHECK(sUnits == NULL);
+    sEventLoop = NULL;
+}
+
+// a stream out of sync breaks the connection
+static void
+TestOutOfSync(void)
+{
+    uint8_t	req[12];
+    uint8_t	rsp[MODBUS_TCP_SERVER_TX_LENGTH];
+
+    MakeRead(req, 1, 1, FC_READ_HOLDING_REGISTER, 0, 1);
+    req[3] = 1;  // protocol ID
+    HOSTTEST_CHECK(Transact(req, sizeof(req), rsp, sizeof(rsp)) == -1);
+}
+
+int
+main(void)
+{
+    Setup();
+    Connect();
+    TestRead();
+    TestCoalescedRequests();
+    TestExceptions();
+    TestStale();
+    TestUnitMap();
+    TestOutOfSync();
+    Disconnect();
+    ModbusRegImage_Cleanup();
+
+    return HOSTTEST_RESULT();
+}
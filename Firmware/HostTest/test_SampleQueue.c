@@ -0,0 +1,131 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Atmark Techno, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "HostTest.h"
+#include "SampleQueue.h"
+
+// Publish a snapshot of the items, the value is its sequence number
+static bool
+PublishSnapshot(SampleQueue* queue, uint32_t itemCount, uint32_t* seq)
+{
+    if (SampleQueue_CountFree(queue) < itemCount) {
+        SampleQueue_AddDropCount(queue, itemCount);
+        return false;
+    }
+    for (uint32_t i = 0; i < itemCount; i++) {
+        SampleRecord*	record = SampleQueue_GetFreeAt(queue, i);
+
+        snprintf(record->itemName, sizeof(record->itemName), "item%u", i);
+        snprintf(record->value, sizeof(record->value), "%u", (*seq)++);
+        record->isLast = (i == itemCount - 1);
+    }
+    SampleQueue_Publish(queue, itemCount);
+
+    return true;
+}
+
+// Consume all the records, checking their order
+static uint32_t
+ConsumeAll(SampleQueue* queue, uint32_t* seq)
+{
+    uint32_t	availCount = SampleQueue_CountAvail(queue);
+
+    for (uint32_t i = 0; i < availCount; i++) {
+        char	expected[SAMPLE_VALUE_MAX_LEN + 1];
+
+        snprintf(expected, sizeof(expected), "%u", (*seq)++);
+        HOSTTEST_CHECK(strcmp(SampleQueue_GetAvailAt(queue, i)->value, expected) == 0);
+    }
+    SampleQueue_Consume(queue, availCount);
+
+    return availCount;
+}
+
+// snapshots are published and consumed as a whole around the ring
+static void
+TestRing(void)
+{
+    SampleQueue*	queue = SampleQueue_New(10);
+    uint32_t	produced = 0;
+    uint32_t	consumed = 0;
+
+    HOSTTEST_CHECK(SampleQueue_GetCapacity(queue) == 16);
+    for (int i = 0; i < 100; i++) {
+        HOSTTEST_CHECK(PublishSnapshot(queue, 5, &produced));
+        HOSTTEST_CHECK(PublishSnapshot(queue, 5, &produced));
+        HOSTTEST_CHECK(SampleQueue_CountFree(queue) == 6);
+        HOSTTEST_CHECK(! PublishSnapshot(queue, 7, &produced));
+        HOSTTEST_CHECK(ConsumeAll(queue, &consumed) == 10);
+    }
+    HOSTTEST_CHECK(consumed == produced);
+    HOSTTEST_CHECK(SampleQueue_GetDropCount(queue) == 100 * 7);
+
+    // a snapshot larger than the ring never fits
+    HOSTTEST_CHECK(! PublishSnapshot(queue, 17, &produced));
+
+    SampleQueue_Destroy(queue);
+}
+
+// the ring is enlarged keeping the records not consumed in order,
+// even if they wrap around the end of the ring
+static void
+TestReserve(void)
+{
+    SampleQueue*	queue = SampleQueue_New(16);
+    uint32_t	produced = 0;
+    uint32_t	consumed = 0;
+
+    HOSTTEST_CHECK(PublishSnapshot(queue, 12, &produced));
+    HOSTTEST_CHECK(ConsumeAll(queue, &consumed) == 12);
+    HOSTTEST_CHECK(PublishSnapshot(queue, 10, &produced));  // wraps around
+
+    HOSTTEST_CHECK(SampleQueue_Reserve(queue, 16));
+    HOSTTEST_CHECK(SampleQueue_GetCapacity(queue) == 16);
+    HOSTTEST_CHECK(SampleQueue_Reserve(queue, 600));
+    HOSTTEST_CHECK(SampleQueue_GetCapacity(queue) == 1024);
+    HOSTTEST_CHECK(SampleQueue_CountAvail(queue) == 10);
+    HOSTTEST_CHECK(SampleQueue_GetAvailAt(queue, 9)->isLast);
+    HOSTTEST_CHECK(SampleQueue_CountFree(queue) == 1024 - 10);
+
+    // two snapshots of 300 items fit after the ones not consumed
+    HOSTTEST_CHECK(PublishSnapshot(queue, 300, &produced));
+    HOSTTEST_CHECK(PublishSnapshot(queue, 300, &produced));
+    HOSTTEST_CHECK(ConsumeAll(queue, &consumed) == 610);
+    HOSTTEST_CHECK(consumed == produced);
+    HOSTTEST_CHECK(SampleQueue_GetDropCount(queue) == 0);
+
+    SampleQueue_Destroy(queue);
+}
+
+int
+main(void)
+{
+    TestRing();
+    TestReserve();
+
+    return HOSTTEST_RESULT();
+}
@@ -0,0 +1,165 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Atmark Techno, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "HostTest.h"
+#include "TelemetryBatch.h"
+#include "json.h"
+
+#define SNAPSHOT_NUM	200
+
+// date time string in the format of LibCloud
+static void
+MakeDateTimeStr(char* strBuf, size_t bufSize, uint32_t timeStamp)
+{
+    snprintf(strBuf, bufSize, "2020-01-01T%02u:%02u:%02u.0000000Z",
+        timeStamp / 3600 % 24, timeStamp / 60 % 60, timeStamp % 60);
+}
+
+// telemetry values of a snapshot, like the RS485 model sends
+static void
+MakeValuesJson(char* strBuf, size_t bufSize, uint32_t timeStamp)
+{
+    snprintf(strBuf, bufSize,
+        "{\"Temperature\":%u.%u,\"Humidity\":%u,\"Pressure\":%u}",
+        20 + timeStamp % 10, timeStamp % 10, 40 + timeStamp % 30, 1000 + timeStamp % 20);
+}
+
+static void
+TestToJson(void)
+{
+    TelemetryBatch*	batch = TelemetryBatch_New();
+    const char*	expected1 =
+        "[{\"ts\":\"2020-01-01T00:00:01.0000000Z\",\"values\":{\"a\":1}}]";
+    const char*	expected2 =
+        "[{\"ts\":\"2020-01-01T00:00:01.0000000Z\",\"values\":{\"a\":1}},"
+        "{\"ts\":\"2020-01-01T00:00:02.0000000Z\",\"values\":{\"a\":2,\"b\":\"x\"}}]";
+    size_t	length;
+
+    HOSTTEST_CHECK(TelemetryBatch_Count(batch) == 0);
+    HOSTTEST_CHECK(strcmp(TelemetryBatch_ToJson(batch), "[]") == 0);
+
+    length = TelemetryBatch_GetLengthWith(batch, "2020-01-01T00:00:01.0000000Z", "{\"a\":1}");
+    TelemetryBatch_Add(batch, "2020-01-01T00:00:01.0000000Z", "{\"a\":1}", 1);
+    HOSTTEST_CHECK(strcmp(TelemetryBatch_ToJson(batch), expected1) == 0);
+    HOSTTEST_CHECK(length == strlen(expected1));
+
+    length = TelemetryBatch_GetLengthWith(batch,
+        "2020-01-01T00:00:02.0000000Z", "{\"a\":2,\"b\":\"x\"}");
+    TelemetryBatch_Add(batch, "2020-01-01T00:00:02.0000000Z", "{\"a\":2,\"b\":\"x\"}", 2);
+    HOSTTEST_CHECK(strcmp(TelemetryBatch_ToJson(batch), expected2) == 0);
+    HOSTTEST_CHECK(length == strlen(expected2));
+    HOSTTEST_CHECK(TelemetryBatch_Count(batch) == 2);
+    HOSTTEST_CHECK(TelemetryBatch_GetFirstTimeStamp(batch) == 1);
+
+    TelemetryBatch_Clear(batch);
+    HOSTTEST_CHECK(TelemetryBatch_Count(batch) == 0);
+    HOSTTEST_CHECK(strcmp(TelemetryBatch_ToJson(batch), "[]") == 0);
+    TelemetryBatch_Add(batch, "2020-01-01T00:00:03.0000000Z", "{}", 3);
+    HOSTTEST_CHECK(TelemetryBatch_GetFirstTimeStamp(batch) == 3);
+
+    TelemetryBatch_Destroy(batch);
+}
+
+// Check the message and count its snapshots in order
+static int
+CheckMessage(const char* jsonStr, uint32_t* nextTimeStamp)
+{
+    json_value*	jsonObj = json_parse(jsonStr, strlen(jsonStr));
+    int	count = 0;
+
+    HOSTTEST_CHECK(jsonObj != NULL && jsonObj->type == json_array);
+    if (jsonObj == NULL || jsonObj->type != json_array) {
+        return 0;
+    }
+    for (unsigned int i = 0; i < jsonObj->u.array.length; ++i) {
+        json_value*	elem = jsonObj->u.array.values[i];
+        json_value*	tsObj = json_GetKeyJson((unsigned char*)"ts", elem);
+        json_value*	valuesObj = json_GetKeyJson((unsigned char*)"values", elem);
+        char	strBuf[64];
+
+        MakeDateTimeStr(strBuf, sizeof(strBuf), (*nextTimeStamp)++);
+        HOSTTEST_CHECK(tsObj != NULL && tsObj->type == json_string
+            && strcmp(tsObj->u.string.ptr, strBuf) == 0);
+        HOSTTEST_CHECK(valuesObj != NULL && valuesObj->type == json_object
+            && valuesObj->u.object.length == 3);
+        count++;
+    }
+    json_value_free(jsonObj);
+
+    return count;
+}
+
+// snapshots are packed by the policy of LibCloud, a batch is sent
+// before the next snapshot makes it larger than the size
+static void
+TestPacking(size_t maxSize, int expectedMessages)
+{
+    TelemetryBatch*	batch = TelemetryBatch_New();
+    uint32_t	nextTimeStamp = 0;
+    int	messages = 0;
+    int	snapshots = 0;
+
+    for (uint32_t timeStamp = 0; timeStamp <= SNAPSHOT_NUM; ++timeStamp) {
+        char	dateTimeStr[64];
+        char	valuesJson[128];
+
+        if (timeStamp == SNAPSHOT_NUM) {
+            dateTimeStr[0] = '\0';  // flush the last batch
+        } else {
+            MakeDateTimeStr(dateTimeStr, sizeof(dateTimeStr), timeStamp);
+            MakeValuesJson(valuesJson, sizeof(valuesJson), timeStamp);
+        }
+        if (0 < TelemetryBatch_Count(batch)
+            && (timeStamp == SNAPSHOT_NUM
+                || TelemetryBatch_GetLengthWith(batch, dateTimeStr, valuesJson) > maxSize)) {
+            const char*	jsonStr = TelemetryBatch_ToJson(batch);
+
+            HOSTTEST_CHECK(strlen(jsonStr) <= maxSize);
+            HOSTTEST_CHECK(TelemetryBatch_GetFirstTimeStamp(batch) == nextTimeStamp);
+            snapshots += CheckMessage(jsonStr, &nextTimeStamp);
+            messages++;
+            TelemetryBatch_Clear(batch);
+        }
+        if (timeStamp < SNAPSHOT_NUM) {
+            TelemetryBatch_Add(batch, dateTimeStr, valuesJson, timeStamp);
+        }
+    }
+    HOSTTEST_CHECK(snapshots == SNAPSHOT_NUM);
+    HOSTTEST_CHECK(messages == expectedMessages);
+
+    TelemetryBatch_Destroy(batch);
+}
+
+int
+main(void)
+{
+    TestToJson();
+    TestPacking(TELEMETRY_BATCH_DEFAULT_SIZE, 5);
+    TestPacking(TELEMETRY_BATCH_MIN_SIZE, 100);
+
+    return HOSTTEST_RESULT();
+}
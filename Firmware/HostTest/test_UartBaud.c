@@ -0,0 +1,86 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Atmark Techno, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdlib.h>
+
+#include "HostTest.h"
+#include "UartBaud.h"
+
+// clock of the ISU UART of MT3620
+#define UART_CLOCK	26000000UL
+
+// expected register values
+static const struct {
+    uint32_t	baudrate;
+    uint16_t	divisor;
+    uint8_t 	sampleCount;
+    uint8_t 	samplePoint;
+    uint8_t 	fracDivL;
+    uint8_t 	fracDivM;
+} sExpected[] = {
+    {    1200, 85, 253, 125, 0xff, 1 },
+    {    9600, 53,  50,  23, 0x10, 0 },
+    {   19200,  6, 224, 110, 0xdf, 0 },
+    {  115200,  1, 224, 110, 0xdf, 0 },  // same as the fixed values before the solver
+    {  921600,  1,  27,  12, 0x44, 0 },
+};
+
+static void
+TestExpectedRegs(void)
+{
+    for (size_t i = 0; i < sizeof(sExpected) / sizeof(sExpected[0]); i++) {
+        UartBaudRegs	regs;
+
+        HOSTTEST_CHECK(UartBaud_Solve(UART_CLOCK, sExpected[i].baudrate, &regs));
+        HOSTTEST_CHECK(regs.divisor == sExpected[i].divisor);
+        HOSTTEST_CHECK(regs.sampleCount == sExpected[i].sampleCount);
+        HOSTTEST_CHECK(regs.samplePoint == sExpected[i].samplePoint);
+        HOSTTEST_CHECK(regs.fracDivL == sExpected[i].fracDivL);
+        HOSTTEST_CHECK(regs.fracDivM == sExpected[i].fracDivM);
+        // well within the tolerance of UART (a few percent)
+        HOSTTEST_CHECK(abs(regs.errorPpm) < 1000);
+    }
+}
+
+static void
+TestOutOfRange(void)
+{
+    const uint32_t	rejected[] = { 0, UART_BAUD_MIN - 1, UART_BAUD_MAX + 1, 3000000 };
+    UartBaudRegs	regs;
+
+    for (size_t i = 0; i < sizeof(rejected) / sizeof(rejected[0]); i++) {
+        HOSTTEST_CHECK(! UartBaud_Solve(UART_CLOCK, rejected[i], &regs));
+    }
+    HOSTTEST_CHECK(UartBaud_Solve(UART_CLOCK, UART_BAUD_MIN, &regs));
+    HOSTTEST_CHECK(UartBaud_Solve(UART_CLOCK, UART_BAUD_MAX, &regs));
+}
+
+int
+main(void)
+{
+    TestExpectedRegs();
+    TestOutOfRange();
+
+    return HOSTTEST_RESULT();
+}
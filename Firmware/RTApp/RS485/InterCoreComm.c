@@ -46,36 +46,42 @@ InterCoreComm_SendData(const uint8_t* data, uint16_t len)
         sRecvBuf, 20 + len));
 }
 
-// Initialization
-bool
-InterCoreComm_Initialize()
+static bool
+InterCoreComm_CheckBatchRequest(const UART_MsgBatch* batchReq, uint32_t messageLen)
 {
-    if (0 != GetIntercoreBuffers(
-            &sOutboundBuf, &sInboundBuf, &sRingBufSize)) {
+    const uint8_t*	itemCurs = (const uint8_t*)batchReq->items;
+    uint32_t	reqLen = sizeof(uint16_t) * 2;
+    uint32_t	rspLen = UART_BatchResult_HeaderSize;
+
+    if (messageLen > MAX_UART_BATCH_LEN || messageLen < reqLen
+        || batchReq->count == 0) {
         return false;
     }
-    sDriverMsgBuf = (UART_DriverMsg*)(sRecvBuf + 20);  // GUID(16[Byte]) + reserved(4[Byte]) prefix
+    for (int i = 0; i < batchReq->count; i++) {
+        const UART_MsgWriteAndRead*	item = (const UART_MsgWriteAndRead*)itemCurs;
 
-    return true;
+        if (reqLen + UART_MsgWriteAndRead_HeaderSize > messageLen) {
+            return false;  // truncated
+        }
+        if (item->writeLen > MAX_UART_WRITE_LEN
+            || item->readLen > MAX_UART_READ_LEN) {
+            return false;  // too long request or response
+        }
+        reqLen += UART_MsgWriteAndRead_Size(item->writeLen);
+        rspLen += UART_ReadResult_Size(item->readLen);
+        if (reqLen > messageLen || rspLen > MAX_UART_BATCH_LEN) {
+            return false;  // truncated or too long response
+        }
+        itemCurs += UART_MsgWriteAndRead_Size(item->writeLen);
+    }
+
+    return (reqLen == messageLen);
 }
 
-// Wait and receive request from HLApp
-const UART_DriverMsg*
-InterCoreComm_WaitAndRecvRequest()
+static const UART_DriverMsg*
+InterCoreComm_CheckRequest(uint32_t dataSize)
 {
-    uint32_t	dataSize;
-    UART_DriverMsgHdr*	msgHdr;
-
-    // wait request message arrives while sleep
-    while (true) {
-        dataSize = sizeof(sRecvBuf);
-        if (0 == DequeueData(sOutboundBuf, sInboundBuf,
-                sRingBufSize, sRecvBuf, &dataSize)) {
-            break;
-        }
-        TimerUtil_SleepUntilIntr();
-    }
-    msgHdr = &sDriverMsgBuf->header;
+    UART_DriverMsgHdr*	msgHdr = &sDriverMsgBuf->header;
 
     // check the received message's integrity
     if (dataSize <= sizeof(UART_DriverMsgHdr)) {
@@ -83,10 +89,26 @@ InterCoreComm_WaitAndRecvRequest()
     }
     switch (msgHdr->requestCode) {
     case UART_REQ_WRITE_AND_READ:
-        if (msgHdr->messageLen != ((sizeof(uint16_t) * 2) +
+        if (msgHdr->messageLen != (UART_MsgWriteAndRead_HeaderSize +
                 sDriverMsgBuf->body.writeAndReadReq.writeLen)) {
             return NULL;  // invalid length
         }
+        if (sDriverMsgBuf->body.writeAndReadReq.readLen > MAX_UART_READ_LEN) {
+            return NULL;  // too long response
+        }
+        break;
+    case UART_REQ_BATCH:
+        if (! InterCoreComm_CheckBatchRequest(&sDriverMsgBuf->body.batchReq,
+                msgHdr->messageLen)) {
+            return NULL;  // invalid transactions
+        }
+        break;
+    case UART_REQ_POLL_TABLE:
+        if (sDriverMsgBuf->body.pollTable.count > MAX_UART_POLL_ENTRIES
+            || msgHdr->messageLen != (sizeof(uint16_t) * 2)
+                + sDriverMsgBuf->body.pollTable.count * sizeof(UART_PollEntry)) {
+            return NULL;  // invalid length
+        }
         break;
     case UART_REQ_SET_PARAMS:
         if (msgHdr->messageLen != sizeof(UART_MsgSetParams)) {
@@ -105,6 +127,48 @@ InterCoreComm_WaitAndRecvRequest()
     return sDriverMsgBuf;
 }
 
+// Initialization
+bool
+InterCoreComm_Initialize()
+{
+    if (0 != GetIntercoreBuffers(
+            &sOutboundBuf, &sInboundBuf, &sRingBufSize)) {
+        return false;
+    }
+    sDriverMsgBuf = (UART_DriverMsg*)(sRecvBuf + 20);  // GUID(16[Byte]) + reserved(4[Byte]) prefix
+
+    return true;
+}
+
+// Wait and receive request from HLApp
+const UART_DriverMsg*
+InterCoreComm_WaitAndRecvRequest()
+{
+    const UART_DriverMsg*	msg;
+
+    // wait request message arrives while sleep
+    while (! InterCoreComm_RecvRequest(&msg)) {
+        TimerUtil_SleepUntilIntr();
+    }
+
+    return msg;
+}
+
+// Receive request from HLApp if arrived (msg is NULL if it's invalid)
+bool
+InterCoreComm_RecvRequest(const UART_DriverMsg** msg)
+{
+    uint32_t	dataSize = sizeof(sRecvBuf);
+
+    if (0 != DequeueData(sOutboundBuf, sInboundBuf,
+            sRingBufSize, sRecvBuf, &dataSize)) {
+        return false;  // no message
+    }
+    *msg = InterCoreComm_CheckRequest(dataSize);
+
+    return true;
+}
+
 // Send UART received data to HLApp
 bool
 InterCoreComm_SendReadData(const uint8_t* data, uint16_t len)
@@ -42,6 +42,9 @@ extern bool	InterCoreComm_Initialize();
 // Wait and receive request from HLApp
 extern const UART_DriverMsg*	InterCoreComm_WaitAndRecvRequest();
 
+// Receive request from HLApp if arrived (msg is NULL if it's invalid)
+extern bool	InterCoreComm_RecvRequest(const UART_DriverMsg** msg);
+
 // Send UART received data to HLApp
 extern bool	InterCoreComm_SendReadData(const uint8_t* data, uint16_t len);
 extern bool	InterCoreComm_SendIntValue(int val);
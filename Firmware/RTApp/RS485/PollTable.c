@@ -0,0 +1,133 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Atmark Techno, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "PollTable.h"
+
+#include <string.h>
+
+#include "UartBaud.h"
+#include "UartDriver.h"
+
+#define FC_READ_COILS           	0x01
+#define FC_READ_DISCRETE_INPUTS 	0x02
+#define FC_READ_HOLDING_REGISTER	0x03
+#define FC_READ_INPUT_REGISTERS 	0x04
+#define MAX_READ_BITS           	2000 // response fits in MAX_UART_READ_LEN
+#define MAX_READ_REGISTERS      	125  // response fits in MAX_UART_READ_LEN
+
+static UART_PollEntry	sEntries[MAX_UART_POLL_ENTRIES];
+static uint32_t	sNextTick[MAX_UART_POLL_ENTRIES];  // due time of each entry
+static uint16_t	sCount = 0;
+static uint16_t	sTableId = 0;
+
+// Load poll table (entries are copied), all entries are due at tickCount
+bool
+PollTable_Load(const UART_MsgPollTable* table, uint32_t tickCount)
+{
+    sCount = 0;
+    sTableId = table->tableId;
+    for (uint16_t i = 0; i < table->count; i++) {
+        const UART_PollEntry*	entry = &table->entries[i];
+        uint16_t	maxCount;
+
+        switch (entry->funcCode) {
+        case FC_READ_COILS:
+        case FC_READ_DISCRETE_INPUTS:
+            maxCount = MAX_READ_BITS;
+            break;
+        case FC_READ_HOLDING_REGISTER:
+        case FC_READ_INPUT_REGISTERS:
+            maxCount = MAX_READ_REGISTERS;
+            break;
+        default:
+            maxCount = 0;
+            break;
+        }
+        if (entry->regCount < 1 || entry->regCount > maxCount
+            || entry->baudRate < UART_BAUD_MIN || entry->baudRate > UART_BAUD_MAX
+            || entry->parity > UART_PARITY_MAX
+            || entry->stop < UART_STOP_MIN || entry->stop > UART_STOP_MAX
+            || entry->intervalMs == 0 || entry->intervalMs % UART_TICK_MS != 0) {
+            sCount = 0;
+            return false;
+        }
+        sEntries[i] = *entry;
+        sNextTick[i] = tickCount;
+    }
+    sCount = table->count;
+
+    return true;
+}
+
+// Attribute
+uint16_t
+PollTable_GetTableId(void)
+{
+    return sTableId;
+}
+
+// Length of the normal response to the entry
+uint16_t
+PollTable_GetReadLen(const UART_PollEntry* entry)
+{
+    // slave ID + function code + byte count + bits or register values + CRC
+    if (entry->funcCode == FC_READ_COILS
+        || entry->funcCode == FC_READ_DISCRETE_INPUTS) {
+        return (uint16_t)(1 + 2 + ((entry->regCount + 7) >> 3) + 2);
+    }
+    return (uint16_t)(1 + 2 + (entry->regCount << 1) + 2);
+}
+
+// Get the most overdue entry (NULL if no entry is due)
+const UART_PollEntry*
+PollTable_GetDueEntry(uint32_t tickCount, uint16_t* outIndex)
+{
+    const UART_PollEntry*	found = NULL;
+    int32_t	maxDelay = -1;
+
+    for (uint16_t i = 0; i < sCount; i++) {
+        int32_t	delay = (int32_t)(tickCount - sNextTick[i]);
+
+        if (delay > maxDelay) {
+            maxDelay = delay;
+            found = &sEntries[i];
+            *outIndex = i;
+        }
+    }
+
+    return found;
+}
+
+// Schedule the next polling of the entry
+void
+PollTable_Advance(uint16_t index, uint32_t tickCount)
+{
+    uint32_t	interval = sEntries[index].intervalMs;
+
+    // keep the phase of the entry, skip the periods already passed
+    sNextTick[index] += interval;
+    if ((int32_t)(tickCount - sNextTick[index]) >= 0) {
+        sNextTick[index] += ((tickCount - sNextTick[index]) / interval + 1) * interval;
+    }
+}
@@ -0,0 +1,59 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Atmark Techno, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef _POLL_TABLE_H_
+#define _POLL_TABLE_H_
+
+#ifndef _STDBOOL_H
+#include <stdbool.h>
+#endif
+#ifndef _STDINT_H
+#include <stdint.h>
+#endif
+
+#ifndef _UART_DRIVER_MSG_H_
+#include "UartDriveMsg.h"
+#endif
+
+// Load poll table (entries are copied), all entries are due at tickCount
+//   returns false if an entry is invalid (the table is cleared)
+// The table is run on TimerUtil_GetTickCount, which advances in 10 ms steps,
+// so the intervals must be multiples of UART_TICK_MS.
+extern bool	PollTable_Load(const UART_MsgPollTable* table, uint32_t tickCount);
+
+// Attribute
+extern uint16_t	PollTable_GetTableId(void);
+
+// Length of the normal response to the entry
+extern uint16_t	PollTable_GetReadLen(const UART_PollEntry* entry);
+
+// Get the most overdue entry (NULL if no entry is due)
+extern const UART_PollEntry*	PollTable_GetDueEntry(
+    uint32_t tickCount, uint16_t* outIndex);
+
+// Schedule the next polling of the entry
+//   polling periods already passed at tickCount are skipped
+extern void	PollTable_Advance(uint16_t index, uint32_t tickCount);
+
+#endif  // _POLL_TABLE_H_
@@ -43,6 +43,9 @@ TimerUtil_Initialize()
     Gpt_Init();
     Gpt_LaunchTimerMs(TimerGpt0, 10, TimerCallback);
 
+    // free-running counter for measuring character intervals
+    Gpt_StartFreeRunUs();
+
     return true;
 }
 
@@ -53,9 +56,28 @@ TimerUtil_SleepUntilIntr()
     __asm__("wfi");
 }
 
+void
+TimerUtil_SleepUntilIntrUnless(bool (*cond)(void))
+{
+    // a pending interrupt wakes up wfi even if masked,
+    // it's handled after unmasking
+    __asm__ volatile("cpsid i" ::: "memory");
+    if (! cond()) {
+        __asm__ volatile("wfi");
+    }
+    __asm__ volatile("cpsie i" ::: "memory");
+}
+
 // tick count (count/msec)
 uint32_t
 TimerUtil_GetTickCount()
 {
     return sTickCount;
 }
+
+// microsecond count (count/usec, wraps around in about 71 minutes)
+uint32_t
+TimerUtil_GetUsecCount()
+{
+    return Gpt_GetFreeRunUs();
+}
@@ -37,8 +37,14 @@ extern bool	TimerUtil_Initialize();
 
 // Sleep
 extern void	TimerUtil_SleepUntilIntr();
+// (unless cond holds, it is checked with the interrupts masked so that
+//  the interrupt which makes it hold can't be missed)
+extern void	TimerUtil_SleepUntilIntrUnless(bool (*cond)(void));
 
 // tick count (count/msec)
 extern uint32_t	TimerUtil_GetTickCount();
 
+// microsecond count (count/usec, wraps around in about 71 minutes)
+extern uint32_t	TimerUtil_GetUsecCount();
+
 #endif  // _TIMER_UTIL_H_
@@ -0,0 +1,91 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Atmark Techno, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "UartBaud.h"
+
+#define MIN_SAMPLE_COUNT	4    // samples per bit
+#define MAX_SAMPLE_COUNT	256
+
+// bits of FRACDIV_M:FRACDIV_L to add one sample for each fraction (in 1/10)
+static const uint8_t	sFracDivL[] = {
+    0x00, 0x10, 0x44, 0x92, 0x59, 0xab, 0xb7, 0xdf, 0xff, 0xff
+};
+static const uint8_t	sFracDivM[] = {
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01
+};
+
+// Solve the register values of the baud rate for the UART clock
+bool
+UartBaud_Solve(uint32_t clock, uint32_t baudrate, UartBaudRegs* out)
+{
+    // everything is in 1/10 sample to handle the fraction,
+    // the products are 64-bit to avoid overflow at high baud rate
+    const uint64_t	target = (uint64_t)clock * 10;  // == divisor * samples10 * baudrate
+    uint64_t	bestError = UINT64_MAX;
+    uint32_t	bestDivisor = 0;
+    uint32_t	bestSamples10 = 0;
+
+    if (baudrate < UART_BAUD_MIN || baudrate > UART_BAUD_MAX) {
+        return false;
+    }
+
+    for (uint32_t divisor = 1; divisor <= UINT16_MAX; divisor++) {
+        uint64_t	unit = (uint64_t)divisor * baudrate;
+        uint32_t	samples10 = (uint32_t)((target + unit / 2) / unit);  // rounded
+        uint64_t	actual;
+        uint64_t	error;
+
+        if (samples10 < MIN_SAMPLE_COUNT * 10) {
+            break;  // larger divisor makes the samples fewer
+        }
+        if (samples10 >= (MAX_SAMPLE_COUNT + 1) * 10) {
+            continue;
+        }
+        actual = unit * samples10;
+        error = (actual > target) ? actual - target : target - actual;
+        if (error < bestError) {
+            // fewer divisor (more samples per bit) is preferred on a tie
+            bestError = error;
+            bestDivisor = divisor;
+            bestSamples10 = samples10;
+        }
+        if (error == 0) {
+            break;
+        }
+    }
+    if (bestDivisor == 0) {
+        return false;
+    }
+
+    out->divisor = (uint16_t)bestDivisor;
+    out->sampleCount = (uint8_t)(bestSamples10 / 10 - 1);
+    out->samplePoint = (bestSamples10 / 10 <= MIN_SAMPLE_COUNT)
+        ? 0 : (uint8_t)(bestSamples10 / 10 / 2 - 2);  // middle of the bit
+    out->fracDivL = sFracDivL[bestSamples10 % 10];
+    out->fracDivM = sFracDivM[bestSamples10 % 10];
+    out->errorPpm = (int32_t)(((int64_t)((uint64_t)bestDivisor * bestSamples10 * baudrate)
+        - (int64_t)target) * 1000000 / (int64_t)target);
+
+    return true;
+}
@@ -0,0 +1,56 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Atmark Techno, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef _UART_BAUD_H_
+#define _UART_BAUD_H_
+
+#ifndef _STDBOOL_H
+#include <stdbool.h>
+#endif
+#ifndef _STDINT_H
+#include <stdint.h>
+#endif
+
+// supported range of the baud rate
+#define UART_BAUD_MIN	1200
+#define UART_BAUD_MAX	921600
+
+// register values of the baud rate (high speed mode 3)
+//   bit time = divisor * (sampleCount + 1 + fraction / 10) / clock,
+//   the fraction adds one sample to fraction of the 10 bits of a character
+typedef struct UartBaudRegs {
+    uint16_t	divisor;      // DLL, DLH
+    uint8_t 	sampleCount;  // SAMPLE_COUNT
+    uint8_t 	samplePoint;  // SAMPLE_POINT
+    uint8_t 	fracDivL;     // FRACDIV_L (data bits)
+    uint8_t 	fracDivM;     // FRACDIV_M (start, parity and stop bits)
+    int32_t 	errorPpm;     // error of the bit time (in ppm, positive: slower)
+} UartBaudRegs;
+
+// Solve the register values of the baud rate for the UART clock
+//   minimizes the error of the baud rate (pure function without register access),
+//   returns false if the baud rate isn't supported
+extern bool	UartBaud_Solve(uint32_t clock, uint32_t baudrate, UartBaudRegs* out);
+
+#endif  // _UART_BAUD_H_
@@ -31,11 +31,23 @@
 
 // constants
 #define MAX_UART_WRITE_LEN	256
+#define MAX_UART_READ_LEN	256
+#define MAX_UART_BATCH_LEN	480  // body length of UART_REQ_BATCH request and its response
+#define MAX_UART_POLL_ENTRIES	24  // entries of UART_REQ_POLL_TABLE request
+
+// timing of a transaction in RTApp (for estimating its processing time)
+#define UART_RESPONSE_TIMEOUT_MS	400  // until the first character of the response (default)
+#define UART_CRC_RETRY_COUNT	2
+#define UART_RETRY_INTERVAL_MS	10
+// tick of RTApp, the timeouts and the poll intervals are measured in it
+#define UART_TICK_MS	10
 
 // request code
 enum {
     UART_REQ_WRITE_AND_READ = 1,  // send request and receive response aganist opposing device
     UART_REQ_SET_PARAMS     = 2,  // setting UART parameters
+    UART_REQ_BATCH          = 3,  // UART_REQ_WRITE_AND_READ for multiple transactions in a row
+    UART_REQ_POLL_TABLE     = 4,  // load poll table, RTApp polls the devices by itself
     UART_REQ_VERSION        = 255,// RTApp Version
 };
 
@@ -52,11 +64,15 @@ typedef struct UART_DriverMsgHdr {
     // UART_REQ_WRITE_AND_READ
 typedef struct UART_MsgWriteAndRead {
     uint16_t	writeLen;
-    uint16_t	readLen;
+    uint16_t	readLen;       // maximum length of the response
+    uint16_t	timeoutMs;     // until the first character of the response
+                               // (0: UART_RESPONSE_TIMEOUT_MS)
+    uint16_t	reserved;
     uint32_t	writeData[1];  // writeLen
 //
-// (sizeof(writeLen) + sizeof(readLen) + writeLen) == messageLen
+// (UART_MsgWriteAndRead_HeaderSize + writeLen) == messageLen
 // writeLen must (<= MAX_UART_WRITE_LEN)
+// readLen must (<= MAX_UART_READ_LEN)
 //
 } UART_MsgWriteAndRead;
     // UART_REQ_SET_PARAMS
@@ -68,6 +84,42 @@ typedef struct UART_MsgSetParams {
 // sizeof(UART_MsgSetParams) == messageLen
 //
 } UART_MsgSetParams;
+    // UART_REQ_BATCH
+typedef struct UART_MsgBatch {
+    uint16_t	count;     // number of transactions
+    uint16_t	reserved;
+    uint32_t	items[1];  // count * UART_MsgWriteAndRead
+//
+// each UART_MsgWriteAndRead is aligned to 4 bytes (UART_MsgWriteAndRead_Size)
+// (sizeof(count) + sizeof(reserved) + total size of items) == messageLen
+// messageLen must (<= MAX_UART_BATCH_LEN)
+// total size of the results (UART_ReadResult_Size(readLen)) must
+// (<= MAX_UART_BATCH_LEN - UART_BatchResult_HeaderSize)
+//
+} UART_MsgBatch;
+    // UART_REQ_POLL_TABLE
+typedef struct UART_PollEntry {
+    uint32_t	baudRate;
+    uint8_t 	parity;
+    uint8_t 	stop;
+    uint8_t 	slaveId;
+    uint8_t 	funcCode;   // FC01, FC02, FC03 or FC04
+    uint16_t	regAddr;
+    uint16_t	regCount;
+    uint32_t	intervalMs; // polling interval (in milliseconds, UART_TICK_MS steps)
+    uint16_t	timeoutMs;  // same as UART_MsgWriteAndRead
+    uint16_t	reserved;
+} UART_PollEntry;
+
+typedef struct UART_MsgPollTable {
+    uint16_t	count;      // number of entries (0: stop polling)
+    uint16_t	tableId;    // echoed back in UART_PollPush
+    UART_PollEntry	entries[1];  // count
+//
+// (sizeof(count) + sizeof(tableId) + count * sizeof(UART_PollEntry)) == messageLen
+// count must (<= MAX_UART_POLL_ENTRIES)
+//
+} UART_MsgPollTable;
 
 // union of messages
 typedef struct UART_DriverMsg {
@@ -75,6 +127,8 @@ typedef struct UART_DriverMsg {
     union {
         UART_MsgWriteAndRead    writeAndReadReq;
         UART_MsgSetParams       setParams;
+        UART_MsgBatch           batchReq;
+        UART_MsgPollTable       pollTable;
     } body;
 } UART_DriverMsg;
 
@@ -87,8 +141,70 @@ typedef struct UART_ReturnMsg {
     } message;
 } UART_ReturnMsg;
 
+// result of UART_REQ_WRITE_AND_READ
+enum {
+    UART_READ_OK        = 0,  // received a normal response
+    UART_READ_TIMEOUT   = 1,  // no response
+    UART_READ_EXCEPTION = 2,  // received an exception response
+    UART_READ_OVERRUN   = 3,  // response longer than readLen, or UART overrun
+    UART_READ_CRC_ERROR = 4,  // corrupted response
+};
+
+typedef struct UART_ReadResult {
+    uint16_t	status;
+    uint16_t	readLen;   // length of readData
+    uint32_t	latencyUs; // from the end of the request to the first character
+                           // of the response (0 if timed out)
+    uint8_t 	readData[MAX_UART_READ_LEN];
+//
+// only (UART_ReadResult_HeaderSize + readLen) bytes are sent
+//
+} UART_ReadResult;
+
+#define UART_ReadResult_HeaderSize \
+    (sizeof(uint16_t) * 2 + sizeof(uint32_t))
+#define UART_ReadResult_Size(readLen) \
+    ((UART_ReadResult_HeaderSize + (readLen) + 3) & ~3)
+
+// result of UART_REQ_BATCH
+typedef struct UART_BatchResult {
+    uint16_t	count;       // number of results
+    uint16_t	reserved;
+    uint32_t	results[1];  // count * UART_ReadResult
+//
+// each UART_ReadResult is aligned to 4 bytes (UART_ReadResult_Size)
+//
+} UART_BatchResult;
+
+#define UART_BatchResult_HeaderSize \
+    (sizeof(uint16_t) * 2)
+
+// result of the poll table entry (sent by RTApp without request)
+#define UART_POLL_PUSH_MAGIC	0x4c4c4f50  // "POLL", never be head of the other responses
+
+typedef struct UART_PollPush {
+    uint32_t	magic;       // UART_POLL_PUSH_MAGIC
+    uint16_t	tableId;     // of UART_REQ_POLL_TABLE
+    uint16_t	entryIndex;  // index of the entry in the poll table
+    uint32_t	tickCount;   // acquired time (RTApp's tick count in milliseconds)
+    UART_ReadResult	result;
+//
+// only (UART_PollPush_HeaderSize + UART_ReadResult_HeaderSize + result.readLen)
+// bytes are sent
+//
+} UART_PollPush;
+
+#define UART_PollPush_HeaderSize \
+    (sizeof(uint32_t) * 3)
+
 // macro for UART_REQ_WRITE_AND_READ
+#define UART_MsgWriteAndRead_HeaderSize \
+    (sizeof(uint16_t) * 4)
 #define UART_MsgWriteAndRead_WriteDataPtr(msgBody) \
     (unsigned char*)&(msgBody->writeData)
 
+// macro for UART_REQ_BATCH
+#define UART_MsgWriteAndRead_Size(writeLen) \
+    ((UART_MsgWriteAndRead_HeaderSize + (writeLen) + 3) & ~3)
+
 #endif  // _UART_DRIVER_MSG_H_
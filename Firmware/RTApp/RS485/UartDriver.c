@@ -0,0 +1,366 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Atmark Techno, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "UartDriver.h"
+
+#include "UartBaud.h"
+
+#define UART_CLOCK		(26000000UL)
+#define UART_RBR				(0x0)
+#define UART_THR				(0x0)
+#define UART_IER				(0x4)
+#define UART_IIR				(0x8)
+#define UART_FCR				(0x8)
+#define UART_LCR				(0xc)
+#define UART_LSR				(0x14)
+#define UART_DLL				(0x0)
+#define UART_DLH				(0x4)
+#define UART_RATE_STEP			(0x24)
+#define UART_SAMPLE_COUNT		(0x28)
+#define UART_SAMPLE_POINT		(0x2c)
+#define UART_FRACDIV_L			(0x54)
+#define UART_FRACDIV_M			(0x58)
+#define UART_IER_ERBFI			(1 << 0)
+#define UART_IER_ETBEI			(1 << 1)
+#define UART_IIR_NO_INT			(1 << 0)
+#define UART_FCR_FIFOE			(1 << 0)
+#define UART_FCR_CLRR			(1 << 1)
+#define UART_FCR_CLRT			(1 << 2)
+#define UART_LCR_DLAB			(1 << 7)
+#define UART_LCR_SB      		(1 << 6)
+#define UART_LCR_SP 	    	(1 << 5)
+#define UART_LCR_EPS_SHIFT		(4)
+#define UART_LCR_PEN    		(1 << 3)
+#define UART_LCR_STB_SHIFT		(2)
+#define UART_LCR_WLS_SHIFT		(0)
+#define UART_LSR_DR				(1 << 0)
+#define UART_LSR_OE				(1 << 1)
+#define UART_LSR_THRE			(1 << 5)
+#define UART_LSR_TEMT			(1 << 6)
+
+#define UART_TX_FIFO_SIZE		16
+
+// ring buffers (size must be power of 2)
+#define RX_RING_SIZE	512
+#define TX_RING_SIZE	256
+
+typedef unsigned char u8;
+typedef unsigned int u32;
+
+static const UartRegAccess*	sRegs = NULL;
+
+// written by the interrupt handler, read by the main loop
+static uint8_t	sRxRing[RX_RING_SIZE];
+static volatile uint32_t	sRxHead = 0;
+static volatile uint32_t	sRxTail = 0;
+static volatile uint32_t	sLastRecvUsec = 0;
+static volatile uint32_t	sFirstRecvUsec = 0;  // first character since UartDriver_ClearRecv
+static volatile bool	sWaitFirstRecv = false;
+static volatile bool	sOverrun = false;
+static volatile bool	sFrameBroken = false;  // silence of 1.5 characters in a frame
+
+// silent intervals of RTU frame (written by the main loop)
+static volatile uint32_t	sCharGapUs = 0;   // 1.5 characters
+static volatile uint32_t	sFrameGapUs = 0;  // 3.5 characters
+
+// written by the main loop, read by the interrupt handler
+static uint8_t	sTxRing[TX_RING_SIZE];
+static volatile uint32_t	sTxHead = 0;
+static volatile uint32_t	sTxTail = 0;
+static volatile bool	sTxBusy = false;
+static volatile bool	sTxDraining = false;  // waiting for the shift register empty
+static volatile uint32_t	sLastSentUsec = 0;
+
+static void
+UartDriver_Reset(void)
+{
+    // Configure UART to use 115200-8-N-1.
+    sRegs->write(UART_LCR, 0x80); // LCR (enable DLL, DLM)
+    sRegs->write(0x24, 0x3);      // HIGHSPEED
+    sRegs->write(0x04, 0);        // Divisor Latch (MS)
+    sRegs->write(0x00, 1);        // Divisor Latch (LS)
+    sRegs->write(0x28, 224);      // SAMPLE_COUNT
+    sRegs->write(0x2C, 110);      // SAMPLE_POINT
+    sRegs->write(0x58, 0);        // FRACDIV_M
+    sRegs->write(0x54, 223);      // FRACDIV_L
+    sRegs->write(UART_LCR, 0x03); // LCR (8-bit word length)
+}
+
+static void
+UartDriver_FillTxFifo(void)
+{
+    // THR is empty, so the transmit FIFO can accept UART_TX_FIFO_SIZE bytes
+    for (int i = 0; i < UART_TX_FIFO_SIZE && sTxTail != sTxHead; i++) {
+        sRegs->write(UART_THR, sTxRing[sTxTail & (TX_RING_SIZE - 1)]);
+        sTxTail++;
+    }
+}
+
+// Initialization (115200-8-N-1, receive mode)
+void
+UartDriver_Initialize(const UartRegAccess* regAccess)
+{
+    sRegs = regAccess;
+
+    sRegs->write(UART_IER, 0);
+    sRegs->setTxEnable(false);
+    UartDriver_Reset();
+
+    // enable FIFOs (interrupt at every received byte, to keep its arrival time)
+    sRegs->write(UART_FCR, UART_FCR_FIFOE | UART_FCR_CLRR | UART_FCR_CLRT);
+    sRxHead = sRxTail = 0;
+    sTxHead = sTxTail = 0;
+    sTxBusy = false;
+    sTxDraining = false;
+    sOverrun = false;
+    sFrameBroken = false;
+    sLastRecvUsec = sLastSentUsec = sRegs->getUsecCount();
+
+    sRegs->write(UART_IER, UART_IER_ERBFI);
+}
+
+// Setting line parameters
+bool
+UartDriver_SetParams(uint32_t baudrate, uint8_t parity, uint8_t stop)
+{
+    u8 uart_lcr, word_length;
+    u32 uart_ier;
+    UartBaudRegs baud;
+
+    if (parity > UART_PARITY_MAX || stop < UART_STOP_MIN || stop > UART_STOP_MAX
+        || ! UartBaud_Solve(UART_CLOCK, baudrate, &baud)) {
+        return false;
+    }
+
+    // mask the interrupts while reprogramming, RBR/THR and IER are
+    // replaced with the divisor latch while DLAB is set
+    uart_ier = sRegs->read(UART_IER);
+    sRegs->write(UART_IER, 0);
+
+    UartDriver_Reset();
+
+    /* Clear fraction */
+    sRegs->write(UART_FRACDIV_L, 0x00);
+    sRegs->write(UART_FRACDIV_M, 0x00);
+
+    /* High speed mode */
+    sRegs->write(UART_RATE_STEP, 0x03);
+
+    /* Set parity and stop bit */
+    uart_lcr = sRegs->read(UART_LCR);
+    word_length = stop - 1;
+    if(parity) {
+        uart_lcr = uart_lcr | ((parity -1 ) << UART_LCR_EPS_SHIFT)
+                    | UART_LCR_PEN;
+        word_length += 1;
+    }
+    uart_lcr = uart_lcr | ((stop - 1) << UART_LCR_STB_SHIFT)
+                | word_length << UART_LCR_WLS_SHIFT;
+    sRegs->write(UART_LCR, uart_lcr);
+
+    /* DLAB start */
+    uart_lcr = sRegs->read(UART_LCR);
+    sRegs->write(UART_LCR, uart_lcr | UART_LCR_DLAB);
+
+    sRegs->write(UART_DLL, (baud.divisor & 0x00ff));
+    sRegs->write(UART_DLH, (baud.divisor >> 8) & 0x00ff);
+    sRegs->write(UART_SAMPLE_COUNT, baud.sampleCount);
+    sRegs->write(UART_SAMPLE_POINT, baud.samplePoint);
+    sRegs->write(UART_FRACDIV_M, baud.fracDivM);
+    sRegs->write(UART_FRACDIV_L, baud.fracDivL);
+
+    /* DLAB end */
+    sRegs->write(UART_LCR, uart_lcr);
+
+    sRegs->write(UART_IER, uart_ier);
+
+    return true;
+}
+
+// Silent intervals of RTU frame
+void
+UartDriver_SetFrameTiming(uint32_t charGapUs, uint32_t frameGapUs)
+{
+    sCharGapUs = charGapUs;
+    sFrameGapUs = frameGapUs;
+}
+
+// Interrupt handler (install in the exception vector table)
+void
+UartDriver_HandleIrq(void)
+{
+    uint32_t	lsr;
+
+    while (0 == (sRegs->read(UART_IIR) & UART_IIR_NO_INT)) {
+        lsr = sRegs->read(UART_LSR);
+        if (lsr & UART_LSR_OE) {
+            sOverrun = true;
+        }
+
+        // receive
+        while (lsr & UART_LSR_DR) {
+            uint8_t	val = (uint8_t)sRegs->read(UART_RBR);
+            uint32_t	now = sRegs->getUsecCount();
+            uint32_t	gap = now - sLastRecvUsec;
+
+            // characters of a frame must not be apart more than 1.5 characters
+            if (sCharGapUs < gap && gap < sFrameGapUs) {
+                sFrameBroken = true;
+            }
+            sLastRecvUsec = now;
+            if (sWaitFirstRecv) {
+                sFirstRecvUsec = now;
+                sWaitFirstRecv = false;
+            }
+            if (sRxHead - sRxTail < RX_RING_SIZE) {
+                sRxRing[sRxHead & (RX_RING_SIZE - 1)] = val;
+                sRxHead++;
+            } else {
+                sOverrun = true;
+            }
+            lsr = sRegs->read(UART_LSR);
+        }
+
+        // transmit
+        if (sTxBusy && (lsr & UART_LSR_THRE)) {
+            if (sTxTail != sTxHead) {
+                UartDriver_FillTxFifo();
+            } else {
+                // all data has been moved to the FIFO, the bus is turned
+                // around by UartDriver_IsWriting when the last stop bit is sent
+                sRegs->write(UART_IER, UART_IER_ERBFI);
+                sTxDraining = true;
+            }
+        }
+    }
+}
+
+// Transmit
+bool
+UartDriver_Write(const uint8_t* data, int len)
+{
+    if (sTxBusy || len <= 0 || len > TX_RING_SIZE) {
+        return false;
+    }
+    for (int i = 0; i < len; i++) {
+        sTxRing[(sTxHead + i) & (TX_RING_SIZE - 1)] = data[i];
+    }
+    sTxHead += len;
+    sTxBusy = true;
+
+    // switch to transmit mode, then the THR empty interrupt starts sending
+    sRegs->setTxEnable(true);
+    sRegs->write(UART_IER, UART_IER_ERBFI | UART_IER_ETBEI);
+
+    return true;
+}
+
+bool
+UartDriver_IsWriting(void)
+{
+    // There is no interrupt for the shift register empty, so poll it here
+    // (not in the interrupt handler) and turn the bus around as soon as
+    // the last stop bit is sent.
+    if (sTxDraining) {
+        uint32_t	lsr = sRegs->read(UART_LSR);
+
+        if (lsr & UART_LSR_OE) {
+            sOverrun = true;  // reading LSR clears it
+        }
+        if (lsr & UART_LSR_TEMT) {
+            sRegs->setTxEnable(false);
+            sLastSentUsec = sRegs->getUsecCount();
+            sTxDraining = false;
+            sTxBusy = false;
+        }
+    }
+
+    return sTxBusy;
+}
+
+bool
+UartDriver_IsDraining(void)
+{
+    return sTxDraining;
+}
+
+uint32_t
+UartDriver_GetLastSentUsec(void)
+{
+    return sLastSentUsec;
+}
+
+// Receive
+int
+UartDriver_Read(uint8_t* data, int len)
+{
+    int	count = 0;
+
+    while (count < len && sRxTail != sRxHead) {
+        data[count++] = sRxRing[sRxTail & (RX_RING_SIZE - 1)];
+        sRxTail++;
+    }
+
+    return count;
+}
+
+uint32_t
+UartDriver_GetLastRecvUsec(void)
+{
+    return sLastRecvUsec;
+}
+
+uint32_t
+UartDriver_GetFirstRecvUsec(void)
+{
+    return sFirstRecvUsec;
+}
+
+bool
+UartDriver_IsRecvStarted(void)
+{
+    return ! sWaitFirstRecv;
+}
+
+bool
+UartDriver_IsOverrun(void)
+{
+    return sOverrun;
+}
+
+bool
+UartDriver_IsFrameBroken(void)
+{
+    return sFrameBroken;
+}
+
+void
+UartDriver_ClearRecv(void)
+{
+    // read out unknown received data
+    sRxTail = sRxHead;
+    sOverrun = false;
+    sFrameBroken = false;
+    sWaitFirstRecv = true;
+}
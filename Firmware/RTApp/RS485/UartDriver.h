@@ -0,0 +1,81 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Atmark Techno, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef _UART_DRIVER_H_
+#define _UART_DRIVER_H_
+
+#ifndef _STDBOOL_H
+#include <stdbool.h>
+#endif
+#ifndef _STDINT_H
+#include <stdint.h>
+#endif
+#include <stddef.h>
+
+// access to the UART registers and its surroundings
+// (replaceable with an emulated register file for testing on Linux)
+typedef struct UartRegAccess {
+    uint32_t	(*read)(size_t offset);
+    void	(*write)(size_t offset, uint32_t value);
+    void	(*setTxEnable)(bool enable);  // RS-485 direction (DE / RE_N)
+    uint32_t	(*getUsecCount)(void);
+} UartRegAccess;
+
+// Initialization (115200-8-N-1, receive mode)
+extern void	UartDriver_Initialize(const UartRegAccess* regAccess);
+
+// line parameters (parity: 0 none, 1 odd, 2 even)
+#define UART_PARITY_MAX	2
+#define UART_STOP_MIN	1
+#define UART_STOP_MAX	2
+
+// Setting line parameters
+//   returns false if the parameters aren't supported (nothing is changed)
+extern bool	UartDriver_SetParams(uint32_t baudrate, uint8_t parity, uint8_t stop);
+
+// Silent intervals of RTU frame (1.5 characters / 3.5 characters)
+extern void	UartDriver_SetFrameTiming(uint32_t charGapUs, uint32_t frameGapUs);
+
+// Interrupt handler (install in the exception vector table)
+extern void	UartDriver_HandleIrq(void);
+
+// Transmit
+extern bool	UartDriver_Write(const uint8_t* data, int len);
+//   UartDriver_IsWriting turns the bus around after the last character,
+//   poll it without sleeping while UartDriver_IsDraining
+extern bool	UartDriver_IsWriting(void);
+extern bool	UartDriver_IsDraining(void);
+extern uint32_t	UartDriver_GetLastSentUsec(void);
+
+// Receive
+extern int	UartDriver_Read(uint8_t* data, int len);
+extern uint32_t	UartDriver_GetLastRecvUsec(void);
+// arrival time of the first character since UartDriver_ClearRecv
+extern uint32_t	UartDriver_GetFirstRecvUsec(void);
+extern bool	UartDriver_IsRecvStarted(void);
+extern bool	UartDriver_IsOverrun(void);
+extern bool	UartDriver_IsFrameBroken(void);
+extern void	UartDriver_ClearRecv(void);
+
+#endif  // _UART_DRIVER_H_
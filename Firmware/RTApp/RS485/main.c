@@ -36,11 +36,16 @@
 #include "mt3620-timer.h"
 
 #include "InterCoreComm.h"
+#include "ModbusCRC.h"
+#include "PollTable.h"
 #include "TimerUtil.h"
 #include "UartDriveMsg.h"
+#include "UartDriver.h"
 
 
-const int TIMEOUT = 400; // 400[ms]
+const int TIMEOUT = UART_RESPONSE_TIMEOUT_MS; // 400[ms] (until the first character of the response)
+const int CRC_RETRY_COUNT = UART_CRC_RETRY_COUNT;
+const uint32_t RETRY_INTERVAL = UART_RETRY_INTERVAL_MS; // 10[ms] (longer than 3.5 characters at 4800bps or faster)
 
 #define OK  1
 #define NG  -1
@@ -49,168 +54,268 @@ typedef unsigned char u8;
 typedef unsigned short u16;
 typedef unsigned int u32;
 
-#define UART_CLOCK		(26000000UL)
-#define UART_LCR				(0xc)
-#define UART_DLL				(0x0)
-#define UART_DLH				(0x4)
-#define UART_RATE_STEP			(0x24)
-#define UART_STEP_COUNT			(0x28)
-#define UART_SAMPLE_COUNT		(0x2c)
-#define UART_FRACDIV_L			(0x54)
-#define UART_FRACDIV_M			(0x58)
-#define UART_LCR_DLAB			(1 << 7)
-#define UART_LCR_SB      		(1 << 6)
-#define UART_LCR_SP 	    	(1 << 5)
-#define UART_LCR_EPS_SHIFT		(4)
-#define UART_LCR_PEN    		(1 << 3)
-#define UART_LCR_STB_SHIFT		(2)
-#define UART_LCR_WLS_SHIFT		(0)
-
-#define RX_BUFFER_SIZE 8
+// silent intervals of RTU frame, fixed values for higher baud rate than 19200bps
+#define CHAR_GAP_FIXED_US		750   // 1.5 characters, limit between characters
+#define FRAME_GAP_FIXED_US		1750  // 3.5 characters, delimits frames
 
 extern uint32_t StackTop; // &StackTop == end of TCM
 
 static _Noreturn void DefaultExceptionHandler(void);
 
-// ISU3 UART Base Address
+// ISU3 UART Base Address and its interrupt
 static const uintptr_t UART_BASE = 0x380a0500;
+#define UART_IRQ		59
+static const uint32_t UART_PRIORITY = 1;  // higher than GPT, for precise RS-485 turnaround
 
+static uint32_t sFrameGapUs = FRAME_GAP_FIXED_US;
+static uint8_t sBatchResultBuf[MAX_UART_BATCH_LEN] __attribute__((aligned(4)));
+static UART_PollPush sPollPush;
 
-static
-void Uart_Init(void)
+// line parameters of UART
+typedef struct LineParams {
+    u32 baudrate;
+    u8  parity;
+    u8  stop;
+} LineParams;
+
+static LineParams sLineParams = { 115200, 0, 1 };  // currently applied
+static LineParams sHostParams = { 115200, 0, 1 };  // requested by HLApp (UART_REQ_SET_PARAMS)
+
+
+static uint32_t
+Uart_ReadReg(size_t offset)
 {
-    // Configure UART to use 115200-8-N-1.
-    WriteReg32(UART_BASE, 0x0C, 0x80); // LCR (enable DLL, DLM)
-    WriteReg32(UART_BASE, 0x24, 0x3);  // HIGHSPEED
-    WriteReg32(UART_BASE, 0x04, 0);    // Divisor Latch (MS)
-    WriteReg32(UART_BASE, 0x00, 1);    // Divisor Latch (LS)
-    WriteReg32(UART_BASE, 0x28, 224);  // SAMPLE_COUNT
-    WriteReg32(UART_BASE, 0x2C, 110);  // SAMPLE_POINT
-    WriteReg32(UART_BASE, 0x58, 0);    // FRACDIV_M
-    WriteReg32(UART_BASE, 0x54, 223);  // FRACDIV_L
-    WriteReg32(UART_BASE, 0x0C, 0x03); // LCR (8-bit word length)
+    return ReadReg32(UART_BASE, offset);
 }
 
-static
-void mtk_hdl_uart_set_params(u32 baudrate, u8 parity, u8 stop)
+static void
+Uart_WriteReg(size_t offset, uint32_t value)
 {
-    u8 uart_lcr, fraction, word_length;
-    u32 data, high_speed_div, sample_count, sample_point;
-    u8 fraction_L_mapping[] = { 0x00, 0x10, 0x44, 0x92, 0x59,
-            0xab, 0xb7, 0xdf, 0xff, 0xff, 0xff };
-    u8 fraction_M_mapping[] = { 0x00, 0x00, 0x00, 0x00, 0x00,
-            0x00, 0x00, 0x00, 0x00, 0x01, 0x03 };
-
-    /* Clear fraction */
-    WriteReg32(UART_BASE, UART_FRACDIV_L, 0x00);
-    WriteReg32(UART_BASE, UART_FRACDIV_M, 0x00);
-
-    /* High speed mode */
-    WriteReg32(UART_BASE, UART_RATE_STEP, 0x03);
-
-    /* Set parity and stop bit */
-    uart_lcr = ReadReg32(UART_BASE, UART_LCR);
-    word_length = stop - 1;
-    if(parity) {
-        uart_lcr = uart_lcr | ((parity -1 ) << UART_LCR_EPS_SHIFT)
-                    | UART_LCR_PEN;
-        word_length += 1;
-    }
-    uart_lcr = uart_lcr | ((stop - 1) << UART_LCR_STB_SHIFT)
-                | word_length << UART_LCR_WLS_SHIFT;
-    WriteReg32(UART_BASE, UART_LCR, uart_lcr);
-
-    /* DLAB start */
-    uart_lcr = ReadReg32(UART_BASE, UART_LCR);
-    WriteReg32(UART_BASE, UART_LCR, uart_lcr | UART_LCR_DLAB);
-
-    data = UART_CLOCK / baudrate;
-    /* divided by 256 */
-    high_speed_div = (data >> 8) + 1;
-
-    sample_count = data / high_speed_div - 1;
-    /* threshold value */
-    if (sample_count == 3)
-        sample_point = 0;
-    else
-        sample_point = (sample_count + 1) / 2 - 2;
-
-    /* check uart_clock, prevent calculation overflow */
-    fraction = ((UART_CLOCK * 10 / baudrate * 10 / high_speed_div -
-        (sample_count + 1) * 100) * 10 + 55) / 100;
-
-    WriteReg32(UART_BASE, UART_DLL, (high_speed_div & 0x00ff));
-    WriteReg32(UART_BASE, UART_DLH, (high_speed_div >> 8) & 0x00ff);
-    WriteReg32(UART_BASE, UART_STEP_COUNT, sample_count);
-    WriteReg32(UART_BASE, UART_FRACDIV_M, sample_point);
-    WriteReg32(UART_BASE, UART_SAMPLE_COUNT, fraction_M_mapping[fraction]);
-    WriteReg32(UART_BASE, UART_FRACDIV_L, fraction_L_mapping[fraction]);
-
-    /* DLAB end */
-    WriteReg32(UART_BASE, UART_LCR, uart_lcr);
+    WriteReg32(UART_BASE, offset, value);
+}
+
+static void
+Uart_SetTxEnable(bool enable)
+{
+    Mt3620_Gpio_Write(21, enable);  // DE
+    Mt3620_Gpio_Write(23, enable);  // RE_N
 }
 
+static const UartRegAccess sUartRegAccess = {
+    .read         = Uart_ReadReg,
+    .write        = Uart_WriteReg,
+    .setTxEnable  = Uart_SetTxEnable,
+    .getUsecCount = TimerUtil_GetUsecCount,
+};
 
 static void
-Uart_WritePoll(const char *msg, int len)
+Uart_SetFrameGap(u32 baudrate, u8 parity, u8 stop)
 {
-    // write 1 byte at a time while waiting for data register space,
-    // then wait for transmission done (i.e. shift register becomes empty)
-    //
-    // LSR (offset 0x14)'s bit 5 and 6 are denote the status of
-    // the data write register and the shift register respectively
-    while (len--) {
-        while (!(ReadReg32(UART_BASE, 0x14) & (UINT32_C(1) << 5))) {
-            // just wait
-        }
+    // start bit + 8 data bits + parity bit + stop bits
+    u32 charBits = 1 + 8 + (parity ? 1 : 0) + stop;
+    u32 charGapUs;
+
+    if (baudrate > 19200) {
+        charGapUs = CHAR_GAP_FIXED_US;
+        sFrameGapUs = FRAME_GAP_FIXED_US;
+    } else {
+        charGapUs = (charBits * 1000000UL * 3) / (baudrate * 2);
+        sFrameGapUs = (charBits * 1000000UL * 7) / (baudrate * 2);
+    }
+    UartDriver_SetFrameTiming(charGapUs, sFrameGapUs);
+}
 
-        WriteReg32(UART_BASE, 0x0, *msg++);
+static void
+Uart_ApplyParams(const LineParams* params)
+{
+    // the poll table may switch the line parameters between requests of HLApp
+    if (params->baudrate == sLineParams.baudrate
+        && params->parity == sLineParams.parity
+        && params->stop == sLineParams.stop) {
+        return;
     }
-    while (!(ReadReg32(UART_BASE, 0x14) & (UINT32_C(1) << 5))) {
-        // just wait
+    if (! UartDriver_SetParams(params->baudrate, params->parity, params->stop)) {
+        return;  // never happens, validated by UART_REQ_SET_PARAMS or PollTable_Load
     }
+    Uart_SetFrameGap(params->baudrate, params->parity, params->stop);
+    sLineParams = *params;
+}
 
-    while (!(ReadReg32(UART_BASE, 0x14) & (UINT32_C(1) << 6))) {
-        // just wait
+static void
+Uart_WaitFrameGap(void)
+{
+    // keep the bus silent for 3.5 characters since the last frame
+    // (in either direction) before starting a new request
+    for (;;) {
+        uint32_t now = TimerUtil_GetUsecCount();
+        uint32_t sinceRecv = now - UartDriver_GetLastRecvUsec();
+        uint32_t sinceSent = now - UartDriver_GetLastSentUsec();
+
+        if (sinceRecv >= sFrameGapUs && sinceSent >= sFrameGapUs) {
+            break;
+        }
     }
 }
 
-static bool
-Uart_ReadPoll(uint8_t *buffer, int len) {
-    int val;
+static uint16_t
+Uart_ReadFrame(uint8_t *buffer, int len, uint16_t *readLen, uint32_t timeoutMs) {
+    uint8_t val;
     int counter = 0;
-    int recvTime = TimerUtil_GetTickCount();
-
-    // read 1 byte at a time while waiting for data register fill
-    //
-    // LSR (offset 0x14)'s bit 0 denotes the status of the data read register
-    memset(buffer, 0, len);
-    for (int i = 0; i < len; i++) {
-        while (0 == (ReadReg32(UART_BASE, 0x14) & 0x01)) {
-            if (TimerUtil_GetTickCount() - recvTime > TIMEOUT) {
-                return false;  // timed out
+    bool overrun = false;
+    uint32_t startTime = TimerUtil_GetTickCount();
+
+    // take received data 1 byte at a time until the line becomes silent
+    // for 3.5 characters (arrival time is recorded by the interrupt handler)
+    *readLen = 0;
+    for (;;) {
+        if (1 == UartDriver_Read(&val, 1)) {
+            if (val == 0 && counter == 0) {
+                continue;  // noise while switching the direction of RS-485
             }
+            if (counter < len) {
+                buffer[counter++] = val;
+            } else {
+                overrun = true;
+            }
+        } else if (counter == 0) {
+            if (TimerUtil_GetTickCount() - startTime > timeoutMs) {
+                return UART_READ_TIMEOUT;  // timed out
+            }
+            TimerUtil_SleepUntilIntr();  // wake up at received data or timer tick
+        } else if (TimerUtil_GetUsecCount() - UartDriver_GetLastRecvUsec() >= sFrameGapUs) {
+            break;  // end of frame
         }
-        val = (uint8_t)ReadReg32(UART_BASE, 0x00);
-        if (val != 0) {
-            buffer[counter++] = val;
-        } else if (val == 0 && counter > 0) {
-            buffer[counter++] = val;
-        }
-        recvTime = TimerUtil_GetTickCount();
     }
+    *readLen = (uint16_t)counter;
 
-    return true;
+    if (overrun || UartDriver_IsOverrun()) {
+        return UART_READ_OVERRUN;
+    }
+    // a frame with silence of 1.5 characters is incomplete, discard it as corrupted
+    if (UartDriver_IsFrameBroken() || ! ModbusCRC_Check(buffer, counter)) {
+        return UART_READ_CRC_ERROR;
+    }
+    if (buffer[1] & 0x80) {
+        return UART_READ_EXCEPTION;
+    }
+
+    return UART_READ_OK;
 }
 
-static void
-Uart_DataSkip() {
-    uint8_t dummy;
+static uint16_t
+Uart_WriteAndRead(const UART_MsgWriteAndRead* req, UART_ReadResult* result)
+{
+    uint32_t	timeoutMs = (req->timeoutMs != 0) ? req->timeoutMs : (uint32_t)TIMEOUT;
+
+    for (int retry = 0; ; retry++) {
+        Uart_WaitFrameGap();
+        UartDriver_ClearRecv();  // read out unknown received data
+
+        // send request to the opposing device via RS-485
+        // (the driver switches the direction back to receive after the last stop bit)
+        if (! UartDriver_Write((const uint8_t*)req->writeData, req->writeLen)) {
+            result->status = UART_READ_TIMEOUT;
+            result->readLen = 0;
+            result->latencyUs = 0;
+            return result->status;
+        }
+        // sleep while the interrupt handler fills the FIFO, then
+        // spin until the last character is sent (1 character at most)
+        while (UartDriver_IsWriting()) {
+            TimerUtil_SleepUntilIntrUnless(UartDriver_IsDraining);
+        }
+
+        // receive response from the opposing device
+        result->status = Uart_ReadFrame(result->readData,
+            req->readLen, &result->readLen, timeoutMs);
+        // response latency, for the adaptive timeout of HLApp
+        result->latencyUs = (result->status == UART_READ_TIMEOUT
+                || ! UartDriver_IsRecvStarted())
+            ? 0 : UartDriver_GetFirstRecvUsec() - UartDriver_GetLastSentUsec();
+        if (result->status != UART_READ_CRC_ERROR
+            || retry >= CRC_RETRY_COUNT) {
+            return result->status;
+        }
+
+        // keep the bus silent before retransmission
+        {
+            uint32_t	prevTickCount = TimerUtil_GetTickCount();
+
+            while (RETRY_INTERVAL >= TimerUtil_GetTickCount() - prevTickCount) {
+                TimerUtil_SleepUntilIntr();
+            }
+        }
+    }
+}
+
+static uint16_t
+Uart_ExecBatch(const UART_MsgBatch* batchReq, UART_BatchResult* batchResult)
+{
+    // transactions are executed back to back, the inter-frame gap of 3.5
+    // characters is ensured by Uart_WaitFrameGap before each request
+    const uint8_t*	itemCurs = (const uint8_t*)batchReq->items;
+    uint8_t*	resultCurs = (uint8_t*)batchResult->results;
+
+    batchResult->count = batchReq->count;
+    batchResult->reserved = 0;
+    for (int i = 0; i < batchReq->count; i++) {
+        const UART_MsgWriteAndRead*	item = (const UART_MsgWriteAndRead*)itemCurs;
+        UART_ReadResult*	result = (UART_ReadResult*)resultCurs;
+
+        Uart_WriteAndRead(item, result);
+        itemCurs += UART_MsgWriteAndRead_Size(item->writeLen);
+        resultCurs += UART_ReadResult_Size(result->readLen);
+    }
+
+    return (uint16_t)(resultCurs - (uint8_t*)batchResult);
+}
 
-    while (1 == (ReadReg32(UART_BASE, 0x14) & 0x01)) {
-        dummy = (uint8_t)ReadReg32(UART_BASE, 0x00);
-        (void)dummy;
+static bool
+Uart_ExecPollTable(void)
+{
+    // execute the most overdue entry of the poll table and push its result to HLApp
+    uint32_t	reqBuf[(UART_MsgWriteAndRead_Size(8)) / sizeof(uint32_t)];
+    UART_MsgWriteAndRead*	req = (UART_MsgWriteAndRead*)reqBuf;
+    uint8_t*	frame = (uint8_t*)req->writeData;
+    const UART_PollEntry*	entry;
+    LineParams	params;
+    uint16_t	index;
+    uint16_t	crc;
+
+    entry = PollTable_GetDueEntry(TimerUtil_GetTickCount(), &index);
+    if (entry == NULL) {
+        return false;
     }
+    params.baudrate = entry->baudRate;
+    params.parity = entry->parity;
+    params.stop = entry->stop;
+    Uart_ApplyParams(&params);
+
+    frame[0] = entry->slaveId;
+    frame[1] = entry->funcCode;
+    frame[2] = (uint8_t)(entry->regAddr >> 8);
+    frame[3] = (uint8_t)(entry->regAddr & 0x00ff);
+    frame[4] = (uint8_t)(entry->regCount >> 8);
+    frame[5] = (uint8_t)(entry->regCount & 0x00ff);
+    crc = ModbusCRC_Calc(frame, 6);
+    frame[6] = (uint8_t)crc;
+    frame[7] = (uint8_t)(crc >> 8);
+    req->writeLen = 8;
+    req->readLen = PollTable_GetReadLen(entry);
+    req->timeoutMs = entry->timeoutMs;
+
+    sPollPush.magic = UART_POLL_PUSH_MAGIC;
+    sPollPush.tableId = PollTable_GetTableId();
+    sPollPush.entryIndex = index;
+    sPollPush.tickCount = TimerUtil_GetTickCount();
+    Uart_WriteAndRead(req, &sPollPush.result);
+    PollTable_Advance(index, TimerUtil_GetTickCount());
+
+    (void)InterCoreComm_SendReadData((const uint8_t*)&sPollPush,
+        (uint16_t)(UART_PollPush_HeaderSize + UART_ReadResult_HeaderSize
+            + sPollPush.result.readLen));
+
+    return true;
 }
 
 static _Noreturn void RTCoreMain(void);
@@ -241,7 +346,9 @@ __attribute__((used)) = {
 
     [INT_TO_EXC(0)] = (uintptr_t)DefaultExceptionHandler,
     [INT_TO_EXC(1)] = (uintptr_t)Gpt_HandleIrq1,
-    [INT_TO_EXC(2)... INT_TO_EXC(INTERRUPT_COUNT - 1)] = (uintptr_t)DefaultExceptionHandler };
+    [INT_TO_EXC(2)... INT_TO_EXC(UART_IRQ - 1)] = (uintptr_t)DefaultExceptionHandler,
+    [INT_TO_EXC(UART_IRQ)] = (uintptr_t)UartDriver_HandleIrq,
+    [INT_TO_EXC(UART_IRQ + 1)... INT_TO_EXC(INTERRUPT_COUNT - 1)] = (uintptr_t)DefaultExceptionHandler };
 
 static _Noreturn void
 DefaultExceptionHandler(void)
@@ -254,7 +361,7 @@ DefaultExceptionHandler(void)
 static _Noreturn void
 RTCoreMain(void)
 {
-    uint8_t rxBuffer[RX_BUFFER_SIZE];
+    UART_ReadResult readResult;
     bool initializeUart = false;
 
     // SCB->VTOR = ExceptionVectorTable
@@ -293,64 +400,86 @@ RTCoreMain(void)
     Mt3620_Gpio_ConfigurePinForOutput(23);
     Mt3620_Gpio_Write(23, false);
 
+    // interrupt driven UART
+    UartDriver_Initialize(&sUartRegAccess);
+    Uart_SetFrameGap(115200, 0, 1);
+    SetNvicPriority(UART_IRQ, UART_PRIORITY);
+    EnableNvicInterrupt(UART_IRQ);
+
     // main loop
     for (;;) {
-        // wait and receive a request message from HLApp and process it
-        const UART_DriverMsg* msg = InterCoreComm_WaitAndRecvRequest();
+        // receive a request message from HLApp and process it,
+        // poll the devices in the poll table while no request arrives
+        const UART_DriverMsg* msg;
 
+        if (! InterCoreComm_RecvRequest(&msg)) {
+            if (! Uart_ExecPollTable()) {
+                TimerUtil_SleepUntilIntr();  // wake up at next tick or message
+            }
+            continue;
+        }
         if (msg != NULL) {
             UART_ReturnMsg    retMsg;
 
             switch (msg->header.requestCode) {
             case UART_REQ_WRITE_AND_READ:
                 if (initializeUart) {
-                    Uart_DataSkip();  // read out unknown received data
-
-                    // send request to the opposing device via RS-485
-                    Mt3620_Gpio_Write(21, true);  // DE (enable)
-                    Mt3620_Gpio_Write(23, true);  // RE_N (disable)
-                    Uart_WritePoll((const char*)msg->body.writeAndReadReq.writeData,
-                        msg->body.writeAndReadReq.writeLen);
-
-                    // receive response from the opposing device
-                    Mt3620_Gpio_Write(21, false);
-                    Mt3620_Gpio_Write(23, false);
-
-                    // send back the response to HLApp
-                    if (! Uart_ReadPoll(rxBuffer, msg->body.writeAndReadReq.readLen)) {
-                        memset(rxBuffer, 0, msg->body.writeAndReadReq.readLen);
-                        if (InterCoreComm_SendReadData(rxBuffer, msg->body.writeAndReadReq.readLen)) {
- //                           int i = -1;
-                        }
-                    } else if (InterCoreComm_SendReadData(rxBuffer, msg->body.writeAndReadReq.readLen)) {
- //                       int i = 1;
-                    }
+                    Uart_ApplyParams(&sHostParams);
+                    // send back the response and its status to HLApp
+                    Uart_WriteAndRead(&msg->body.writeAndReadReq, &readResult);
+                    (void)InterCoreComm_SendReadData((const uint8_t*)&readResult,
+                        (uint16_t)(UART_ReadResult_HeaderSize + readResult.readLen));
                 //
                 // NOTE: It should make time for equal of transmitting 3.5 characters 
                 //       according to Modbus RTU specification.
                 //       (in case of 9600bps, about 3[ms])
                 }
                 break;
+            case UART_REQ_BATCH:
+                if (initializeUart) {
+                    Uart_ApplyParams(&sHostParams);
+                    // send back all the responses and their status at once
+                    uint16_t	resultLen = Uart_ExecBatch(&msg->body.batchReq,
+                        (UART_BatchResult*)sBatchResultBuf);
+
+                    (void)InterCoreComm_SendReadData(sBatchResultBuf, resultLen);
+                }
+                break;
             case UART_REQ_SET_PARAMS:
                 // initialize UART with requested params, then send back the status code
                 // status code is
                 //   0: error, 1: OK
-                Uart_Init();
-                mtk_hdl_uart_set_params(msg->body.setParams.baudRate,
-                    msg->body.setParams.parity, msg->body.setParams.stop);
-                initializeUart = true;
-                if (! InterCoreComm_SendIntValue(1)) {
-//                    int i = 0;
+                {
+                    LineParams	params = {
+                        .baudrate = msg->body.setParams.baudRate,
+                        .parity = msg->body.setParams.parity,
+                        .stop = msg->body.setParams.stop,
+                    };
+                    bool	result = UartDriver_SetParams(params.baudrate,
+                        params.parity, params.stop);
+
+                    if (result) {
+                        Uart_SetFrameGap(params.baudrate, params.parity, params.stop);
+                        sHostParams = params;
+                        sLineParams = params;
+                        initializeUart = true;
+                    }
+                    (void)InterCoreComm_SendIntValue(result ? 1 : 0);
                 }
                 break;
+            case UART_REQ_POLL_TABLE:
+                // replace the poll table, then send back the status code
+                // status code is
+                //   0: error, 1: OK
+                (void)InterCoreComm_SendIntValue(
+                    PollTable_Load(&msg->body.pollTable, TimerUtil_GetTickCount()) ? 1 : 0);
+                break;
             case UART_REQ_VERSION:
                 memset(retMsg.message.version, 0x00, sizeof(retMsg.message.version));
                 strncpy(retMsg.message.version, RTAPP_VERSION, strlen(RTAPP_VERSION) + 1);
                 retMsg.returnCode = OK;
                 retMsg.messageLen = strlen(RTAPP_VERSION);
-                if (InterCoreComm_SendReadData((uint8_t*)&retMsg, sizeof(UART_ReturnMsg))) {
-                    ;
-                }
+                (void)InterCoreComm_SendReadData((uint8_t*)&retMsg, sizeof(UART_ReturnMsg));
                 break;
             default:
                 break;
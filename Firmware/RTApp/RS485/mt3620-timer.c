@@ -72,3 +72,21 @@ void Gpt_LaunchTimerMs(TimerGpt gpt, uint32_t periodMs, Callback callback)
     // GPTx_CTRL -> auto clear; 1kHz, one shot, enable timer.
     WriteReg32(GPT_BASE, gptRegOffsets[gpt].ctrlRegOffset, 0x9);
 }
+
+void Gpt_StartFreeRunUs(void)
+{
+    // GPT3_CTRL[0] = 0 -> disable if already enabled.
+    ClearReg32(GPT_BASE, 0x50, 0x01);
+
+    // GPT3_INIT = 0 -> count from zero.
+    WriteReg32(GPT_BASE, 0x54, 0);
+
+    // GPT3_CTRL -> OSC_CNT_1US = 25 (26MHz / (25 + 1) = 1MHz); enable timer.
+    WriteReg32(GPT_BASE, 0x50, (UINT32_C(25) << 16) | 0x01);
+}
+
+uint32_t Gpt_GetFreeRunUs(void)
+{
+    // GPT3_CNT
+    return ReadReg32(GPT_BASE, 0x58);
+}
@@ -52,4 +52,17 @@ void Gpt_HandleIrq1(void);
 /// <param name="callback">Function to invoke in interrupt context when the timer expires.</param>
 void Gpt_LaunchTimerMs(TimerGpt gpt, uint32_t periodMs, Callback callback);
 
+/// <summary>
+/// <para>Start GPT3 as a free-running counter which is incremented every microsecond.</para>
+/// <para>GPT3 does not generate interrupts, so this can be called independently of
+/// <see cref="Gpt_Init" />.</para>
+/// </summary>
+void Gpt_StartFreeRunUs(void);
+
+/// <summary>
+/// Read the GPT3 free-running counter. The value wraps around after 2^32 microseconds.
+/// </summary>
+/// <returns>Elapsed time in microseconds since <see cref="Gpt_StartFreeRunUs" /> was called.</returns>
+uint32_t Gpt_GetFreeRunUs(void);
+
 #endif /* MT3620_TIMER_H */